@@ -0,0 +1,104 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+/** Command line options of the form --name=value or --name
+  * followed by positional arguments
+  */
+class Options
+{
+public:
+  /** Parses argv[first..argc-1]
+    * @return false Failure (error is logged)
+    */
+  bool parse(int argc, char **argv, int first);
+
+  bool has(const char *name) const;
+  std::string get(const char *name, const char *defaultValue = "") const;
+  int getInt(const char *name, int defaultValue) const;
+  double getDouble(const char *name, double defaultValue) const;
+
+  /** Checks that only options from the space separated list are used
+    * @return false Unknown option found (error is logged)
+    */
+  bool check(const char *knownOptions) const;
+
+  const std::vector<std::string> &getArgs() const
+  {
+    return _args;
+  }
+
+private:
+  std::map<std::string, std::string> _values;
+  std::vector<std::string> _args;
+};
+
+/** A video and its markup to be processed by a batch command
+  */
+struct VideoJob
+{
+  std::string video;
+  std::string markup;
+};
+
+/** Collects jobs from positional arguments (markup names are guessed
+  * with MarkedVideo::guessMarkupName) and from the file given by --list
+  * which contains one video per line optionally followed by a tab and the markup name
+  * @return false Failure (error is logged)
+  */
+bool collectJobs(const Options &options, std::vector<VideoJob> &jobs);
+
+struct Command
+{
+  const char *name;
+  const char *arguments;      ///< options and arguments as shown in the usage
+  const char *description;
+  const char *options;        ///< space separated list of options accepted by the command
+  int (*run)(const Options &options);
+};
+
+int runDump(const Options &options);
+int runExportClips(const Options &options);
+int runValidate(const Options &options);
+int runStats(const Options &options);
+int runEvaluate(const Options &options);
+int runConvertMarkup(const Options &options);
+int runCatalog(const Options &options);
+int runQuery(const Options &options);
+int runSlitScan(const Options &options);
+int runPropose(const Options &options);
+int runMotion(const Options &options);
+int runDefects(const Options &options);
+int runFingerprint(const Options &options);
+int runCompareFingerprints(const Options &options);
+int runBenchWriters(const Options &options);
+int runBenchLookup(const Options &options);
+int runBenchMarkup(const Options &options);
+int runBenchAnalysis(const Options &options);
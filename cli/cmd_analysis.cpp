@@ -0,0 +1,394 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <algorithm>
+#include <iostream>
+
+#include <videoreader.h>
+
+#include "cli.h"
+#include "activity.h"
+#include "frame_defects.h"
+#include "frame_fingerprints.h"
+#include "fileutil.h"
+#include "markedvideo.h"
+#include "motion_track.h"
+#include "slit_scan.h"
+#include "stopwatch.h"
+#include "logger.h"
+
+int runSlitScan(const Options &options)
+{
+  const std::vector<std::string> &videos = options.getArgs();
+  if (videos.empty())
+  {
+    LOG_ERROR("No videos given");
+    return 1;
+  }
+  int height = options.getInt("height", 0);
+  int threads = options.getInt("threads", 0);
+  std::string imageSuffix = options.get("image");
+
+  int failed = 0;
+  for (size_t i = 0; i < videos.size(); i++)
+  {
+    const std::string &video = videos[i];
+    std::string cacheName = SlitScan::getCacheName(video);
+    SlitScan scan(height);
+    Stopwatch stopwatch;
+    const char *source = "cache";
+    if (options.has("rebuild") || !scan.load(cacheName, video))
+    {
+      source = "video";
+      if (!scan.build(video, threads))
+      {
+        LOG_ERROR("Cannot make the slit-scan of '" << video << "'");
+        failed++;
+        continue;
+      }
+      if (!scan.save(cacheName, video))
+        LOG_WARNING("Cannot save '" << cacheName << "'");
+    }
+    std::cout << video << ": " << scan.getFrames() << " frame(s), height " << scan.getHeight()
+              << ", from " << source << " in " << stopwatch.elapsed() << " s" << std::endl;
+
+    if (!imageSuffix.empty() && !scan.saveImage(video + imageSuffix))
+    {
+      LOG_ERROR("Cannot write '" << video + imageSuffix << "'");
+      failed++;
+    }
+  }
+  return failed ? 1 : 0;
+}
+
+int runMotion(const Options &options)
+{
+  const std::vector<std::string> &videos = options.getArgs();
+  if (videos.empty())
+  {
+    LOG_ERROR("No videos given");
+    return 1;
+  }
+  double threshold = options.getDouble("threshold", 0);
+  int minRun = options.getInt("min-run", 25);
+  int threads = options.getInt("threads", 0);
+
+  int failed = 0;
+  for (size_t i = 0; i < videos.size(); i++)
+  {
+    const std::string &video = videos[i];
+    std::string cacheName = MotionTrack::getCacheName(video);
+    MotionTrack track;
+    Stopwatch stopwatch;
+    const char *source = "cache";
+    if (options.has("rebuild") || !track.load(cacheName, video))
+    {
+      source = "video";
+      if (!track.build(video, threads))
+      {
+        LOG_ERROR("Cannot make the motion track of '" << video << "'");
+        failed++;
+        continue;
+      }
+      if (!track.save(cacheName, video))
+        LOG_WARNING("Cannot save '" << cacheName << "'");
+    }
+    double elapsed = stopwatch.elapsed();
+
+    // frames in static runs long enough to be skipped by playback
+    float level = threshold > 0 ? (float) threshold : track.getStaticThreshold();
+    int staticFrames = 0, skipped = 0, run = 0;
+    for (int frame = 0; frame <= track.getFrames(); frame++)
+    {
+      if (frame < track.getFrames() && track.getEnergy(frame) <= level)
+      {
+        run++;
+        continue;
+      }
+      staticFrames += run;
+      if (run >= minRun)
+        skipped += run;
+      run = 0;
+    }
+    char line[256];
+    sprintf(line, "%d frame(s), threshold %.2f, %d static, %d in runs of %d+ (%.1f%%)", track.getFrames(),
+            level, staticFrames, skipped, minRun, track.empty() ? 0.0 : 100.0 * skipped / track.getFrames());
+    std::cout << video << ": " << line << ", from " << source << " in " << elapsed << " s" << std::endl;
+  }
+  return failed ? 1 : 0;
+}
+
+int runDefects(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  FrameDefectOptions defectOptions;
+  defectOptions.nearDifference = options.getDouble("near", defectOptions.nearDifference);
+  defectOptions.blackLevel = options.getInt("black", defectOptions.blackLevel);
+  int minRun = options.getInt("min-run", 1);
+  int threads = options.getInt("threads", 0);
+
+  int failed = 0;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    const std::string &video = jobs[i].video;
+    std::string cacheName = FrameDefectIndex::getCacheName(video);
+    FrameDefectIndex index;
+    Stopwatch stopwatch;
+    const char *source = "cache";
+    if (options.has("rebuild") || !index.load(cacheName, video))
+    {
+      source = "video";
+      if (!index.build(video, threads))
+      {
+        LOG_ERROR("Cannot index the frames of '" << video << "'");
+        failed++;
+        continue;
+      }
+      if (!index.save(cacheName, video))
+        LOG_WARNING("Cannot save '" << cacheName << "'");
+    }
+    double elapsed = stopwatch.elapsed();
+
+    std::vector<FrameDefect> defects;
+    index.findDefects(defects, defectOptions);
+    int frozen = 0, exact = 0, black = 0, shown = 0;
+    for (size_t d = 0; d < defects.size(); d++)
+    {
+      const FrameDefect &defect = defects[d];
+      if (defect.end - defect.start + 1 < minRun)
+        continue;
+      shown++;
+      if (defect.kind == FrameDefect::defectBlack)
+        black += defect.end - defect.start + 1;
+      else
+      {
+        frozen += defect.end - defect.start + 1;
+        exact += defect.exact;
+      }
+    }
+    std::cout << video << ": " << index.getFrames() << " frame(s), " << frozen << " repeated (" << exact
+              << " exactly), " << black << " black, from " << source << " in " << elapsed << " s" << std::endl;
+
+    for (size_t d = 0; d < defects.size() && !options.has("summary"); d++)
+    {
+      const FrameDefect &defect = defects[d];
+      int length = defect.end - defect.start + 1;
+      if (length < minRun)
+        continue;
+      if (defect.kind == FrameDefect::defectBlack)
+        std::cout << "  black  " << defect.start << "-" << defect.end << " (" << length << " frame(s))" << std::endl;
+      else
+        std::cout << "  frozen " << defect.start << "-" << defect.end << " (" << length << " frame(s), "
+                  << defect.exact << " exact repeat(s) of the previous frame)" << std::endl;
+    }
+  }
+  return failed ? 1 : 0;
+}
+
+namespace {
+  /** Fingerprints a video, a frame pack (.vmp) or a dump directory, or loads
+    * a saved .fingerprints file
+    */
+  bool fingerprintSource(const std::string &source, int threads, FrameFingerprints &fingerprints, int &decoded)
+  {
+    decoded = 0;
+    std::string::size_type dot = source.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : source.substr(dot);
+    std::vector<std::string> files, dirs;
+    if (extension == ".fingerprints")
+    {
+      if (!fingerprints.load(source))
+      {
+        LOG_ERROR("Cannot read '" << source << "'");
+        return false;
+      }
+      return true;
+    }
+    if (extension == ".vmp")
+      return fingerprints.buildFromPack(source);
+    if (listDir(source, files, dirs))
+      return fingerprints.buildFromDump(source);
+
+    VideoPassStatistics stats;
+    if (!fingerprints.build(source, threads, &stats))
+    {
+      LOG_ERROR("Cannot decode '" << source << "'");
+      return false;
+    }
+    decoded = stats.frames;
+    return true;
+  }
+}
+
+int runFingerprint(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  int threads = options.getInt("threads", 0);
+
+  int failed = 0;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    const std::string &source = jobs[i].video;
+    FrameFingerprints fingerprints;
+    Stopwatch stopwatch;
+    int decoded;
+    if (!fingerprintSource(source, threads, fingerprints, decoded))
+    {
+      failed++;
+      continue;
+    }
+    double elapsed = stopwatch.elapsed();
+    std::string fileName = FrameFingerprints::getFileName(source);
+    if (!fingerprints.save(fileName, source))
+    {
+      LOG_ERROR("Cannot write '" << fileName << "'");
+      failed++;
+      continue;
+    }
+    char line[256];
+    sprintf(line, "%d frame(s) in %.2f s", fingerprints.size(), elapsed);
+    std::cout << source << ": " << line;
+    if (decoded && elapsed > 0)
+    {
+      sprintf(line, " (%.1f fps)", decoded / elapsed);
+      std::cout << line;
+    }
+    std::cout << " -> " << fileName << std::endl;
+  }
+  return failed ? 1 : 0;
+}
+
+int runCompareFingerprints(const Options &options)
+{
+  const std::vector<std::string> &args = options.getArgs();
+  if (args.size() != 2)
+  {
+    LOG_ERROR("Exactly two videos, frame packs, dumps or fingerprint files are expected");
+    return 1;
+  }
+  int threads = options.getInt("threads", 0);
+  FrameFingerprints first, second;
+  int decoded;
+  if (!fingerprintSource(args[0], threads, first, decoded) || !fingerprintSource(args[1], threads, second, decoded))
+    return 1;
+
+  FingerprintComparison result;
+  compareFingerprints(first, second, result);
+  std::cout << result.common << " common frame(s), " << result.differing.size() << " differ, "
+            << result.onlyFirst << " only in the first, " << result.onlySecond << " only in the second" << std::endl;
+  int show = std::min((int) result.differing.size(), options.getInt("show", 10));
+  for (int i = 0; i < show; i++)
+    std::cout << "  frame " << result.differing[i] << " differs" << std::endl;
+  if (show < (int) result.differing.size())
+    std::cout << "  ..." << std::endl;
+
+  // frames missing on one side are fine (a dump has only some frames), different ones are not
+  if (result.common == 0)
+  {
+    LOG_ERROR("No common frames");
+    return 1;
+  }
+  return result.differing.empty() ? 0 : 1;
+}
+
+int runPropose(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+
+  ActivityOptions activityOptions;
+  activityOptions.threads = options.getInt("threads", 0);
+  ProposalOptions proposalOptions;
+  proposalOptions.high = options.getDouble("high", 0);
+  proposalOptions.low = options.getDouble("low", 0);
+  proposalOptions.minLength = options.getInt("min-length", proposalOptions.minLength);
+  proposalOptions.maxGap = options.getInt("gap", proposalOptions.maxGap);
+  proposalOptions.margin = options.getInt("margin", proposalOptions.margin);
+  proposalOptions.type = options.getInt("type", proposalOptions.type);
+
+  int failed = 0;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    const std::string &video = jobs[i].video;
+    std::vector<float> activity;
+    VideoPassStatistics stats;
+    if (!computeActivity(video, activity, activityOptions, &stats))
+    {
+      LOG_ERROR("Cannot compute the activity of '" << video << "'");
+      failed++;
+      continue;
+    }
+    video_markup::Markup proposals;
+    double high, low;
+    if (!proposeIntervals(activity, proposalOptions, proposals, &high, &low))
+    {
+      LOG_ERROR("Cannot propose intervals for '" << video << "'");
+      failed++;
+      continue;
+    }
+    std::string proposalsName = MarkedVideo::getProposalsName(video);
+    if (!proposals.save(proposalsName.c_str()))
+    {
+      LOG_ERROR("Cannot save '" << proposalsName << "'");
+      failed++;
+      continue;
+    }
+
+    // speed relative to playback tells whether proposing beats watching
+    VideoInfo info;
+    double fps = stats.time > 0 ? stats.frames / stats.time : 0;
+    char line[256];
+    sprintf(line, "%d frame(s), %d proposal(s), thresholds %.2f/%.2f, %.1f fps", (int) activity.size(),
+            (int) proposals.size(), high, low, fps);
+    std::cout << video << ": " << line;
+    if (probeVideo(video.c_str(), info) && info.fps > 0)
+    {
+      sprintf(line, " (%.1fx real time)", fps / info.fps);
+      std::cout << line;
+    }
+    std::cout << std::endl;
+
+    if (options.has("activity"))
+    {
+      std::string activityName = video + options.get("activity");
+      FILE *fp = fopen(activityName.c_str(), "w");
+      if (!fp)
+      {
+        LOG_ERROR("Cannot write '" << activityName << "'");
+        failed++;
+        continue;
+      }
+      for (size_t t = 0; t < activity.size(); t++)
+        fprintf(fp, "%d\t%.3f\n", (int) t, activity[t]);
+      fclose(fp);
+    }
+  }
+  return failed ? 1 : 0;
+}
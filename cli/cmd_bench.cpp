@@ -0,0 +1,558 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <memory>
+#include <sstream>
+
+#include <videoreader.h>
+#include <pugixml.hpp>
+
+#include "cli.h"
+#include "frame_writer.h"
+#include "video_markup.h"
+#include "markup_binary.h"
+#include "video_pass.h"
+#include "parallel.h"
+#include "fileutil.h"
+#include "stopwatch.h"
+#include "logger.h"
+
+int runBenchWriters(const Options &options)
+{
+  if (options.getArgs().size() != 1)
+  {
+    LOG_ERROR("Exactly one video is expected");
+    return 1;
+  }
+  const std::string &videoName = options.getArgs()[0];
+  int maxFrames = options.getInt("frames", 200);
+  int quality = options.getInt("quality", 90);
+
+  // frames are decoded beforehand so that only encoding is measured
+  std::vector<FrameRef> frames;
+  VideoReader *reader = createVideoReader(VideoReader::FFMpegReader);
+  if (!reader || !reader->open(videoName.c_str()))
+  {
+    LOG_ERROR("Cannot open video '" << videoName << "'");
+    deleteVideoReader(reader);
+    return 1;
+  }
+  for (FrameRef frame = reader->readNextFrameRef(); !frame.isNull() && (int) frames.size() < maxFrames;
+       frame = reader->readNextFrameRef())
+    frames.push_back(frame);
+  deleteVideoReader(reader);
+  if (frames.empty())
+  {
+    LOG_ERROR("No frames decoded from '" << videoName << "'");
+    return 1;
+  }
+
+  const MinImg &first = *frames[0].get();
+  double rawSize = (double) first.width * first.height * first.channels;
+  LOG_INFO(frames.size() << " frame(s) " << first.width << "x" << first.height << ", raw frame is " << rawSize / 1024 << " KiB");
+
+  std::istringstream formats(options.get("formats", getFrameWriterFormats()));
+  std::string format;
+  int failed = 0;
+  while (formats >> format)
+  {
+    std::auto_ptr<FrameWriter> writer(createFrameWriter(format, quality));
+    if (!writer.get())
+    {
+      LOG_ERROR("Unknown format '" << format << "'");
+      failed++;
+      continue;
+    }
+    std::vector<uint8_t> data;
+    double totalSize = 0;
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+      if (!writer->encode(*frames[i].get(), data))
+      {
+        LOG_ERROR("Failed to encode frame " << i << " as " << format);
+        failed++;
+        break;
+      }
+      totalSize += data.size();
+    }
+    double time = stopwatch.elapsed();
+
+    char line[256];
+    sprintf(line, "%-5s %9.1f fps %8.1f MiB/s (raw) %9.1f KiB/frame %6.3f of raw", format.c_str(),
+            frames.size() / time, frames.size() * rawSize / time / (1 << 20),
+            totalSize / frames.size() / 1024, totalSize / frames.size() / rawSize);
+    LOG_INFO(line);
+  }
+  return failed ? 1 : 0;
+}
+
+namespace {
+  // deterministic and fast, rand() is too coarse on some platforms
+  class Random
+  {
+  public:
+    Random(unsigned seed)
+    : _state(seed)
+    {
+    }
+
+    int next(int range)
+    {
+      _state = _state * 6364136223846793005ULL + 1442695040888963407ULL;
+      return (int) ((_state >> 33) % (unsigned) range);
+    }
+
+  private:
+    unsigned long long _state;
+  };
+
+  int linearFind(const video_markup::Markup &markup, int frame)
+  {
+    for (size_t i = 0; i < markup.size(); i++)
+      if (markup[i].contains(frame))
+        return (int) i;
+    return -1;
+  }
+
+  int linearNext(const video_markup::Markup &markup, int frame)
+  {
+    for (size_t i = 0; i < markup.size(); i++)
+      if (markup[i].start > frame)
+        return (int) i;
+    return -1;
+  }
+
+  int linearPrev(const video_markup::Markup &markup, int frame)
+  {
+    for (int i = (int) markup.size() - 1; i >= 0; i--)
+      if (markup[i].end < frame)
+        return i;
+    return -1;
+  }
+}
+
+int runBenchLookup(const Options &options)
+{
+  int intervalCount = options.getInt("intervals", 1000000);
+  int queries = options.getInt("queries", 10000000);
+  if (intervalCount <= 0 || queries <= 0)
+  {
+    LOG_ERROR("Positive --intervals and --queries are expected");
+    return 1;
+  }
+
+  // intervals of 10..200 frames separated by gaps of 1..300 frames, the way long markups look
+  video_markup::Markup markup;
+  Random random(12345);
+  int frame = random.next(300);
+  for (int i = 0; i < intervalCount; i++)
+  {
+    video_markup::Interval interval;
+    interval.start = frame;
+    interval.end = frame + 10 + random.next(191);
+    markup.push_back(interval);
+    frame = interval.end + 1 + random.next(300);
+  }
+  int totalFrames = frame;
+  LOG_INFO(intervalCount << " interval(s) over " << totalFrames << " frame(s)");
+
+  std::vector<int> frames(std::min(queries, 1 << 20));
+  for (size_t i = 0; i < frames.size(); i++)
+    frames[i] = random.next(totalFrames);
+
+  // results are compared with the plain scans on a few frames
+  int mismatches = 0;
+  for (size_t i = 0; i < 200 && i < frames.size(); i++)
+  {
+    int f = frames[i];
+    if (markup.find(f) != linearFind(markup, f) || markup.isIntervalFrame(f) != (linearFind(markup, f) >= 0))
+      mismatches++;
+    int prev = linearFind(markup, f) >= 0 ? linearFind(markup, f) - 1 : linearPrev(markup, f);
+    if (markup.findNextClosest(f) != linearNext(markup, f) || markup.findPrevClosest(f) != prev)
+      mismatches++;
+  }
+  if (mismatches)
+  {
+    LOG_ERROR(mismatches << " lookup(s) differ from the linear scan");
+    return 1;
+  }
+
+  const char *names[] = {"find", "findNextClosest", "findPrevClosest", "findClosest", "isIntervalFrame", "sequential"};
+  long checksum = 0;
+  for (int test = 0; test < 6; test++)
+  {
+    Stopwatch stopwatch;
+    for (int q = 0; q < queries; q++)
+    {
+      int f = frames[q & (frames.size() - 1)];
+      switch (test)
+      {
+      case 0: checksum += markup.find(f); break;
+      case 1: checksum += markup.findNextClosest(f); break;
+      case 2: checksum += markup.findPrevClosest(f); break;
+      case 3: checksum += markup.findClosest(f); break;
+      case 4: checksum += markup.isIntervalFrame(f); break;
+      // what the GUI does during playback
+      default: checksum += markup.find(q % totalFrames); break;
+      }
+    }
+    double time = stopwatch.elapsed();
+    char line[128];
+    sprintf(line, "%-16s %8.1f ns per lookup", names[test], time * 1e9 / queries);
+    LOG_INFO(line);
+  }
+  LOG_DEBUG("checksum " << checksum);
+  return 0;
+}
+
+namespace {
+  // pugixml allocations are counted to find the memory taken by the parser
+  size_t g_pugiCurrent = 0;
+  size_t g_pugiPeak = 0;
+
+  void *countingAllocate(size_t size)
+  {
+    size_t *block = (size_t *) malloc(size + sizeof(size_t) * 2);
+    if (!block)
+      return 0;
+    block[0] = size;
+    g_pugiCurrent += size;
+    g_pugiPeak = std::max(g_pugiPeak, g_pugiCurrent);
+    return block + 2;
+  }
+
+  void countingDeallocate(void *ptr)
+  {
+    if (!ptr)
+      return;
+    size_t *block = (size_t *) ptr - 2;
+    g_pugiCurrent -= block[0];
+    free(block);
+  }
+
+  // markup input/output through a pugixml document, the way it used to be done
+  bool domSave(const video_markup::Markup &markup, const char *fileName)
+  {
+    pugi::xml_document doc;
+    pugi::xml_node root = doc.append_child("video_markup");
+    if (markup.getStartFrame() > 0)
+      root.append_attribute("start_frame") = markup.getStartFrame();
+    if (markup.getEndFrame() > 0)
+      root.append_attribute("end_frame") = markup.getEndFrame();
+    for (size_t k = 0; k < markup.size(); k++)
+    {
+      const video_markup::Interval &interval = markup[k];
+      pugi::xml_node i = root.append_child("interval");
+      i.append_attribute("start") = interval.start;
+      i.append_attribute("end") = interval.end;
+      i.append_attribute("type") = interval.type;
+      i.append_attribute("y_border") = interval.y_border;
+      if (!interval.comment.empty())
+        i.append_child("comment").text() = interval.comment.c_str();
+      for (video_markup::Interval::Labels::const_iterator label = interval.labels.begin(); label != interval.labels.end(); ++label)
+        i.append_child("label").text() = label->c_str();
+    }
+    return doc.save_file(fileName);
+  }
+
+  bool domLoad(video_markup::Markup &markup, const char *fileName)
+  {
+    pugi::xml_document doc;
+    if (!doc.load_file(fileName))
+      return false;
+    pugi::xml_node root = doc.document_element();
+    std::vector<video_markup::Interval> intervals;
+    for (pugi::xml_node i = root.child("interval"); i; i = i.next_sibling("interval"))
+    {
+      if (!i.attribute("start") || !i.attribute("end") || !i.attribute("type") || !i.attribute("y_border"))
+        return false;
+      video_markup::Interval interval;
+      interval.start    = i.attribute("start").as_int();
+      interval.end      = i.attribute("end").as_int();
+      interval.type     = i.attribute("type").as_int();
+      interval.y_border = i.attribute("y_border").as_int();
+      interval.comment = i.child("comment").text().as_string();
+      for (pugi::xml_node l = i.child("label"); l; l = l.next_sibling("label"))
+        interval.labels.insert(l.text().as_string());
+      intervals.push_back(interval);
+    }
+    return markup.build(intervals);
+  }
+
+  bool sameMarkups(const video_markup::Markup &a, const video_markup::Markup &b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (size_t i = 0; i < a.size(); i++)
+      if (a[i].start != b[i].start || a[i].end != b[i].end || a[i].type != b[i].type
+          || a[i].y_border != b[i].y_border || a[i].comment != b[i].comment || a[i].labels != b[i].labels)
+        return false;
+    return true;
+  }
+
+  bool readWholeFile(const std::string &fileName, std::string &contents)
+  {
+    FILE *fp = fopen(fileName.c_str(), "rb");
+    if (!fp)
+      return false;
+    char buf[65536];
+    size_t size;
+    contents.clear();
+    while ((size = fread(buf, 1, sizeof(buf), fp)) > 0)
+      contents.append(buf, size);
+    fclose(fp);
+    return true;
+  }
+}
+
+int runBenchMarkup(const Options &options)
+{
+  int intervalCount = options.getInt("intervals", 200000);
+  std::string fileName = options.get("file", "bench_markup.xml");
+  std::string domFileName = fileName + ".dom";
+
+  // a long markup with comments (some of them needing escapes) and labels
+  static const char *labels[] = {"bad", "interesting", "night", "rain"};
+  std::vector<video_markup::Interval> intervals(intervalCount);
+  Random random(54321);
+  int frame = 0;
+  for (int i = 0; i < intervalCount; i++)
+  {
+    video_markup::Interval &interval = intervals[i];
+    interval.start = frame + 1 + random.next(300);
+    interval.end = interval.start + 10 + random.next(191);
+    interval.type = 1 + random.next(4);
+    interval.y_border = random.next(480);
+    std::ostringstream comment;
+    comment << "episode " << i << (random.next(10) == 0 ? " <car & bus>" : "");
+    interval.comment = comment.str();
+    for (int l = random.next(3); l > 0; l--)
+      interval.labels.insert(labels[random.next(4)]);
+    frame = interval.end;
+  }
+  video_markup::Markup markup;
+  markup.build(intervals);
+
+  pugi::allocation_function oldAllocate = pugi::get_memory_allocation_function();
+  pugi::deallocation_function oldDeallocate = pugi::get_memory_deallocation_function();
+  pugi::set_memory_management_functions(countingAllocate, countingDeallocate);
+
+  Stopwatch stopwatch;
+  bool ok = markup.save(fileName.c_str());
+  double saveTime = stopwatch.elapsed();
+  size_t savePeak = g_pugiPeak;
+
+  g_pugiPeak = g_pugiCurrent = 0;
+  stopwatch.restart();
+  ok = domSave(markup, domFileName.c_str()) && ok;
+  double domSaveTime = stopwatch.elapsed();
+  size_t domSavePeak = g_pugiPeak;
+
+  std::string saved, domSaved;
+  if (!ok || !readWholeFile(fileName, saved) || !readWholeFile(domFileName, domSaved))
+  {
+    pugi::set_memory_management_functions(oldAllocate, oldDeallocate);
+    LOG_ERROR("Failed to save '" << fileName << "'");
+    return 1;
+  }
+
+  video_markup::Markup loaded, domLoaded;
+  g_pugiPeak = g_pugiCurrent = 0;
+  stopwatch.restart();
+  ok = loaded.load(fileName.c_str());
+  double loadTime = stopwatch.elapsed();
+  // the document is parsed in the file buffer, which is not allocated through pugixml
+  size_t loadPeak = g_pugiPeak + saved.size();
+
+  g_pugiPeak = g_pugiCurrent = 0;
+  stopwatch.restart();
+  ok = domLoad(domLoaded, fileName.c_str()) && ok;
+  double domLoadTime = stopwatch.elapsed();
+  size_t domLoadPeak = g_pugiPeak;
+  pugi::set_memory_management_functions(oldAllocate, oldDeallocate);
+  remove(domFileName.c_str());
+
+  LOG_INFO(intervalCount << " interval(s), " << saved.size() / 1048576.0 << " MiB of XML");
+  char line[160];
+  sprintf(line, "save: %8.1f ms, %8.1f MiB parser memory (document tree: %8.1f ms, %8.1f MiB)",
+          saveTime * 1000, savePeak / 1048576.0, domSaveTime * 1000, domSavePeak / 1048576.0);
+  LOG_INFO(line);
+  sprintf(line, "load: %8.1f ms, %8.1f MiB parser memory (document tree: %8.1f ms, %8.1f MiB)",
+          loadTime * 1000, loadPeak / 1048576.0, domLoadTime * 1000, domLoadPeak / 1048576.0);
+  LOG_INFO(line);
+
+  if (saved != domSaved)
+  {
+    LOG_ERROR("Saved file differs from the one saved through the document tree");
+    return 1;
+  }
+  if (!ok || !sameMarkups(markup, loaded) || !sameMarkups(markup, domLoaded))
+  {
+    LOG_ERROR("Loaded markup differs from the saved one");
+    return 1;
+  }
+
+  // the same markup in the binary format
+  std::string binaryName = fileName + ".vmb";
+  stopwatch.restart();
+  ok = video_markup::saveBinaryMarkup(markup, binaryName.c_str());
+  double binarySaveTime = stopwatch.elapsed();
+  video_markup::Markup binaryLoaded;
+  stopwatch.restart();
+  ok = ok && video_markup::loadMarkupFile(binaryLoaded, binaryName.c_str());
+  double binaryLoadTime = stopwatch.elapsed();
+  video_markup::BinaryMarkupView view;
+  stopwatch.restart();
+  ok = ok && view.open(binaryName);
+  double viewOpenTime = stopwatch.elapsed();
+  int64_t binarySize = getFileSize(binaryName);
+  view.close();
+  remove(binaryName.c_str());
+
+  sprintf(line, "binary: %.1f MiB, save %.1f ms, load %.1f ms, read-only mapping %.1f ms",
+          binarySize / 1048576.0, binarySaveTime * 1000, binaryLoadTime * 1000, viewOpenTime * 1000);
+  LOG_INFO(line);
+  if (!ok || !sameMarkups(markup, binaryLoaded))
+  {
+    LOG_ERROR("Binary markup differs from the saved one");
+    return 1;
+  }
+
+  // label filters: by name (a dictionary lookup per test) and by id (a bit test)
+  int byName = 0, byId = 0;
+  stopwatch.restart();
+  for (size_t i = 0; i < markup.size(); i++)
+    byName += markup[i].hasLabel("night");
+  double byNameTime = stopwatch.elapsed();
+  stopwatch.restart();
+  int night = video_markup::LabelSet::lookup("night");
+  for (size_t i = 0; i < markup.size(); i++)
+    byId += markup[i].labels.has(night);
+  double byIdTime = stopwatch.elapsed();
+  sprintf(line, "labels: %d byte(s) per interval, filter by name %.2f ms, by id %.2f ms",
+          (int) sizeof(video_markup::Interval), byNameTime * 1000, byIdTime * 1000);
+  LOG_INFO(line);
+  if (byName != byId)
+  {
+    LOG_ERROR("Label filters disagree");
+    return 1;
+  }
+  return 0;
+}
+
+namespace {
+  // hashData() of the pixels of every frame, the simplest whole video pass
+  class ChecksumPass: public VideoPass
+  {
+  public:
+    class ChecksumChunk: public Chunk
+    {
+    public:
+      virtual bool process(int, const MinImg &image)
+      {
+        uint64_t hash = hashData(0, 0);
+        for (int y = 0; y < image.height; y++)
+          hash = hashData(image.pScan0 + (size_t) y * image.stride, image.width * image.channels * image.channelDepth, hash);
+        sums.push_back(hash);
+        return true;
+      }
+
+      std::vector<uint64_t> sums;
+    };
+
+    virtual Chunk *createChunk(int, int)
+    {
+      return new ChecksumChunk;
+    }
+
+    virtual void merge(Chunk &chunk)
+    {
+      const std::vector<uint64_t> &sums = static_cast<ChecksumChunk &>(chunk).sums;
+      _sums.insert(_sums.end(), sums.begin(), sums.end());
+    }
+
+    const std::vector<uint64_t> &getSums() const
+    {
+      return _sums;
+    }
+
+  private:
+    std::vector<uint64_t> _sums;
+  };
+}
+
+int runBenchAnalysis(const Options &options)
+{
+  if (options.getArgs().size() != 1)
+  {
+    LOG_ERROR("Exactly one video is expected");
+    return 1;
+  }
+  const std::string &videoName = options.getArgs()[0];
+  std::ostringstream defaultThreads;
+  defaultThreads << "1," << getHardwareThreads();
+  std::string threadList = options.get("threads", defaultThreads.str().c_str());
+  for (size_t i = 0; i < threadList.size(); i++)
+    if (threadList[i] == ',')
+      threadList[i] = ' ';
+
+  // every run must give the same checksums as the first (single threaded, as a rule) one
+  std::vector<uint64_t> reference;
+  double referenceTime = 0;
+  std::istringstream threads(threadList);
+  int count;
+  int failed = 0;
+  while (threads >> count)
+  {
+    VideoPassOptions passOptions;
+    passOptions.threads = count;
+    passOptions.minChunkFrames = options.getInt("chunk", passOptions.minChunkFrames);
+    ChecksumPass pass;
+    VideoPassStatistics stats;
+    if (!runVideoPass(videoName, pass, passOptions, &stats))
+    {
+      LOG_ERROR("Pass on " << count << " thread(s) failed");
+      failed++;
+      continue;
+    }
+    const char *verdict = "";
+    if (reference.empty())
+    {
+      reference = pass.getSums();
+      referenceTime = stats.time;
+    }
+    else if (pass.getSums() != reference)
+    {
+      verdict = ", checksums DIFFER";
+      failed++;
+    }
+    char line[256];
+    sprintf(line, "%2d thread(s) %3d chunk(s) %6d frame(s) %8.1f fps, speedup %5.2f%s", count, stats.chunks,
+            stats.frames, stats.frames / stats.time, referenceTime / stats.time, verdict);
+    LOG_INFO(line);
+  }
+  return failed ? 1 : 0;
+}
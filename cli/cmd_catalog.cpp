@@ -0,0 +1,139 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <iostream>
+#include <map>
+
+#include "cli.h"
+#include "corpus_catalog.h"
+#include "fileutil.h"
+#include "stopwatch.h"
+#include "logger.h"
+
+namespace {
+  void splitList(const std::string &list, std::vector<std::string> &items)
+  {
+    size_t begin = 0;
+    while (begin <= list.size())
+    {
+      size_t end = list.find(',', begin);
+      if (end == std::string::npos)
+        end = list.size();
+      if (end > begin)
+        items.push_back(list.substr(begin, end - begin));
+      begin = end + 1;
+    }
+  }
+
+  void printCatalog(std::ostream &os, const std::vector<CatalogEntry> &entries, bool perFile)
+  {
+    long videos = 0, markups = 0, broken = 0, intervals = 0, comments = 0;
+    int64_t frames = 0, intervalFrames = 0;
+    std::map<int, long> types;
+    std::map<std::string, long> labels;
+    std::map<std::string, long> codecs;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+      const CatalogEntry &entry = entries[i];
+      videos++;
+      if (entry.videoOk)
+      {
+        if (entry.totalFrames > 0)
+          frames += entry.totalFrames;
+        codecs[entry.codec]++;
+      }
+      else
+        broken++;
+      if (entry.markupOk)
+      {
+        markups++;
+        intervals += entry.intervals;
+        intervalFrames += entry.intervalFrames;
+        comments += entry.comments;
+        for (size_t k = 0; k < entry.types.size(); k++)
+          types[entry.types[k].first] += entry.types[k].second;
+        for (size_t k = 0; k < entry.labels.size(); k++)
+          labels[entry.labels[k].first] += entry.labels[k].second;
+      }
+      if (perFile)
+      {
+        os << entry.video << ": ";
+        if (entry.videoOk)
+          os << entry.width << "x" << entry.height << " " << entry.codec << ", " << entry.totalFrames << " frame(s)";
+        else
+          os << "unreadable";
+        if (entry.markupOk)
+          os << ", " << entry.intervals << " interval(s)";
+        else if (entry.markupSize >= 0)
+          os << ", invalid markup";
+        os << std::endl;
+      }
+    }
+
+    os << "videos:    " << videos << " (" << markups << " with markup, " << broken << " unreadable)" << std::endl;
+    os << "frames:    " << frames << std::endl;
+    os << "intervals: " << intervals << " (" << intervalFrames << " frame(s), " << comments << " comment(s))" << std::endl;
+    for (std::map<std::string, long>::const_iterator it = codecs.begin(); it != codecs.end(); ++it)
+      os << "codec " << it->first << ": " << it->second << std::endl;
+    for (std::map<int, long>::const_iterator it = types.begin(); it != types.end(); ++it)
+      os << "type " << it->first << ":    " << it->second << std::endl;
+    for (std::map<std::string, long>::const_iterator it = labels.begin(); it != labels.end(); ++it)
+      os << "label " << it->first << ": " << it->second << std::endl;
+  }
+}
+
+int runCatalog(const Options &options)
+{
+  std::string fileName = options.get("file", "video_marker.catalog");
+  CorpusCatalog catalog;
+  std::string error;
+  if (getFileSize(fileName) >= 0 && !catalog.load(fileName, &error))
+  {
+    // a damaged catalog is only a cache, it is built anew
+    LOG_WARNING("Catalog '" << fileName << "' is not loaded (" << error << ")");
+    if (options.getArgs().empty())
+      return 1;
+  }
+
+  if (!options.getArgs().empty())
+  {
+    std::vector<std::string> extensions;
+    splitList(options.get("ext", ".avi"), extensions);
+    for (size_t i = 0; i < extensions.size(); i++)
+      if (extensions[i][0] != '.')
+        extensions[i] = "." + extensions[i];
+
+    Stopwatch stopwatch;
+    CorpusCatalog::RefreshStats stats = catalog.refresh(options.getArgs(), extensions, options.getInt("jobs", 0));
+    LOG_INFO(stats.videos << " video(s) found, " << stats.read << " read (" << stats.failed << " unreadable), "
+             << stats.removed << " removed in " << stopwatch.elapsed() << " s");
+    if (!catalog.save(fileName))
+    {
+      LOG_ERROR("Failed to save catalog to '" << fileName << "'");
+      return 1;
+    }
+  }
+  printCatalog(std::cout, catalog.getEntries(), options.has("per-file"));
+  return 0;
+}
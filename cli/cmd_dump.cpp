@@ -0,0 +1,182 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <memory>
+
+#include "cli.h"
+#include "parallel.h"
+#include "markedvideo.h"
+#include "frame_writer.h"
+#include "fileutil.h"
+#include "dump_plan.h"
+#include "logger.h"
+
+namespace {
+
+  class DumpTask: public ParallelTask
+  {
+  public:
+    /** @param[in] format Image format, "vmp" for frame packs or "clip" for stream copied video clips
+      */
+    DumpTask(const std::vector<VideoJob> &jobs, const DumpOptions &options, const std::string &format, int quality)
+    : _jobs(jobs),
+      _options(options),
+      _format(format),
+      _quality(quality),
+      _failed(jobs.size(), 0)
+    {
+    }
+
+    virtual void run(int index)
+    {
+      const VideoJob &job = _jobs[index];
+      MarkedVideo video;
+      video.setAutoLoadMarkup(false);
+      if (!video.loadVideo(job.video, job.markup.c_str()) || video.getMarkupName().empty())
+      {
+        LOG_ERROR("Skipping '" << job.video << "'");
+        _failed[index] = 1;
+        return;
+      }
+
+      DumpOptions options = _options;
+      options.prefix = MarkedVideo::getShortName(job.video);
+      DumpPlan plan;
+      plan.build(video.getMarkup(), options.margin, video.getTotalFrames());
+      DumpStatistics stats;
+      bool ok;
+      if (_format == "clip")
+        ok = video.exportClips(plan, options, &stats);
+      else if (_format == "vmp")
+        ok = video.dumpPack(plan, options, &stats);
+      else
+      {
+        std::auto_ptr<FrameWriter> writer(createFrameWriter(_format, _quality));
+        ok = writer.get() && video.dump(plan, options, *writer, &stats);
+      }
+      if (!ok)
+      {
+        LOG_ERROR("Failed to dump '" << job.video << "'");
+        _failed[index] = 1;
+        return;
+      }
+      // what was actually done: resumed dumps skip saved files, shared frames are only linked
+      LOG_INFO("Dumped " << plan.getItems().size() << " interval(s) of '" << job.video << "': "
+               << stats.written << " frame(s) written, " << stats.linked << " file(s) linked, "
+               << stats.skipped << " skipped as already saved");
+    }
+
+    /** @return 1 if some video failed (error is logged), 0 otherwise
+      */
+    int getExitCode() const
+    {
+      int failed = 0;
+      for (size_t i = 0; i < _failed.size(); i++)
+        failed += _failed[i];
+      if (failed)
+        LOG_ERROR(failed << " of " << _jobs.size() << " video(s) failed");
+      return failed ? 1 : 0;
+    }
+
+  private:
+    const std::vector<VideoJob> &_jobs;
+    DumpOptions _options;
+    std::string _format;
+    int _quality;
+    std::vector<int> _failed;   // not vector<bool> since items are written from different threads
+  };
+}
+
+int runDump(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  DumpOptions dumpOptions;
+  dumpOptions.directory = options.get("out", ".");
+  dumpOptions.margin = options.getInt("margin", dumpOptions.margin);
+  dumpOptions.perIntervalDirs = options.has("per-interval");
+  dumpOptions.resume = options.has("resume");
+  dumpOptions.verify = options.has("verify");
+  std::string format = options.get("format", "ppm");
+  int quality = options.getInt("quality", 90);
+  std::auto_ptr<FrameWriter> writer(createFrameWriter(format, quality));
+  if (!writer.get() && format != "vmp")
+  {
+    LOG_ERROR("Unknown format '" << format << "', available formats: " << getFrameWriterFormats() << " vmp");
+    return 1;
+  }
+  if (!AsyncFileWriter::parseBackend(options.get("io", "auto"), dumpOptions.io))
+  {
+    LOG_ERROR("Unknown io '" << options.get("io", "") << "', expected auto, uring or threads");
+    return 1;
+  }
+  if (options.has("crop") && !dumpOptions.parseCrop(options.get("crop", "")))
+  {
+    LOG_ERROR("Invalid crop '" << options.get("crop", "") << "', expected X,Y,W,H or X,Y,W,H,border");
+    return 1;
+  }
+  if (options.has("size") && !dumpOptions.parseOutputSize(options.get("size", "")))
+  {
+    LOG_ERROR("Invalid size '" << options.get("size", "") << "', expected WxH");
+    return 1;
+  }
+  if (!makeDir(dumpOptions.directory))
+  {
+    LOG_ERROR("Cannot create directory '" << dumpOptions.directory << "'");
+    return 1;
+  }
+
+  // videos are dumped in parallel and every dump runs its own encoders, so
+  // by default the cores are shared between the videos processed at once
+  int parallelJobs = options.getInt("jobs", 0);
+  if (parallelJobs <= 0)
+    parallelJobs = getHardwareThreads();
+  parallelJobs = std::min(parallelJobs, (int) jobs.size());
+  dumpOptions.threads = options.getInt("threads", std::max(1, getHardwareThreads() / std::max(1, parallelJobs)));
+
+  DumpTask task(jobs, dumpOptions, format, quality);
+  runParallel(task, (int) jobs.size(), parallelJobs);
+  return task.getExitCode();
+}
+
+int runExportClips(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  DumpOptions dumpOptions;
+  dumpOptions.directory = options.get("out", ".");
+  dumpOptions.margin = options.getInt("margin", dumpOptions.margin);
+  if (!makeDir(dumpOptions.directory))
+  {
+    LOG_ERROR("Cannot create directory '" << dumpOptions.directory << "'");
+    return 1;
+  }
+
+  DumpTask task(jobs, dumpOptions, "clip", 0);
+  runParallel(task, (int) jobs.size(), options.getInt("jobs", 0));
+  return task.getExitCode();
+}
@@ -0,0 +1,396 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <iostream>
+#include <sstream>
+#include <map>
+
+#include "cli.h"
+#include "parallel.h"
+#include "markedvideo.h"
+#include "video_markup.h"
+#include "markup_binary.h"
+#include "markup_query.h"
+#include "markup_eval.h"
+#include "fileutil.h"
+#include "logger.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+namespace {
+
+  class ValidateTask: public ParallelTask
+  {
+  public:
+    ValidateTask(const std::vector<VideoJob> &jobs)
+    : _jobs(jobs),
+      _problems(jobs.size())
+    {
+    }
+
+    virtual void run(int index)
+    {
+      const VideoJob &job = _jobs[index];
+      std::vector<std::string> &problems = _problems[index];
+
+      MarkedVideo video;
+      video.setAutoLoadMarkup(false);
+      if (!video.loadVideo(job.video))
+      {
+        problems.push_back("cannot open video");
+        return;
+      }
+      if (!video.loadMarkup(job.markup))
+      {
+        problems.push_back("cannot load markup '" + job.markup + "'");
+        // every offending interval is listed, not only the first one
+        Markup markup;
+        video_markup::loadMarkupFile(markup, job.markup.c_str(), &problems);
+        return;
+      }
+
+      int totalFrames = video.getTotalFrames();
+      int height = video.getCurrentFrame()->height;
+      const Markup &markup = video.getMarkup();
+      if (totalFrames > 0 && markup.getEndFrame() >= totalFrames)
+        problems.push_back("end frame is outside of the video");
+
+      for (unsigned i = 0; i < markup.size(); i++)
+      {
+        const Interval &interval = markup[i];
+        std::ostringstream prefix;
+        prefix << "interval " << i << " [" << interval.start << ", " << interval.end << "]: ";
+        if (totalFrames > 0 && interval.end >= totalFrames)
+          problems.push_back(prefix.str() + "outside of the video");
+        if (interval.type < 1 || interval.type > 4)
+          problems.push_back(prefix.str() + "invalid type");
+        if (interval.y_border < -1 || interval.y_border >= height)
+          problems.push_back(prefix.str() + "y_border is outside of the frame");
+      }
+    }
+
+    int report(std::ostream &os) const
+    {
+      int invalid = 0;
+      for (size_t i = 0; i < _jobs.size(); i++)
+      {
+        if (_problems[i].empty())
+        {
+          os << _jobs[i].video << ": OK" << std::endl;
+          continue;
+        }
+        invalid++;
+        os << _jobs[i].video << ": " << _problems[i].size() << " problem(s)" << std::endl;
+        for (size_t j = 0; j < _problems[i].size(); j++)
+          os << "  " << _problems[i][j] << std::endl;
+      }
+      return invalid;
+    }
+
+  private:
+    const std::vector<VideoJob> &_jobs;
+    std::vector< std::vector<std::string> > _problems;
+  };
+
+  struct MarkupStats
+  {
+    MarkupStats()
+    : files(0),
+      intervals(0),
+      frames(0),
+      comments(0)
+    {
+    }
+
+    void add(const Markup &markup)
+    {
+      files++;
+      intervals += markup.size();
+      for (unsigned i = 0; i < markup.size(); i++)
+      {
+        const Interval &interval = markup[i];
+        frames += interval.end - interval.start + 1;
+        types[interval.type]++;
+        if (!interval.comment.empty())
+          comments++;
+        for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+          labels[*it]++;
+      }
+    }
+
+    void add(const MarkupStats &other)
+    {
+      files += other.files;
+      intervals += other.intervals;
+      frames += other.frames;
+      comments += other.comments;
+      for (std::map<int, long>::const_iterator it = other.types.begin(); it != other.types.end(); ++it)
+        types[it->first] += it->second;
+      for (std::map<std::string, long>::const_iterator it = other.labels.begin(); it != other.labels.end(); ++it)
+        labels[it->first] += it->second;
+    }
+
+    void print(std::ostream &os) const
+    {
+      os << "files:     " << files << std::endl;
+      os << "intervals: " << intervals << std::endl;
+      os << "frames:    " << frames << std::endl;
+      os << "comments:  " << comments << std::endl;
+      for (std::map<int, long>::const_iterator it = types.begin(); it != types.end(); ++it)
+        os << "type " << it->first << ":    " << it->second << std::endl;
+      for (std::map<std::string, long>::const_iterator it = labels.begin(); it != labels.end(); ++it)
+        os << "label " << it->first << ": " << it->second << std::endl;
+    }
+
+    long files;
+    long intervals;
+    long frames;        ///< frames covered by intervals
+    long comments;
+    std::map<int, long> types;
+    std::map<std::string, long> labels;
+  };
+
+  class StatsTask: public ParallelTask
+  {
+  public:
+    StatsTask(const std::vector<VideoJob> &jobs)
+    : _jobs(jobs),
+      _stats(jobs.size()),
+      _failed(jobs.size(), 0)
+    {
+    }
+
+    virtual void run(int index)
+    {
+      Markup markup;
+      if (!video_markup::loadMarkupFile(markup, _jobs[index].markup.c_str()))
+      {
+        LOG_ERROR("Failed to load markup from '" << _jobs[index].markup << "'");
+        _failed[index] = 1;
+        return;
+      }
+      _stats[index].add(markup);
+    }
+
+    int report(std::ostream &os, bool perFile) const
+    {
+      MarkupStats total;
+      int failed = 0;
+      for (size_t i = 0; i < _jobs.size(); i++)
+      {
+        failed += _failed[i];
+        total.add(_stats[i]);
+        if (perFile && !_failed[i])
+          os << _jobs[i].markup << ": " << _stats[i].intervals << " interval(s), "
+             << _stats[i].frames << " frame(s)" << std::endl;
+      }
+      total.print(os);
+      return failed;
+    }
+
+  private:
+    const std::vector<VideoJob> &_jobs;
+    std::vector<MarkupStats> _stats;
+    std::vector<int> _failed;
+  };
+
+  class EvaluateTask: public ParallelTask
+  {
+  public:
+    EvaluateTask(const std::vector<VideoJob> &jobs, const Options &options)
+    : _jobs(jobs),
+      _results(jobs.size()),
+      _failed(jobs.size(), 0),
+      _detectionSuffix(options.get("detections", ".detections.xml")),
+      _mismatchSuffix(options.get("mismatches"))
+    {
+      _options.minIoU = options.getDouble("iou", _options.minIoU);
+      _options.minCoverage = options.getDouble("coverage", _options.minCoverage);
+      _options.matchTypes = !options.has("any-type");
+    }
+
+    virtual void run(int index)
+    {
+      const VideoJob &job = _jobs[index];
+      Markup reference, detected;
+      std::string detectionName = job.video + _detectionSuffix;
+      if (!video_markup::loadMarkupFile(reference, job.markup.c_str()))
+      {
+        LOG_ERROR("Failed to load markup from '" << job.markup << "'");
+        _failed[index] = 1;
+        return;
+      }
+      if (!video_markup::loadMarkupFile(detected, detectionName.c_str()))
+      {
+        LOG_ERROR("Failed to load detections from '" << detectionName << "'");
+        _failed[index] = 1;
+        return;
+      }
+      video_markup::Evaluation &result = _results[index];
+      result.evaluate(reference, detected, _options);
+      if (!_mismatchSuffix.empty())
+      {
+        Markup mismatches;
+        result.makeMismatchMarkup(mismatches);
+        std::string mismatchName = job.video + _mismatchSuffix;
+        if (!video_markup::saveMarkupFile(mismatches, mismatchName.c_str()))
+        {
+          LOG_ERROR("Failed to save mismatches to '" << mismatchName << "'");
+          _failed[index] = 1;
+        }
+      }
+      // the list is only needed for the mismatch markup
+      std::vector<video_markup::Mismatch>().swap(result.mismatches);
+    }
+
+    int report(std::ostream &os, bool perFile) const
+    {
+      video_markup::Evaluation total;
+      int failed = 0;
+      for (size_t i = 0; i < _jobs.size(); i++)
+      {
+        failed += _failed[i];
+        if (_failed[i])
+          continue;
+        total.add(_results[i]);
+        const video_markup::EvaluationCounts &counts = _results[i].total;
+        if (perFile)
+          os << _jobs[i].video << ": " << counts.truePositives << " matched, " << counts.falseNegatives
+             << " missed, " << counts.falsePositives << " false alarm(s)" << std::endl;
+      }
+      total.print(os);
+      return failed;
+    }
+
+  private:
+    const std::vector<VideoJob> &_jobs;
+    std::vector<video_markup::Evaluation> _results;
+    std::vector<int> _failed;
+    video_markup::EvaluationOptions _options;
+    std::string _detectionSuffix;
+    std::string _mismatchSuffix;
+  };
+}
+
+int runValidate(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  ValidateTask task(jobs);
+  runParallel(task, (int) jobs.size(), options.getInt("jobs", 0));
+  return task.report(std::cout) ? 1 : 0;
+}
+
+int runStats(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  StatsTask task(jobs);
+  runParallel(task, (int) jobs.size(), options.getInt("jobs", 0));
+  return task.report(std::cout, options.has("per-file")) ? 1 : 0;
+}
+
+int runEvaluate(const Options &options)
+{
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+  EvaluateTask task(jobs, options);
+  runParallel(task, (int) jobs.size(), options.getInt("jobs", 0));
+  return task.report(std::cout, options.has("per-file")) ? 1 : 0;
+}
+
+int runConvertMarkup(const Options &options)
+{
+  const std::vector<std::string> &args = options.getArgs();
+  if (args.size() != 2)
+  {
+    LOG_ERROR("Input and output markup names are expected");
+    return 1;
+  }
+  Markup markup;
+  std::vector<std::string> errors;
+  if (!video_markup::loadMarkupFile(markup, args[0].c_str(), &errors))
+  {
+    for (size_t i = 0; i < errors.size(); i++)
+      LOG_ERROR(errors[i]);
+    LOG_ERROR("Failed to load markup from '" << args[0] << "'");
+    return 1;
+  }
+  if (!video_markup::saveMarkupFile(markup, args[1].c_str()))
+  {
+    LOG_ERROR("Failed to save markup to '" << args[1] << "'");
+    return 1;
+  }
+  LOG_INFO(markup.size() << " interval(s) converted, " << getFileSize(args[0]) << " -> "
+           << getFileSize(args[1]) << " bytes");
+  return 0;
+}
+
+int runQuery(const Options &options)
+{
+  video_markup::MarkupQuery query;
+  std::string error;
+  if (!query.parse(options.get("where"), &error))
+  {
+    LOG_ERROR("Invalid query: " << error);
+    return 1;
+  }
+  std::vector<VideoJob> jobs;
+  if (!collectJobs(options, jobs))
+    return 1;
+
+  int failed = 0;
+  long total = 0;
+  std::vector<int> starts;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    Markup markup;
+    if (!video_markup::loadMarkupFile(markup, jobs[i].markup.c_str()))
+    {
+      LOG_ERROR("Failed to load markup from '" << jobs[i].markup << "'");
+      failed++;
+      continue;
+    }
+    query.run(markup, starts);
+    for (size_t k = 0; k < starts.size(); k++)
+    {
+      int id = markup.find(starts[k]);
+      const Interval &interval = markup[id];
+      std::cout << jobs[i].markup << ": interval " << id << " [" << interval.start << ", " << interval.end
+                << "] type " << interval.type;
+      for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+        std::cout << " " << *it;
+      if (!interval.comment.empty())
+        std::cout << " \"" << interval.comment << "\"";
+      std::cout << std::endl;
+    }
+    total += starts.size();
+  }
+  LOG_INFO(total << " interval(s) found");
+  return failed ? 1 : 0;
+}
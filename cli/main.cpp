@@ -0,0 +1,116 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <iostream>
+
+#include "cli.h"
+#include "logger.h"
+
+static const Command g_commands[] =
+{
+  { "dump", "[--out=DIR] [--margin=N] [--per-interval] [--format=ppm|pgm|qoi|jpg|vmp] [--quality=N] [--crop=X,Y,W,H[,border]] [--size=WxH] [--io=auto|uring|threads] [--resume [--verify]] [--jobs=N] [--threads=N] [--list=FILE] VIDEO...",
+    "Dump frames of all intervals as images (in one pass over each video)", "out margin per-interval format quality crop size io resume verify jobs threads list", runDump },
+  { "export-clips", "[--out=DIR] [--margin=N] [--jobs=N] [--list=FILE] VIDEO...",
+    "Export intervals as video clips without re-encoding (exact borders go to clip markups)", "out margin jobs list", runExportClips },
+  { "validate", "[--jobs=N] [--list=FILE] VIDEO...",
+    "Check markups against their videos", "jobs list", runValidate },
+  { "stats", "[--per-file] [--jobs=N] [--list=FILE] VIDEO...",
+    "Print markup statistics (videos are not opened)", "per-file jobs list", runStats },
+  { "evaluate", "[--detections=SUFFIX] [--iou=X] [--coverage=X] [--any-type] [--mismatches=SUFFIX] [--per-file] [--jobs=N] [--list=FILE] VIDEO...",
+    "Compare detections (VIDEO + SUFFIX, default .detections.xml) with markups: precision and recall", "detections iou coverage any-type mismatches per-file jobs list", runEvaluate },
+  { "convert-markup", "INPUT OUTPUT",
+    "Convert a markup between XML and binary (OUTPUT ending with .vmb) formats", "", runConvertMarkup },
+  { "query", "--where=QUERY [--list=FILE] VIDEO...",
+    "Print intervals selected by a query (labels, -label, type:N,M, comment:text, frames:A-B)", "where list", runQuery },
+  { "catalog", "[--file=NAME] [--ext=LIST] [--per-file] [--jobs=N] [DIR...]",
+    "Refresh the catalog of videos found in the directories and print a summary of the corpus", "file ext per-file jobs", runCatalog },
+  { "slit-scan", "[--height=N] [--image=SUFFIX] [--rebuild] [--threads=N] VIDEO...",
+    "Make (or refresh) the cached time-slice strip of the center line, optionally saving it as a PPM image (VIDEO + SUFFIX)", "height image rebuild threads", runSlitScan },
+  { "propose", "[--high=X] [--low=X] [--min-length=N] [--gap=N] [--margin=N] [--type=N] [--activity=SUFFIX] [--threads=N] [--list=FILE] VIDEO...",
+    "Propose intervals where the center line is active and save them as VIDEO.proposals.xml for the GUI", "high low min-length gap margin type activity threads list", runPropose },
+  { "motion", "[--threshold=X] [--min-run=N] [--rebuild] [--threads=N] VIDEO...",
+    "Make (or refresh) the cached motion track used by skip-static playback and count the static frames", "threshold min-run rebuild threads", runMotion },
+  { "defects", "[--near=X] [--black=N] [--min-run=N] [--summary] [--rebuild] [--threads=N] [--list=FILE] VIDEO...",
+    "Index frame fingerprints (cached as VIDEO.defects) and report repeated (frozen) and black frames", "near black min-run summary rebuild threads list", runDefects },
+  { "fingerprint", "[--threads=N] [--list=FILE] SOURCE...",
+    "Save fingerprints of the frames of videos, frame packs (.vmp) or PPM dump directories as SOURCE.fingerprints", "threads list", runFingerprint },
+  { "compare-fingerprints", "[--show=N] [--threads=N] SOURCE SOURCE",
+    "Compare frame fingerprints of two videos, frame packs, dumps or .fingerprints files; fails if a common frame differs", "show threads", runCompareFingerprints },
+  { "bench-writers", "[--frames=N] [--formats=LIST] [--quality=N] VIDEO",
+    "Compare speed and size of dump formats on the first frames of a video", "frames formats quality", runBenchWriters },
+  { "bench-lookup", "[--intervals=N] [--queries=N]",
+    "Measure interval lookup time on a generated markup", "intervals queries", runBenchLookup },
+  { "bench-markup", "[--intervals=N] [--file=NAME]",
+    "Measure markup save and load time on a generated markup", "intervals file", runBenchMarkup },
+  { "bench-analysis", "[--threads=LIST] [--chunk=N] VIDEO",
+    "Measure a key frame parallel pass (frame checksums) over a video on different numbers of threads", "threads chunk", runBenchAnalysis },
+};
+
+static const int g_commandCount = sizeof(g_commands) / sizeof(g_commands[0]);
+
+static void usage()
+{
+  std::cerr << "usage: video_marker_cli COMMAND [OPTIONS] [ARGUMENTS]" << std::endl << std::endl;
+  for (int i = 0; i < g_commandCount; i++)
+  {
+    std::cerr << "  " << g_commands[i].name << " " << g_commands[i].arguments << std::endl;
+    std::cerr << "      " << g_commands[i].description << std::endl;
+  }
+  std::cerr << std::endl
+            << "Markup of VIDEO is looked for in VIDEO.xml. A list file contains one video per line," << std::endl
+            << "optionally followed by a tab and the markup name. --jobs=0 (default) uses all CPU cores." << std::endl
+            << "--verbose enables debug output." << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))
+  {
+    usage();
+    return argc < 2 ? 1 : 0;
+  }
+
+  const Command *command = 0;
+  for (int i = 0; i < g_commandCount; i++)
+    if (!strcmp(argv[1], g_commands[i].name))
+      command = &g_commands[i];
+  if (!command)
+  {
+    std::cerr << "Unknown command '" << argv[1] << "'" << std::endl;
+    usage();
+    return 1;
+  }
+
+  Options options;
+  if (!options.parse(argc, argv, 2))
+    return 1;
+
+  Logger::Format() = 0;
+  Logger::SetLogLevel(options.has("verbose") ? Logger::debug : Logger::info);
+  if (!options.check((std::string(command->options) + " verbose").c_str()))
+    return 1;
+
+  return command->run(options);
+}
@@ -0,0 +1,156 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "cli.h"
+#include "markedvideo.h"
+#include "logger.h"
+
+bool Options::parse(int argc, char **argv, int first)
+{
+  bool onlyArgs = false;
+  for (int i = first; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (onlyArgs || arg.size() < 3 || arg.compare(0, 2, "--"))
+    {
+      _args.push_back(arg);
+      continue;
+    }
+    if (arg == "--")
+    {
+      onlyArgs = true;
+      continue;
+    }
+    std::string::size_type eq = arg.find('=');
+    if (eq == std::string::npos)
+      _values[arg.substr(2)] = "";
+    else
+      _values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+  }
+  return true;
+}
+
+bool Options::has(const char *name) const
+{
+  return _values.find(name) != _values.end();
+}
+
+std::string Options::get(const char *name, const char *defaultValue) const
+{
+  std::map<std::string, std::string>::const_iterator it = _values.find(name);
+  return it != _values.end() ? it->second : std::string(defaultValue);
+}
+
+int Options::getInt(const char *name, int defaultValue) const
+{
+  std::string value = get(name);
+  if (value.empty())
+    return defaultValue;
+  char *end = 0;
+  long result = strtol(value.c_str(), &end, 10);
+  if (*end)
+  {
+    LOG_WARNING("Invalid value of --" << name << ", using " << defaultValue);
+    return defaultValue;
+  }
+  return (int) result;
+}
+
+double Options::getDouble(const char *name, double defaultValue) const
+{
+  std::string value = get(name);
+  if (value.empty())
+    return defaultValue;
+  char *end = 0;
+  double result = strtod(value.c_str(), &end);
+  if (*end)
+  {
+    LOG_WARNING("Invalid value of --" << name << ", using " << defaultValue);
+    return defaultValue;
+  }
+  return result;
+}
+
+bool Options::check(const char *knownOptions) const
+{
+  std::set<std::string> known;
+  std::istringstream iss(knownOptions);
+  std::string name;
+  while (iss >> name)
+    known.insert(name);
+  bool ok = true;
+  for (std::map<std::string, std::string>::const_iterator it = _values.begin(); it != _values.end(); ++it)
+    if (!known.count(it->first))
+    {
+      LOG_ERROR("Unknown option --" << it->first);
+      ok = false;
+    }
+  return ok;
+}
+
+bool collectJobs(const Options &options, std::vector<VideoJob> &jobs)
+{
+  for (size_t i = 0; i < options.getArgs().size(); i++)
+  {
+    VideoJob job;
+    job.video = options.getArgs()[i];
+    job.markup = MarkedVideo::guessMarkupName(job.video);
+    jobs.push_back(job);
+  }
+
+  if (options.has("list"))
+  {
+    std::ifstream list(options.get("list").c_str());
+    if (!list)
+    {
+      LOG_ERROR("Cannot open list '" << options.get("list") << "'");
+      return false;
+    }
+    std::string line;
+    while (std::getline(list, line))
+    {
+      if (!line.empty() && line[line.size() - 1] == '\r')
+        line.erase(line.size() - 1);
+      if (line.empty() || line[0] == '#')
+        continue;
+      VideoJob job;
+      std::string::size_type tab = line.find('\t');
+      job.video = line.substr(0, tab);
+      job.markup = (tab == std::string::npos) ? MarkedVideo::guessMarkupName(job.video) : line.substr(tab + 1);
+      jobs.push_back(job);
+    }
+  }
+
+  if (jobs.empty())
+  {
+    LOG_ERROR("No videos given");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,223 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <videoreader.h>
+
+#include "activity.h"
+#include "image_kernels.h"
+#include "logger.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+namespace {
+  /** Band luma of consecutive frames is differenced, see LumaDifferences
+    */
+  class ActivityPass: public VideoPass
+  {
+  public:
+    ActivityPass(std::vector<float> &activity)
+    : _activity(activity)
+    {
+    }
+
+    virtual Chunk *createChunk(int first, int)
+    {
+      return new LumaDifferences(first);
+    }
+
+    virtual void merge(Chunk &chunk)
+    {
+      static_cast<LumaDifferences &>(chunk).merge(_activity, _lastLuma);
+    }
+
+  private:
+    std::vector<float> &_activity;
+    std::vector<uint8_t> _lastLuma;
+  };
+
+  double median(std::vector<float> values)
+  {
+    if (values.empty())
+      return 0;
+    std::vector<float>::iterator middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+  }
+}
+
+LumaDifferences::LumaDifferences(int first)
+: first(first)
+{
+}
+
+bool LumaDifferences::process(int frame, const MinImg &image)
+{
+  size_t size = (size_t) image.width * image.height;
+  _current.resize(size);
+  rgbToLuma(image, &_current[0]);
+  if (frame == first)
+  {
+    _firstLuma = _current;
+    differences.push_back(0);
+  }
+  else if (_previous.size() != size)
+    return false;
+  else
+    differences.push_back((float) sumAbsDiff(&_previous[0], &_current[0], size) / size);
+  if (!processLuma(_current))
+    return false;
+  _previous.swap(_current);
+  return true;
+}
+
+void LumaDifferences::merge(std::vector<float> &merged, std::vector<uint8_t> &lastLuma)
+{
+  if (differences.empty())
+    return;
+  if (!lastLuma.empty() && first == (int) merged.size() && lastLuma.size() == _firstLuma.size())
+    differences[0] = (float) sumAbsDiff(&lastLuma[0], &_firstLuma[0], lastLuma.size()) / lastLuma.size();
+  merged.insert(merged.end(), differences.begin(), differences.end());
+  lastLuma.swap(_previous);
+}
+
+bool computeActivity(const std::string &videoName, std::vector<float> &activity,
+                     const ActivityOptions &options, VideoPassStatistics *stats)
+{
+  activity.clear();
+  VideoInfo info;
+  if (!probeVideo(videoName.c_str(), info) || info.width <= 0 || info.height <= 0)
+  {
+    LOG_ERROR("Cannot read '" << videoName << "'");
+    return false;
+  }
+
+  // the band corner is kept on a multiple of 4, so that chroma subsampling does not move it
+  VideoPassOptions passOptions;
+  passOptions.threads = options.threads;
+  passOptions.cancel = options.cancel;
+  passOptions.progress = options.progress;
+  passOptions.region.width = options.bandWidth > 0 ? std::min(options.bandWidth, info.width) : info.width;
+  passOptions.region.x = std::max(0, info.width / 2 - passOptions.region.width / 2) / 4 * 4;
+  passOptions.region.width = std::min(passOptions.region.width, info.width - passOptions.region.x);
+  passOptions.region.y = 0;
+  passOptions.region.height = info.height;
+  passOptions.region.outputWidth = std::min(options.lumaWidth, passOptions.region.width);
+  passOptions.region.outputHeight = options.lumaHeight > 0 ? std::min(options.lumaHeight, info.height) : info.height;
+  if (info.totalFrames > 0)
+    activity.reserve(info.totalFrames);
+
+  ActivityPass pass(activity);
+  if (!runVideoPass(videoName, pass, passOptions, stats))
+  {
+    activity.clear();
+    return false;
+  }
+  return true;
+}
+
+void estimateNoise(const std::vector<float> &activity, double &noise, double &spread)
+{
+  noise = median(activity);
+  std::vector<float> deviations(activity.size());
+  for (size_t t = 0; t < activity.size(); t++)
+    deviations[t] = (float) fabs(activity[t] - noise);
+  spread = std::max(median(deviations), 0.25);
+}
+
+bool proposeIntervals(const std::vector<float> &activity, const ProposalOptions &options,
+                      Markup &proposals, double *high, double *low)
+{
+  // the noise level is the median activity and its spread is the median deviation from it;
+  // a passing object stands well above both
+  double highThreshold = options.high, lowThreshold = options.low;
+  if (highThreshold <= 0 || lowThreshold <= 0)
+  {
+    double noise, spread;
+    estimateNoise(activity, noise, spread);
+    if (highThreshold <= 0)
+      highThreshold = noise + 8 * spread;
+    if (lowThreshold <= 0)
+      lowThreshold = noise + 3 * spread;
+  }
+  lowThreshold = std::min(lowThreshold, highThreshold);
+  if (high)
+    *high = highThreshold;
+  if (low)
+    *low = lowThreshold;
+
+  std::vector<Interval> intervals;
+  int count = (int) activity.size();
+  int lastEnd = -1;           // of the previous proposal with its margin
+  int t = 0;
+  while (t < count)
+  {
+    if (activity[t] <= highThreshold)
+    {
+      t++;
+      continue;
+    }
+    // the interval begins where the activity rose above the low threshold
+    int start = t;
+    while (start > lastEnd + 1 && activity[start - 1] > lowThreshold)
+      start--;
+    int end = t;
+    for (t++; t < count && t - end <= options.maxGap; t++)
+      if (activity[t] > lowThreshold)
+        end = t;
+    t = end + 1;
+    if (end - start + 1 < options.minLength)
+      continue;
+
+    Interval interval;
+    interval.start = std::max(start - options.margin, lastEnd + 1);
+    interval.end = std::min(end + options.margin, count - 1);
+    interval.type = options.type;
+    // the markup needs the start before the end: a one frame run takes a neighbour frame,
+    // if there is none it is dropped
+    if (interval.end <= interval.start)
+    {
+      if (interval.start + 1 < count)
+        interval.end = interval.start + 1;
+      else if (interval.start - 1 > lastEnd)
+        interval.start--;
+      else
+        continue;
+    }
+    intervals.push_back(interval);
+    lastEnd = interval.end;
+  }
+
+  std::vector<std::string> errors;
+  if (!proposals.build(intervals, &errors))
+  {
+    for (size_t i = 0; i < errors.size(); i++)
+      LOG_ERROR("Bad proposal: " << errors[i]);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,132 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "video_markup.h"
+#include "video_pass.h"
+
+struct ActivityOptions
+{
+  ActivityOptions()
+  : threads(0),
+    bandWidth(16),
+    lumaWidth(8),
+    lumaHeight(64),
+    cancel(0),
+    progress(0)
+  {
+  }
+
+  int threads;            ///< decoding threads, 0 - one per processor core
+  int bandWidth;          ///< width of the band around the center line, pixels of the frame; 0 - the whole frame
+  int lumaWidth;          ///< the band is scaled down to lumaWidth x lumaHeight before differencing
+  int lumaHeight;         ///< 0 - frame height
+  const volatile bool *cancel;    ///< see VideoPassOptions
+  volatile int *progress;
+};
+
+/** Chunk of a pass over downscaled frames: converts every frame to luma and
+  * differences it with the previous one. The first frame of a chunk is
+  * differenced with the last one of the previous chunk by merge(); other work
+  * on the luma of the frames is done in processLuma()
+  */
+class LumaDifferences: public VideoPass::Chunk
+{
+public:
+  LumaDifferences(int first);
+
+  virtual bool process(int frame, const MinImg &image);
+
+  /** Appends the differences of the chunk to the ones merged before it
+    * @param[in,out] lastLuma Luma of the last merged frame, gets the one of this chunk
+    */
+  void merge(std::vector<float> &merged, std::vector<uint8_t> &lastLuma);
+
+  int first;
+  std::vector<float> differences;     ///< mean absolute difference of every frame, 0 for the first one
+
+protected:
+  /** Called for every frame with its luma
+    * @return false Stop the whole pass
+    */
+  virtual bool processLuma(const std::vector<uint8_t> &)
+  {
+    return true;
+  }
+
+private:
+  std::vector<uint8_t> _firstLuma;
+  std::vector<uint8_t> _previous;     ///< luma of the last processed frame
+  std::vector<uint8_t> _current;
+};
+
+/** Computes the activity along the center line (the crossing line of the
+  * marker) for every frame: mean absolute difference of the downscaled luma
+  * of the band around the line between the frame and the previous one.
+  * The video is decoded by a key frame parallel pass (see runVideoPass()),
+  * only the band is converted
+  * @param[out] activity Values of the frames in order, 0 for the first frame
+  * @param[out] stats If given, gets the statistics of the pass
+  * @return false Failure
+  */
+bool computeActivity(const std::string &videoName, std::vector<float> &activity,
+                     const ActivityOptions &options = ActivityOptions(), VideoPassStatistics *stats = 0);
+
+/** Estimates the noise of an activity signal: its median and the median
+  * deviation from it (at least 0.25, so that still footage gets some margin)
+  */
+void estimateNoise(const std::vector<float> &activity, double &noise, double &spread);
+
+struct ProposalOptions
+{
+  ProposalOptions()
+  : high(0),
+    low(0),
+    minLength(5),
+    maxGap(10),
+    margin(2),
+    type(1)
+  {
+  }
+
+  double high;            ///< activity starting an interval, 0 - chosen by the noise level
+  double low;             ///< activity keeping it going, 0 - chosen by the noise level
+  int minLength;          ///< shorter intervals are dropped
+  int maxGap;             ///< intervals separated by fewer quiet frames are joined
+  int margin;             ///< frames added at both ends
+  int type;               ///< type of the proposed intervals
+};
+
+/** Turns the activity into proposed intervals with hysteresis: an interval
+  * starts where the activity rises above the high threshold and lasts while
+  * it stays above the low one
+  * @param[out] high, low If given, get the thresholds used
+  * @return false The intervals do not make a valid markup (the errors are logged)
+  */
+bool proposeIntervals(const std::vector<float> &activity, const ProposalOptions &options,
+                      video_markup::Markup &proposals, double *high = 0, double *low = 0);
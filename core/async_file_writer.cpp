@@ -0,0 +1,539 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#if defined(VIDEO_MARKER_HAVE_IO_URING)
+# include <linux/io_uring.h>
+// direct descriptors (file_index) appeared in Linux 5.15, the feature flag below in 5.17
+# if defined(IORING_FEAT_CQE_SKIP)
+#  define ASYNC_FILE_WRITER_URING
+#  include <cerrno>
+#  include <stdint.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+# endif
+#endif
+
+#include "async_file_writer.h"
+#include "fileutil.h"
+#include "stopwatch.h"
+#include "logger.h"
+
+namespace {
+  double now()
+  {
+    static Stopwatch clock;
+    return clock.elapsed();
+  }
+
+  typedef std::vector<std::pair<int, bool> > Finished;
+}
+
+class AsyncFileWriter::Engine
+{
+public:
+  virtual ~Engine()
+  {
+  }
+
+  virtual const char *getName() const = 0;
+
+  /** Queues writing of a file, slot identifies it in poll() results
+    */
+  virtual bool start(int slot, const std::string &path, const void *data, size_t size) = 0;
+
+  /** Appends finished slots and their success flags
+    * @param[in] wait Block until at least one slot finishes
+    */
+  virtual bool poll(Finished &finished, bool wait) = 0;
+};
+
+namespace {
+
+  class ThreadEngine: public AsyncFileWriter::Engine
+  {
+  public:
+    ThreadEngine(int threads)
+    : _stopping(false)
+    {
+      for (int i = 0; i < threads; i++)
+        _threads.create_thread(boost::bind(&ThreadEngine::run, this));
+    }
+
+    ~ThreadEngine()
+    {
+      {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _stopping = true;
+        _requestReady.notify_all();
+      }
+      _threads.join_all();
+    }
+
+    const char *getName() const
+    {
+      return "threads";
+    }
+
+    bool start(int slot, const std::string &path, const void *data, size_t size)
+    {
+      Request request = {slot, &path, data, size};
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      _requests.push_back(request);
+      _requestReady.notify_one();
+      return true;
+    }
+
+    bool poll(Finished &finished, bool wait)
+    {
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      while (wait && _finished.empty())
+        _finishedReady.wait(lock);
+      finished.insert(finished.end(), _finished.begin(), _finished.end());
+      _finished.clear();
+      return true;
+    }
+
+  private:
+    struct Request
+    {
+      int slot;
+      const std::string *path;
+      const void *data;
+      size_t size;
+    };
+
+    void run()
+    {
+      for (;;)
+      {
+        Request request;
+        {
+          boost::unique_lock<boost::mutex> lock(_mutex);
+          while (_requests.empty() && !_stopping)
+            _requestReady.wait(lock);
+          if (_requests.empty())
+            return;
+          request = _requests.front();
+          _requests.pop_front();
+        }
+        bool ok = writeFile(*request.path, request.data, request.size);
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _finished.push_back(std::make_pair(request.slot, ok));
+        _finishedReady.notify_one();
+      }
+    }
+
+    boost::mutex _mutex;
+    boost::condition_variable _requestReady;
+    boost::condition_variable _finishedReady;
+    std::deque<Request> _requests;
+    Finished _finished;
+    bool _stopping;
+    boost::thread_group _threads;
+  };
+
+#ifdef ASYNC_FILE_WRITER_URING
+
+  /** io_uring through raw system calls (no liburing needed).
+    * Every file is an OPENAT - WRITE - CLOSE chain linked with IOSQE_IO_LINK.
+    * The file is opened into the direct descriptor table at the slot index,
+    * so the write and close refer to it without the descriptor ever being
+    * returned to user space. Submissions are batched: the chains are only
+    * handed to the kernel when the caller waits for completions or enough
+    * of them have accumulated.
+    */
+  class UringEngine: public AsyncFileWriter::Engine
+  {
+  public:
+    UringEngine()
+    : _fd(-1), _sqRing(0), _cqRing(0), _sqes(0), _sqRingSize(0), _cqRingSize(0), _sqesSize(0),
+      _queued(0), _batch(1), _inFlight(0)
+    {
+    }
+
+    ~UringEngine()
+    {
+      // closing the ring waits for the requests in flight and closes the direct descriptors
+      if (_sqes)
+        munmap(_sqes, _sqesSize);
+      if (_cqRing && _cqRing != _sqRing)
+        munmap(_cqRing, _cqRingSize);
+      if (_sqRing)
+        munmap(_sqRing, _sqRingSize);
+      if (_fd >= 0)
+        close(_fd);
+    }
+
+    bool init(int slots)
+    {
+      io_uring_params params;
+      memset(&params, 0, sizeof(params));
+      _fd = (int) syscall(__NR_io_uring_setup, 4 * slots, &params);
+      if (_fd < 0)
+        return false;
+      if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_CQE_SKIP))
+        return false;
+
+      _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+      _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+      _sqRing = mmap(0, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+      if (_sqRing == MAP_FAILED)
+      {
+        _sqRing = 0;
+        return false;
+      }
+      _cqRing = _sqRing;
+      void *sqes = mmap(0, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+      if (sqes == MAP_FAILED)
+        return false;
+      _sqes = (io_uring_sqe *) sqes;
+
+      char *sq = (char *) _sqRing;
+      _sqHead = (unsigned *) (sq + params.sq_off.head);
+      _sqTail = (unsigned *) (sq + params.sq_off.tail);
+      _sqMask = *(unsigned *) (sq + params.sq_off.ring_mask);
+      _sqArray = (unsigned *) (sq + params.sq_off.array);
+      char *cq = (char *) _cqRing;
+      _cqHead = (unsigned *) (cq + params.cq_off.head);
+      _cqTail = (unsigned *) (cq + params.cq_off.tail);
+      _cqMask = *(unsigned *) (cq + params.cq_off.ring_mask);
+      _cqes = (io_uring_cqe *) (cq + params.cq_off.cqes);
+
+      // an empty direct descriptor table, one entry per slot
+      std::vector<int> files(slots, -1);
+      if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_FILES, &files[0], slots) < 0)
+        return false;
+
+      _pendingTail = *_sqTail;
+      _chains.resize(slots);
+      _batch = std::max(1, slots / 4);
+      return true;
+    }
+
+    const char *getName() const
+    {
+      return "io_uring";
+    }
+
+    bool start(int slot, const std::string &path, const void *data, size_t size)
+    {
+      Chain &chain = _chains[slot];
+      chain.size = size;
+      chain.remaining = 3;
+      chain.ok = true;
+
+      io_uring_sqe *sqe = getSqe();
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->flags = IOSQE_IO_LINK;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (uintptr_t) path.c_str();
+      sqe->len = 0644;
+      sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+      sqe->file_index = slot + 1;
+      sqe->user_data = slot;
+
+      sqe = getSqe();
+      sqe->opcode = IORING_OP_WRITE;
+      sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+      sqe->fd = slot;
+      sqe->addr = (uintptr_t) data;
+      sqe->len = (unsigned) size;
+      sqe->off = 0;
+      sqe->user_data = slot;
+
+      sqe = getSqe();
+      sqe->opcode = IORING_OP_CLOSE;
+      sqe->file_index = slot + 1;
+      sqe->user_data = slot;
+
+      // a short write breaks the chain, the descriptor left open is replaced by the next open into the slot
+      if (++_queued >= _batch)
+        return enter(0);
+      return true;
+    }
+
+    bool poll(Finished &finished, bool wait)
+    {
+      for (;;)
+      {
+        size_t count = finished.size();
+        unsigned head = *_cqHead;
+        unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+        _inFlight -= tail - head;
+        for (; head != tail; head++)
+        {
+          const io_uring_cqe &cqe = _cqes[head & _cqMask];
+          int slot = (int) cqe.user_data;
+          Chain &chain = _chains[slot];
+          // the middle completion is the write, the others must just succeed
+          if (chain.remaining == 2)
+            chain.ok = chain.ok && cqe.res == (int) chain.size;
+          else
+            chain.ok = chain.ok && cqe.res >= 0;
+          if (--chain.remaining == 0)
+            finished.push_back(std::make_pair(slot, chain.ok));
+        }
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+
+        if (finished.size() > count || !wait)
+          return true;
+        if (!enter(1))
+          return false;
+      }
+    }
+
+  private:
+    struct Chain
+    {
+      size_t size;
+      int remaining;    ///< completions still expected
+      bool ok;
+    };
+
+    io_uring_sqe *getSqe()
+    {
+      unsigned tail = *_sqTail;
+      io_uring_sqe *sqe = &_sqes[tail & _sqMask];
+      memset(sqe, 0, sizeof(*sqe));
+      _sqArray[tail & _sqMask] = tail & _sqMask;
+      _pendingTail = tail + 1;
+      __atomic_store_n(_sqTail, _pendingTail, __ATOMIC_RELEASE);
+      return sqe;
+    }
+
+    /** Submits the queued chains and optionally waits for completions
+      */
+    bool enter(unsigned minComplete)
+    {
+      unsigned toSubmit = _pendingTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+      for (;;)
+      {
+        int ret = (int) syscall(__NR_io_uring_enter, _fd, toSubmit, minComplete,
+                                minComplete ? IORING_ENTER_GETEVENTS : 0, (void *) 0, 0);
+        if (ret >= 0)
+        {
+          _inFlight += std::min((unsigned) ret, toSubmit);
+          toSubmit -= std::min((unsigned) ret, toSubmit);
+          if (toSubmit == 0)
+            break;
+          continue;
+        }
+        if (errno == EINTR)
+          continue;
+        // the kernel is short of resources until some completions are reaped,
+        // the chains left in the ring are submitted next time
+        if (errno == EAGAIN || errno == EBUSY)
+          return waitCompletion();
+        LOG_ERROR("io_uring_enter() failed: " << strerror(errno));
+        return false;
+      }
+      _queued = 0;
+      return true;
+    }
+
+    /** Blocks until a completion is ready to be reaped, without submitting
+      */
+    bool waitCompletion()
+    {
+      if (*_cqHead != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))
+        return true;
+      if (_inFlight == 0)
+      {
+        LOG_ERROR("io_uring_enter() failed: " << strerror(errno) << " with no requests in flight");
+        return false;
+      }
+      while (syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, (void *) 0, 0) < 0)
+      {
+        if (errno != EINTR)
+        {
+          LOG_ERROR("io_uring_enter() failed: " << strerror(errno));
+          return false;
+        }
+      }
+      return true;
+    }
+
+    int _fd;
+    void *_sqRing;
+    void *_cqRing;
+    io_uring_sqe *_sqes;
+    size_t _sqRingSize;
+    size_t _cqRingSize;
+    size_t _sqesSize;
+    unsigned *_sqHead;
+    unsigned *_sqTail;
+    unsigned _sqMask;
+    unsigned *_sqArray;
+    unsigned *_cqHead;
+    unsigned *_cqTail;
+    unsigned _cqMask;
+    io_uring_cqe *_cqes;
+    unsigned _pendingTail;
+    std::vector<Chain> _chains;
+    int _queued;      ///< chains not yet handed to the kernel
+    int _batch;
+    unsigned _inFlight;   ///< requests submitted whose completions are not reaped yet
+  };
+
+#endif
+}
+
+AsyncFileWriter::AsyncFileWriter(int queueDepth, Backend backend)
+: _queueDepth(std::max(1, queueDepth)),
+  _engine(0)
+{
+#ifdef ASYNC_FILE_WRITER_URING
+  if (backend != backendThreads)
+  {
+    UringEngine *engine = new UringEngine;
+    if (engine->init(_queueDepth))
+      _engine = engine;
+    else
+      delete engine;
+  }
+#endif
+  if (!_engine)
+  {
+    if (backend == backendUring)
+      LOG_INFO("io_uring is not available, files are written by threads");
+    _engine = new ThreadEngine(std::min(_queueDepth, 4));
+  }
+
+  _slots.resize(_queueDepth);
+  for (int i = _queueDepth - 1; i >= 0; i--)
+    _freeSlots.push_back(i);
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+  std::vector<Completion> done;
+  while (_queueDepth > (int) _freeSlots.size())
+    reap(done, true);
+  delete _engine;
+}
+
+const char *AsyncFileWriter::getBackendName() const
+{
+  return _engine->getName();
+}
+
+int AsyncFileWriter::getPending() const
+{
+  return _queueDepth - (int) _freeSlots.size() + (int) _done.size();
+}
+
+bool AsyncFileWriter::submit(const std::string &path, const void *data, size_t size, void *cookie)
+{
+  while (_freeSlots.empty())
+  {
+    Finished finished;
+    if (!_engine->poll(finished, true))
+      return false;
+    for (size_t i = 0; i < finished.size(); i++)
+      complete(finished[i].first, finished[i].second, _done);
+  }
+  int slot = _freeSlots.back();
+  _freeSlots.pop_back();
+  Slot &s = _slots[slot];
+  s.path = path;
+  s.data = data;
+  s.size = size;
+  s.cookie = cookie;
+  s.submitTime = now();
+
+  int depth = _queueDepth - (int) _freeSlots.size();
+  _stats.maxDepth = std::max(_stats.maxDepth, depth);
+  _stats.depthSum += depth;
+
+  // the write length of an io_uring request is 32 bit
+  if (size > 0x7fffffff)
+  {
+    complete(slot, writeFile(path, data, size), _done);
+    return true;
+  }
+  return _engine->start(slot, s.path, data, size);
+}
+
+void AsyncFileWriter::reap(std::vector<Completion> &done, bool wait)
+{
+  done.insert(done.end(), _done.begin(), _done.end());
+  wait = wait && _done.empty() && _queueDepth > (int) _freeSlots.size();
+  _done.clear();
+
+  Finished finished;
+  if (!_engine->poll(finished, wait))
+  {
+    // the ring is broken, nothing in flight will ever complete
+    for (int slot = 0; slot < _queueDepth; slot++)
+      if (std::find(_freeSlots.begin(), _freeSlots.end(), slot) == _freeSlots.end())
+        finished.push_back(std::make_pair(slot, false));
+  }
+  for (size_t i = 0; i < finished.size(); i++)
+    complete(finished[i].first, finished[i].second, done);
+}
+
+void AsyncFileWriter::complete(int slot, bool ok, std::vector<Completion> &done)
+{
+  Slot &s = _slots[slot];
+  double latency = now() - s.submitTime;
+  _stats.files++;
+  if (ok)
+    _stats.bytes += s.size;
+  else
+    _stats.failed++;
+  _stats.latency += latency;
+  _stats.maxLatency = std::max(_stats.maxLatency, latency);
+
+  Completion completion = {s.cookie, ok};
+  done.push_back(completion);
+  _freeSlots.push_back(slot);
+}
+
+bool AsyncFileWriter::parseBackend(const std::string &name, Backend &backend)
+{
+  if (name == "auto")
+    backend = backendAuto;
+  else if (name == "uring")
+    backend = backendUring;
+  else if (name == "threads")
+    backend = backendThreads;
+  else
+    return false;
+  return true;
+}
@@ -0,0 +1,131 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/** Writes whole files asynchronously, keeping many of them in flight.
+  * On Linux io_uring is used: creation, writing and closing of a file are
+  * submitted as one linked chain, so a file costs no system calls of its
+  * own and submissions are batched. Elsewhere (or if the kernel does not
+  * support it) a small thread pool does ordinary blocking writes.
+  * The object is meant to be used from one thread.
+  */
+class AsyncFileWriter
+{
+public:
+  enum Backend
+  {
+    backendAuto,          ///< io_uring if available, threads otherwise
+    backendUring,
+    backendThreads
+  };
+
+  struct Completion
+  {
+    void *cookie;         ///< as given to submit()
+    bool ok;
+  };
+
+  struct Statistics
+  {
+    long files;           ///< files completed
+    long failed;          ///< files which could not be written
+    double bytes;         ///< bytes written
+    int maxDepth;         ///< largest number of files in flight
+    double depthSum;      ///< number of files in flight summed over submissions
+    double latency;       ///< seconds from submission to completion summed over files
+    double maxLatency;    ///< longest submission to completion time
+  };
+
+  /** @param[in] queueDepth Maximum number of files in flight
+    * @param[in] backend backendUring falls back to threads if io_uring is not available
+    */
+  explicit AsyncFileWriter(int queueDepth = 32, Backend backend = backendAuto);
+
+  /** Waits for the files in flight
+    */
+  ~AsyncFileWriter();
+
+  /** @return "io_uring" or "threads"
+    */
+  const char *getBackendName() const;
+
+  int getQueueDepth() const
+  {
+    return _queueDepth;
+  }
+
+  /** @return number of files submitted and not yet returned by reap()
+    */
+  int getPending() const;
+
+  /** Starts writing a file. The data must stay valid until the file is returned by reap().
+    * If the queue is full, waits until some file completes
+    * @return false Failure of the backend itself (error is logged)
+    */
+  bool submit(const std::string &path, const void *data, size_t size, void *cookie);
+
+  /** Appends completed files to done
+    * @param[in] wait Block until at least one file completes (if any is pending)
+    */
+  void reap(std::vector<Completion> &done, bool wait);
+
+  Statistics getStatistics() const
+  {
+    return _stats;
+  }
+
+  /** Converts "auto", "uring" or "threads"
+    * @return false Unknown name
+    */
+  static bool parseBackend(const std::string &name, Backend &backend);
+
+  class Engine;
+
+private:
+  AsyncFileWriter(const AsyncFileWriter &);
+  AsyncFileWriter &operator= (const AsyncFileWriter &);
+
+  struct Slot
+  {
+    std::string path;
+    const void *data;
+    size_t size;
+    void *cookie;
+    double submitTime;
+  };
+
+  void complete(int slot, bool ok, std::vector<Completion> &done);
+
+  int _queueDepth;
+  Engine *_engine;
+  std::vector<Slot> _slots;
+  std::vector<int> _freeSlots;
+  std::vector<Completion> _done;    ///< completions collected while waiting for a free slot
+  Statistics _stats;
+};
@@ -0,0 +1,99 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "background_task.h"
+
+BackgroundTask::BackgroundTask()
+: _thread(0),
+  _state(stateIdle),
+  _cancel(false),
+  _progress(0)
+{
+}
+
+BackgroundTask::~BackgroundTask()
+{
+  // the subclass is gone by now, its work() must have been stopped
+  join();
+}
+
+void BackgroundTask::start()
+{
+  cancel();
+  _cancel = false;
+  _progress = 0;
+  {
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _state = stateRunning;
+  }
+  _thread = new boost::thread(boost::bind(&BackgroundTask::run, this));
+}
+
+void BackgroundTask::cancel()
+{
+  _cancel = true;
+  join();
+  boost::lock_guard<boost::mutex> lock(_mutex);
+  _state = stateIdle;
+}
+
+bool BackgroundTask::isRunning() const
+{
+  boost::lock_guard<boost::mutex> lock(_mutex);
+  return _state == stateRunning;
+}
+
+bool BackgroundTask::finish()
+{
+  State state;
+  {
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    state = _state;
+  }
+  if (state == stateRunning)
+    return false;
+  join();
+  boost::lock_guard<boost::mutex> lock(_mutex);
+  _state = stateIdle;
+  return state == stateDone;
+}
+
+void BackgroundTask::run()
+{
+  bool ok = work();
+  boost::lock_guard<boost::mutex> lock(_mutex);
+  _state = ok ? stateDone : stateFailed;
+}
+
+void BackgroundTask::join()
+{
+  if (!_thread)
+    return;
+  _thread->join();
+  delete _thread;
+  _thread = 0;
+}
@@ -0,0 +1,177 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <string>
+
+#include "logger.h"
+
+/** Work done on a thread of its own, e.g. a whole video pass while the GUI
+  * goes on. The owner calls start(), polls isRunning() and collects the result
+  * after finish() has returned true.
+  * Subclasses must call cancel() in their destructors, since the thread uses
+  * their members
+  */
+class BackgroundTask
+{
+public:
+  BackgroundTask();
+  virtual ~BackgroundTask();
+
+  /** Runs work() on a new thread, cancelling the work in progress first
+    */
+  void start();
+
+  /** Asks work() to stop and waits for the thread
+    */
+  void cancel();
+
+  bool isRunning() const;
+
+  /** @return number of items (frames, as a rule) done so far
+    */
+  int getProgress() const
+  {
+    return _progress;
+  }
+
+  /** Waits for the finished thread and makes the task idle again
+    * @return true work() has succeeded and its result may be taken
+    * @return false The work has failed, has been cancelled or is still going on
+    */
+  bool finish();
+
+protected:
+  /** Does the work on the task's thread. Long work should poll *getCancelFlag()
+    * and count its items in *getProgressCounter()
+    * @return false Failure or cancel
+    */
+  virtual bool work() = 0;
+
+  const volatile bool *getCancelFlag() const
+  {
+    return &_cancel;
+  }
+
+  volatile int *getProgressCounter()
+  {
+    return &_progress;
+  }
+
+private:
+  BackgroundTask(const BackgroundTask &);
+  BackgroundTask &operator= (const BackgroundTask &);
+
+  void run();
+  void join();
+
+  enum State
+  {
+    stateIdle,
+    stateRunning,
+    stateDone,
+    stateFailed
+  };
+
+  boost::thread *_thread;
+  mutable boost::mutex _mutex;
+  State _state;
+  volatile bool _cancel;
+  volatile int _progress;
+};
+
+/** Loads the result of a whole-video pass from the cache next to the video or,
+  * when there is no valid cache, makes it and saves the cache, on a thread of
+  * its own. T is the result (e.g. SlitScan): it has getCacheName(), load(),
+  * build(), save(), getFrames(), clear() and swap().
+  * Meant for the GUI: start(), then poll isRunning() and take() the result
+  */
+template <class T>
+class CacheBuilder: public BackgroundTask
+{
+public:
+  /** @param[in] request Empty result telling what to make (e.g. the strip
+    *            height of a SlitScan), every build starts from a copy of it
+    */
+  explicit CacheBuilder(const T &request = T())
+  : _request(request),
+    _threads(0)
+  {
+  }
+
+  ~CacheBuilder()
+  {
+    cancel();
+  }
+
+  /** Starts a new build, cancelling the previous one
+    * @param[in] threads Decoding threads, 0 - one per processor core
+    */
+  void start(const std::string &videoName, int threads = 0)
+  {
+    cancel();
+    _videoName = videoName;
+    _threads = threads;
+    _result = _request;
+    BackgroundTask::start();
+  }
+
+  /** Moves the finished result out of the builder
+    * @return false The build is not done or has failed
+    */
+  bool take(T &result)
+  {
+    if (!finish())
+      return false;
+    result.swap(_result);
+    _result.clear();
+    return true;
+  }
+
+protected:
+  virtual bool work()
+  {
+    std::string cacheName = T::getCacheName(_videoName);
+    if (_result.load(cacheName, _videoName))
+    {
+      *getProgressCounter() = _result.getFrames();
+      return true;
+    }
+    if (!_result.build(_videoName, _threads, getCancelFlag(), getProgressCounter()))
+      return false;
+    if (!_result.save(cacheName, _videoName))
+      LOG_WARNING("Cannot save cache '" << cacheName << "'");
+    return true;
+  }
+
+private:
+  T _request;
+  std::string _videoName;
+  int _threads;
+  T _result;
+};
@@ -0,0 +1,501 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <map>
+
+#include <videoreader.h>
+
+#include "corpus_catalog.h"
+#include "markedvideo.h"
+#include "markup_binary.h"
+#include "parallel.h"
+#include "fileutil.h"
+#include "logger.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+namespace {
+  const char Magic[8] = {'V', 'M', 'C', 'A', 'T', 'L', 'O', 'G'};
+
+  enum
+  {
+    VideoOk = 1,
+    MarkupOk = 2
+  };
+
+  class StringTable
+  {
+  public:
+    uint32_t intern(const std::string &s)
+    {
+      std::pair<std::map<std::string, uint32_t>::iterator, bool> res = _indices.insert(std::make_pair(s, (uint32_t) _strings.size()));
+      if (res.second)
+        _strings.push_back(&res.first->first);
+      return res.first->second;
+    }
+
+    const std::vector<const std::string *> &getStrings() const
+    {
+      return _strings;
+    }
+
+  private:
+    std::map<std::string, uint32_t> _indices;
+    std::vector<const std::string *> _strings;
+  };
+
+  bool entryLess(const CatalogEntry &a, const CatalogEntry &b)
+  {
+    return a.video < b.video;
+  }
+
+  bool hasExtension(const std::string &name, const std::vector<std::string> &extensions)
+  {
+    for (size_t i = 0; i < extensions.size(); i++)
+    {
+      const std::string &ext = extensions[i];
+      if (name.size() <= ext.size())
+        continue;
+      size_t k = 0;
+      size_t offset = name.size() - ext.size();
+      while (k < ext.size() && tolower((unsigned char) name[offset + k]) == tolower((unsigned char) ext[k]))
+        k++;
+      if (k == ext.size())
+        return true;
+    }
+    return false;
+  }
+
+  std::string joinPath(const std::string &dir, const std::string &name)
+  {
+    if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+      return dir + "/" + name;
+    return dir + name;
+  }
+
+  // lists one level of the directory tree
+  class ScanTask: public ParallelTask
+  {
+  public:
+    ScanTask(const std::vector<std::string> &dirs, const std::vector<std::string> &extensions)
+    : _dirs(dirs),
+      _extensions(extensions),
+      _videos(dirs.size()),
+      _subdirs(dirs.size())
+    {
+    }
+
+    virtual void run(int index)
+    {
+      std::vector<std::string> files, dirs;
+      if (!listDir(_dirs[index], files, dirs))
+      {
+        LOG_WARNING("Cannot read directory '" << _dirs[index] << "'");
+        return;
+      }
+      for (size_t i = 0; i < files.size(); i++)
+        if (hasExtension(files[i], _extensions))
+          _videos[index].push_back(joinPath(_dirs[index], files[i]));
+      for (size_t i = 0; i < dirs.size(); i++)
+        _subdirs[index].push_back(joinPath(_dirs[index], dirs[i]));
+    }
+
+    void collect(std::vector<std::string> &videos, std::vector<std::string> &subdirs) const
+    {
+      for (size_t i = 0; i < _dirs.size(); i++)
+      {
+        videos.insert(videos.end(), _videos[i].begin(), _videos[i].end());
+        subdirs.insert(subdirs.end(), _subdirs[i].begin(), _subdirs[i].end());
+      }
+    }
+
+  private:
+    const std::vector<std::string> &_dirs;
+    const std::vector<std::string> &_extensions;
+    std::vector< std::vector<std::string> > _videos;
+    std::vector< std::vector<std::string> > _subdirs;
+  };
+
+  void summarizeMarkup(const Markup &markup, CatalogEntry &entry)
+  {
+    std::map<int, int> types;
+    std::map<std::string, int> labels;
+    entry.intervals = (int) markup.size();
+    entry.intervalFrames = 0;
+    entry.comments = 0;
+    for (size_t i = 0; i < markup.size(); i++)
+    {
+      const Interval &interval = markup[i];
+      entry.intervalFrames += interval.end - interval.start + 1;
+      if (!interval.comment.empty())
+        entry.comments++;
+      types[interval.type]++;
+      for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+        labels[*it]++;
+    }
+    entry.types.assign(types.begin(), types.end());
+    entry.labels.assign(labels.begin(), labels.end());
+  }
+
+  // makes entries of the found videos, reading only what has changed since the old catalog
+  class ReadTask: public ParallelTask
+  {
+  public:
+    ReadTask(const std::vector<std::string> &videos, const std::vector<CatalogEntry> &old)
+    : _videos(videos),
+      _old(old),
+      _entries(videos.size()),
+      _state(videos.size(), Kept)
+    {
+    }
+
+    enum State
+    {
+      Kept,
+      Read,
+      Failed,
+      Gone            ///< removed while the catalog was being refreshed
+    };
+
+    virtual void run(int index)
+    {
+      CatalogEntry &entry = _entries[index];
+      entry.video = _videos[index];
+      if (!getFileInfo(entry.video, entry.videoSize, entry.videoTime))
+      {
+        _state[index] = Gone;
+        return;
+      }
+      entry.markup = MarkedVideo::guessMarkupName(entry.video);
+      if (!getFileInfo(entry.markup, entry.markupSize, entry.markupTime))
+        entry.markupSize = entry.markupTime = -1;
+
+      const CatalogEntry *old = 0;
+      std::vector<CatalogEntry>::const_iterator it = std::lower_bound(_old.begin(), _old.end(), entry, entryLess);
+      if (it != _old.end() && it->video == entry.video)
+        old = &*it;
+
+      if (old && old->videoSize == entry.videoSize && old->videoTime == entry.videoTime)
+      {
+        entry.videoOk = old->videoOk;
+        entry.width = old->width;
+        entry.height = old->height;
+        entry.totalFrames = old->totalFrames;
+        entry.keyFrames = old->keyFrames;
+        entry.fps = old->fps;
+        entry.codec = old->codec;
+      }
+      else
+      {
+        _state[index] = Read;
+        VideoInfo info;
+        entry.videoOk = probeVideo(entry.video.c_str(), info);
+        if (entry.videoOk)
+        {
+          entry.width = info.width;
+          entry.height = info.height;
+          entry.totalFrames = info.totalFrames;
+          entry.keyFrames = info.keyFrames;
+          entry.fps = info.fps;
+          entry.codec = info.codec;
+        }
+        else
+          _state[index] = Failed;
+      }
+
+      if (old && old->markup == entry.markup && old->markupSize == entry.markupSize && old->markupTime == entry.markupTime)
+      {
+        entry.markupOk = old->markupOk;
+        entry.intervals = old->intervals;
+        entry.intervalFrames = old->intervalFrames;
+        entry.comments = old->comments;
+        entry.types = old->types;
+        entry.labels = old->labels;
+      }
+      else if (entry.markupSize >= 0)
+      {
+        if (_state[index] == Kept)
+          _state[index] = Read;
+        Markup markup;
+        entry.markupOk = video_markup::loadMarkupFile(markup, entry.markup.c_str());
+        if (entry.markupOk)
+          summarizeMarkup(markup, entry);
+        else
+          LOG_WARNING("Failed to load markup from '" << entry.markup << "'");
+      }
+    }
+
+    void collect(std::vector<CatalogEntry> &entries, CorpusCatalog::RefreshStats &stats)
+    {
+      entries.clear();
+      entries.reserve(_entries.size());
+      for (size_t i = 0; i < _entries.size(); i++)
+      {
+        if (_state[i] == Gone)
+          continue;
+        if (_state[i] != Kept)
+          stats.read++;
+        if (_state[i] == Failed)
+          stats.failed++;
+        entries.push_back(CatalogEntry());
+        std::swap(entries.back(), _entries[i]);
+      }
+    }
+
+  private:
+    const std::vector<std::string> &_videos;
+    const std::vector<CatalogEntry> &_old;
+    std::vector<CatalogEntry> _entries;
+    std::vector<char> _state;
+  };
+}
+
+CatalogEntry::CatalogEntry()
+: videoSize(-1),
+  videoTime(-1),
+  markupSize(-1),
+  markupTime(-1),
+  videoOk(false),
+  width(0),
+  height(0),
+  totalFrames(-1),
+  keyFrames(-1),
+  fps(0),
+  markupOk(false),
+  intervals(0),
+  intervalFrames(0),
+  comments(0)
+{
+}
+
+CorpusCatalog::RefreshStats CorpusCatalog::refresh(const std::vector<std::string> &dirs,
+                                                   const std::vector<std::string> &extensions, int threads)
+{
+  RefreshStats stats;
+  memset(&stats, 0, sizeof(stats));
+
+  // the tree is listed a level at a time, directories of a level in parallel
+  std::vector<std::string> videos;
+  std::vector<std::string> level = dirs;
+  for (int depth = 0; depth < MaxDepth && !level.empty(); depth++)
+  {
+    ScanTask scan(level, extensions);
+    runParallel(scan, (int) level.size(), threads);
+    std::vector<std::string> next;
+    scan.collect(videos, next);
+    level.swap(next);
+  }
+  if (!level.empty())
+    LOG_WARNING("Directories deeper than " << (int) MaxDepth << " levels are skipped");
+  std::sort(videos.begin(), videos.end());
+  videos.erase(std::unique(videos.begin(), videos.end()), videos.end());
+  stats.videos = (int) videos.size();
+
+  ReadTask read(videos, _entries);
+  runParallel(read, (int) videos.size(), threads);
+  size_t oldCount = _entries.size();
+  std::vector<CatalogEntry> entries;
+  read.collect(entries, stats);
+
+  // every old entry still there has been kept or read again
+  size_t kept = 0;
+  for (size_t i = 0; i < entries.size(); i++)
+    if (std::binary_search(_entries.begin(), _entries.end(), entries[i], entryLess))
+      kept++;
+  stats.removed = (int) (oldCount - kept);
+  _entries.swap(entries);
+  return stats;
+}
+
+bool CorpusCatalog::save(const std::string &fileName) const
+{
+  StringTable strings;
+  std::vector<uint32_t> counts;
+  std::vector<uint8_t> buffer(HeaderSize + _entries.size() * EntrySize);
+  for (size_t i = 0; i < _entries.size(); i++)
+  {
+    const CatalogEntry &entry = _entries[i];
+    size_t offset = HeaderSize + i * EntrySize;
+    putLE32(&buffer[offset + 0], strings.intern(entry.video));
+    putLE32(&buffer[offset + 4], strings.intern(entry.markup));
+    putLE32(&buffer[offset + 8], strings.intern(entry.codec));
+    putLE32(&buffer[offset + 12], (entry.videoOk ? VideoOk : 0) | (entry.markupOk ? MarkupOk : 0));
+    putLE64(&buffer[offset + 16], (uint64_t) entry.videoSize);
+    putLE64(&buffer[offset + 24], (uint64_t) entry.videoTime);
+    putLE64(&buffer[offset + 32], (uint64_t) entry.markupSize);
+    putLE64(&buffer[offset + 40], (uint64_t) entry.markupTime);
+    putLE32(&buffer[offset + 48], (uint32_t) entry.width);
+    putLE32(&buffer[offset + 52], (uint32_t) entry.height);
+    putLE32(&buffer[offset + 56], (uint32_t) entry.totalFrames);
+    putLE32(&buffer[offset + 60], (uint32_t) entry.keyFrames);
+    putLE32(&buffer[offset + 64], (uint32_t) (entry.fps * 1000 + 0.5));    // in thousandths
+    putLE32(&buffer[offset + 68], (uint32_t) entry.intervals);
+    putLE64(&buffer[offset + 72], (uint64_t) entry.intervalFrames);
+    putLE32(&buffer[offset + 80], (uint32_t) entry.comments);
+    putLE32(&buffer[offset + 84], (uint32_t) (counts.size() / 2));
+    putLE32(&buffer[offset + 88], (uint32_t) entry.types.size());
+    putLE32(&buffer[offset + 92], (uint32_t) entry.labels.size());
+    for (size_t k = 0; k < entry.types.size(); k++)
+    {
+      counts.push_back((uint32_t) entry.types[k].first);
+      counts.push_back((uint32_t) entry.types[k].second);
+    }
+    for (size_t k = 0; k < entry.labels.size(); k++)
+    {
+      counts.push_back(strings.intern(entry.labels[k].first));
+      counts.push_back((uint32_t) entry.labels[k].second);
+    }
+  }
+
+  size_t offset = buffer.size();
+  buffer.resize(offset + counts.size() * 4);
+  for (size_t k = 0; k < counts.size(); k++)
+    putLE32(&buffer[offset + k * 4], counts[k]);
+
+  const std::vector<const std::string *> &table = strings.getStrings();
+  offset = buffer.size();
+  buffer.resize(offset + table.size() * 8);
+  uint32_t poolSize = 0;
+  for (size_t k = 0; k < table.size(); k++)
+  {
+    putLE32(&buffer[offset + k * 8], poolSize);
+    putLE32(&buffer[offset + k * 8 + 4], (uint32_t) table[k]->size());
+    poolSize += (uint32_t) table[k]->size();
+  }
+  for (size_t k = 0; k < table.size(); k++)
+    buffer.insert(buffer.end(), table[k]->begin(), table[k]->end());
+
+  memcpy(&buffer[0], Magic, sizeof(Magic));
+  putLE32(&buffer[8], Version);
+  putLE32(&buffer[12], (uint32_t) _entries.size());
+  putLE32(&buffer[16], (uint32_t) (counts.size() / 2));
+  putLE32(&buffer[20], (uint32_t) table.size());
+  putLE32(&buffer[24], poolSize);
+  putLE32(&buffer[28], 0);
+
+  std::string tempName = fileName + ".new";
+  if (!writeFile(tempName, &buffer[0], buffer.size()))
+  {
+    remove(tempName.c_str());
+    return false;
+  }
+  return replaceFile(tempName, fileName);
+}
+
+bool CorpusCatalog::load(const std::string &fileName, std::string *error)
+{
+  _entries.clear();
+  MappedFile file;
+  std::string problem;
+  if (!file.open(fileName))
+    problem = "cannot map the file";
+  else if (file.getSize() < HeaderSize || memcmp(file.getData(), Magic, sizeof(Magic)))
+    problem = "not a catalog";
+  else if (getLE32(file.getData() + 8) != Version)
+    problem = "unsupported version";
+
+  const uint8_t *data = file.getData();
+  uint64_t entryCount = 0, countCount = 0, stringCount = 0, poolSize = 0;
+  const uint8_t *entries = 0, *counts = 0, *strings = 0, *pool = 0;
+  if (problem.empty())
+  {
+    entryCount = getLE32(data + 12);
+    countCount = getLE32(data + 16);
+    stringCount = getLE32(data + 20);
+    poolSize = getLE32(data + 24);
+    entries = data + HeaderSize;
+    counts = entries + entryCount * EntrySize;
+    strings = counts + countCount * 8;
+    pool = strings + stringCount * 8;
+    if (HeaderSize + entryCount * EntrySize + countCount * 8 + stringCount * 8 + poolSize != file.getSize())
+      problem = "file size does not match the header";
+  }
+  for (uint64_t k = 0; k < stringCount && problem.empty(); k++)
+    if ((uint64_t) getLE32(strings + k * 8) + getLE32(strings + k * 8 + 4) > poolSize)
+      problem = "string outside of the pool";
+
+  for (uint64_t i = 0; i < entryCount && problem.empty(); i++)
+  {
+    const uint8_t *p = entries + i * EntrySize;
+    uint64_t firstCount = getLE32(p + 84), typeCount = getLE32(p + 88), labelCount = getLE32(p + 92);
+    if (getLE32(p) >= stringCount || getLE32(p + 4) >= stringCount || getLE32(p + 8) >= stringCount
+        || firstCount + typeCount + labelCount > countCount)
+    {
+      problem = "damaged entry";
+      break;
+    }
+    for (uint64_t k = 0; k < labelCount; k++)
+      if (getLE32(counts + (firstCount + typeCount + k) * 8) >= stringCount)
+        problem = "damaged entry";
+  }
+
+  if (!problem.empty())
+  {
+    if (error)
+      *error = problem;
+    return false;
+  }
+
+  std::vector<std::string> table(stringCount);
+  for (uint64_t k = 0; k < stringCount; k++)
+    table[k].assign((const char *) pool + getLE32(strings + k * 8), getLE32(strings + k * 8 + 4));
+
+  _entries.resize(entryCount);
+  for (uint64_t i = 0; i < entryCount; i++)
+  {
+    const uint8_t *p = entries + i * EntrySize;
+    CatalogEntry &entry = _entries[i];
+    entry.video = table[getLE32(p + 0)];
+    entry.markup = table[getLE32(p + 4)];
+    entry.codec = table[getLE32(p + 8)];
+    entry.videoOk = (getLE32(p + 12) & VideoOk) != 0;
+    entry.markupOk = (getLE32(p + 12) & MarkupOk) != 0;
+    entry.videoSize = (int64_t) getLE64(p + 16);
+    entry.videoTime = (int64_t) getLE64(p + 24);
+    entry.markupSize = (int64_t) getLE64(p + 32);
+    entry.markupTime = (int64_t) getLE64(p + 40);
+    entry.width = (int) getLE32(p + 48);
+    entry.height = (int) getLE32(p + 52);
+    entry.totalFrames = (int) getLE32(p + 56);
+    entry.keyFrames = (int) getLE32(p + 60);
+    entry.fps = getLE32(p + 64) / 1000.0;
+    entry.intervals = (int) getLE32(p + 68);
+    entry.intervalFrames = (int64_t) getLE64(p + 72);
+    entry.comments = (int) getLE32(p + 80);
+    const uint8_t *c = counts + (uint64_t) getLE32(p + 84) * 8;
+    entry.types.resize(getLE32(p + 88));
+    for (size_t k = 0; k < entry.types.size(); k++, c += 8)
+      entry.types[k] = std::make_pair((int) getLE32(c), (int) getLE32(c + 4));
+    entry.labels.resize(getLE32(p + 92));
+    for (size_t k = 0; k < entry.labels.size(); k++, c += 8)
+      entry.labels[k] = std::make_pair(table[getLE32(c)], (int) getLE32(c + 4));
+  }
+  // refresh() relies on the order, which a damaged or foreign file might not keep
+  std::sort(_entries.begin(), _entries.end(), entryLess);
+  return true;
+}
@@ -0,0 +1,119 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/** What the catalog knows about a video and its markup
+  */
+struct CatalogEntry
+{
+  CatalogEntry();
+
+  std::string video;
+  std::string markup;         ///< MarkedVideo::guessMarkupName() of the video
+  int64_t videoSize;
+  int64_t videoTime;          ///< modification time
+  int64_t markupSize;         ///< -1 if there is no markup
+  int64_t markupTime;
+
+  // container headers (probeVideo()), valid if videoOk
+  bool videoOk;
+  int width;
+  int height;
+  int totalFrames;            ///< -1 if the container does not tell
+  int keyFrames;              ///< -1 if the container has no index
+  double fps;
+  std::string codec;
+
+  // markup summary, valid if markupOk
+  bool markupOk;
+  int intervals;
+  int64_t intervalFrames;     ///< frames covered by intervals
+  int comments;
+  std::vector<std::pair<int, int> > types;            ///< type and number of its intervals, by type
+  std::vector<std::pair<std::string, int> > labels;   ///< label and number of its intervals, by name
+};
+
+/** Table of the videos of a corpus with their container parameters and
+  * markup summaries, so that questions about the whole corpus are answered
+  * without opening thousands of files. It is kept on disk in a binary file
+  * and refreshed incrementally: only files whose size or modification time
+  * has changed are read again.
+  *
+  * The file starts with a 32 byte header: "VMCATLOG", version, number of
+  * entries, counts and strings and the size of the string pool. Entries of
+  * EntrySize bytes follow, then (key, number) pairs of the type and label
+  * counts of all entries, then (offset, size) of every string and the pool.
+  * Strings (paths, codecs, labels) are stored once. Numbers are little endian
+  */
+class CorpusCatalog
+{
+public:
+  enum
+  {
+    Version = 1,
+    HeaderSize = 32,
+    EntrySize = 96,
+    MaxDepth = 64               ///< directory levels scanned, guards against link loops
+  };
+
+  struct RefreshStats
+  {
+    int videos;       ///< found in the directories
+    int read;         ///< entries whose video or markup had to be read
+    int failed;       ///< videos which could not be probed
+    int removed;      ///< entries of videos which are gone
+  };
+
+  /** @param[out] error If given, gets the reason of a failure
+    * @return false The file cannot be read or is damaged, the catalog is left empty
+    */
+  bool load(const std::string &fileName, std::string *error = 0);
+
+  /** Writes the catalog to a temporary file which then replaces the old one
+    */
+  bool save(const std::string &fileName) const;
+
+  /** Finds videos with the given extensions (like ".avi", compared ignoring
+    * case) in the directories and their subdirectories and brings the
+    * catalog up to date with them. Entries of videos not found are dropped.
+    * Directories are listed and files are read on several threads
+    * @param[in] threads Number of threads, zero or negative - one per CPU core
+    */
+  RefreshStats refresh(const std::vector<std::string> &dirs, const std::vector<std::string> &extensions, int threads = 0);
+
+  /** @return entries sorted by video name
+    */
+  const std::vector<CatalogEntry> &getEntries() const
+  {
+    return _entries;
+  }
+
+private:
+  std::vector<CatalogEntry> _entries;
+};
@@ -0,0 +1,235 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#include "dump_manifest.h"
+#include "fileutil.h"
+#include "logger.h"
+
+namespace {
+  // file records are flushed in batches, a crash may only lose the last few of them;
+  // interval records are synced to the disk, so a complete interval stays complete
+  const int FlushPeriod = 64;
+}
+
+DumpManifest::DumpManifest()
+: _file(0),
+  _unflushed(0),
+  _failed(false)
+{
+}
+
+DumpManifest::~DumpManifest()
+{
+  close();
+}
+
+bool DumpManifest::open(const std::string &fileName, const std::string &directory, const std::string &settings, bool resume)
+{
+  close();
+  _directory = directory;
+  _files.clear();
+  _intervals.clear();
+  _pending.clear();
+  _waiting.clear();
+  _failed = false;
+
+  if (resume && load(fileName, settings))
+  {
+    _file = fopen(fileName.c_str(), "ab");
+    // a line cut short by a crash must not swallow the first new record
+    if (_file)
+      fputs("\n", _file);
+  }
+  else
+  {
+    _files.clear();
+    _intervals.clear();
+    _file = fopen(fileName.c_str(), "wb");
+    if (_file)
+      fprintf(_file, "options %s\n", settings.c_str());
+  }
+  if (!_file)
+  {
+    LOG_ERROR("Cannot open dump manifest '" << fileName << "'");
+    return false;
+  }
+  flush(true);
+  return true;
+}
+
+bool DumpManifest::load(const std::string &fileName, const std::string &settings)
+{
+  FILE *fp = fopen(fileName.c_str(), "rb");
+  if (!fp)
+    return false;
+  bool valid = false;
+  char line[4096];
+  while (fgets(line, sizeof(line), fp))
+  {
+    size_t length = strlen(line);
+    if (length == 0 || line[length - 1] != '\n')
+      break;
+    line[--length] = 0;
+    if (length > 0 && line[length - 1] == '\r')
+      line[--length] = 0;
+
+    if (!strncmp(line, "options ", 8))
+    {
+      valid = (settings == line + 8);
+      if (!valid)
+      {
+        LOG_INFO("Dump settings differ from '" << fileName << "', the dump is started anew");
+        break;
+      }
+      continue;
+    }
+    if (!valid)
+      break;
+
+    long long size;
+    unsigned long long hash;
+    int id, start, end, offset = 0;
+    if (sscanf(line, "file %lld %llx %n", &size, &hash, &offset) == 2 && offset > 0 && line[offset])
+    {
+      FileRecord &record = _files[line + offset];
+      record.size = size;
+      record.hash = hash;
+      record.state = stateUnknown;
+    }
+    else if (sscanf(line, "interval %d %d %d", &id, &start, &end) == 3)
+      _intervals[id] = std::make_pair(start, end);
+  }
+  fclose(fp);
+  return valid;
+}
+
+bool DumpManifest::close()
+{
+  if (!_file)
+    return !_failed;
+  flush(true);
+  if (fclose(_file) != 0)
+    _failed = true;
+  _file = 0;
+  if (_failed)
+    LOG_ERROR("Failed to write dump manifest");
+  return !_failed;
+}
+
+std::string DumpManifest::getRelativeName(const std::string &path) const
+{
+  std::string prefix = _directory + "/";
+  if (path.compare(0, prefix.size(), prefix) == 0)
+    return path.substr(prefix.size());
+  return path;
+}
+
+bool DumpManifest::hasFile(const std::string &path, bool verify)
+{
+  std::map<std::string, FileRecord>::iterator it = _files.find(getRelativeName(path));
+  if (it == _files.end())
+    return false;
+  FileRecord &record = it->second;
+  if (record.state == stateUnknown)
+    record.state = (getFileSize(path) == record.size) ? stateSize : stateBad;
+  if (record.state == stateSize && verify)
+  {
+    uint64_t hash;
+    record.state = (hashFile(path, hash) && hash == record.hash) ? stateHash : stateBad;
+    if (record.state == stateBad)
+      LOG_INFO("'" << path << "' does not match the dump manifest");
+  }
+  return record.state != stateBad;
+}
+
+bool DumpManifest::isIntervalDone(int interval, int start, int end) const
+{
+  std::map<int, std::pair<int, int> >::const_iterator it = _intervals.find(interval);
+  return it != _intervals.end() && it->second.first == start && it->second.second == end;
+}
+
+void DumpManifest::setIntervalDone(int interval, int start, int end)
+{
+  if (isIntervalDone(interval, start, end))
+    return;
+  _intervals[interval] = std::make_pair(start, end);
+  if (_file && fprintf(_file, "interval %d %d %d\n", interval, start, end) < 0)
+    _failed = true;
+  flush(true);
+}
+
+void DumpManifest::expect(int interval, int start, int end, const std::vector<std::string> &files)
+{
+  Pending &pending = _pending[interval];
+  pending.start = start;
+  pending.end = end;
+  pending.remaining = (int) files.size();
+  for (size_t i = 0; i < files.size(); i++)
+    _waiting[files[i]].push_back(interval);
+}
+
+void DumpManifest::saved(const std::vector<std::string> &files, size_t size, uint64_t hash)
+{
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    // names repeat when intervals share frames without per interval directories
+    std::string name = getRelativeName(files[i]);
+    if (std::find(files.begin(), files.begin() + i, files[i]) != files.begin() + i)
+      continue;
+    FileRecord &record = _files[name];
+    record.size = (int64_t) size;
+    record.hash = hash;
+    record.state = stateHash;
+    if (_file && fprintf(_file, "file %lld %016llx %s\n", (long long) size, (unsigned long long) hash, name.c_str()) < 0)
+      _failed = true;
+    _unflushed++;
+
+    std::map<std::string, std::vector<int> >::iterator it = _waiting.find(files[i]);
+    if (it == _waiting.end())
+      continue;
+    for (size_t j = 0; j < it->second.size(); j++)
+    {
+      std::map<int, Pending>::iterator pending = _pending.find(it->second[j]);
+      if (pending != _pending.end() && --pending->second.remaining == 0)
+      {
+        setIntervalDone(pending->first, pending->second.start, pending->second.end);
+        _pending.erase(pending);
+      }
+    }
+    _waiting.erase(it);
+  }
+  flush(false);
+}
+
+void DumpManifest::flush(bool force)
+{
+  if (!_file || (!force && _unflushed < FlushPeriod))
+    return;
+  if (!(force ? syncFile(_file) : fflush(_file) == 0))
+    _failed = true;
+  _unflushed = 0;
+}
@@ -0,0 +1,131 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "dump_pipeline.h"
+
+/** Record of the frames saved by a dump, kept in the dump directory so that
+  * an interrupted dump can be resumed without saving everything again.
+  * It is a text file which is only appended to while frames are saved:
+  *
+  *   options <dump settings>
+  *   file <size> <hash> <name relative to the dump directory>
+  *   interval <id> <first frame> <last frame>
+  *
+  * An "interval" line follows the last file of a completely saved interval.
+  * A line cut short by a crash is ignored when the manifest is loaded.
+  */
+class DumpManifest: public DumpPipeline::Listener
+{
+public:
+  DumpManifest();
+  ~DumpManifest();
+
+  /** Opens the manifest for recording
+    * @param[in] directory Dump directory, names are recorded relative to it
+    * @param[in] settings One line description of the dump settings;
+    *                     records made with different settings are dropped
+    * @param[in] resume Keep the records of earlier runs, otherwise the manifest is started anew
+    * @return false Failure (error is logged)
+    */
+  bool open(const std::string &fileName, const std::string &directory, const std::string &settings, bool resume);
+
+  /** @return false A write error occurred
+    */
+  bool close();
+
+  /** @return true The file is recorded and still has the recorded size
+    *              (and contents if verify is set)
+    */
+  bool hasFile(const std::string &path, bool verify);
+
+  /** @return true The interval was recorded as completely saved
+    */
+  bool isIntervalDone(int interval, int start, int end) const;
+
+  /** Records the interval as completely saved
+    */
+  void setIntervalDone(int interval, int start, int end);
+
+  /** Tells which files of the interval are still to be saved. The interval is
+    * recorded as done when the last of them is saved
+    */
+  void expect(int interval, int start, int end, const std::vector<std::string> &files);
+
+  /** DumpPipeline::Listener
+    */
+  void saved(const std::vector<std::string> &files, size_t size, uint64_t hash);
+
+  /** @return number of files recorded by earlier runs
+    */
+  int getRecordedFiles() const
+  {
+    return (int) _files.size();
+  }
+
+private:
+  DumpManifest(const DumpManifest &);
+  DumpManifest &operator= (const DumpManifest &);
+
+  enum State
+  {
+    stateUnknown,
+    stateSize,        ///< size matched
+    stateHash,        ///< contents matched
+    stateBad
+  };
+
+  struct FileRecord
+  {
+    int64_t size;
+    uint64_t hash;
+    State state;
+  };
+
+  struct Pending
+  {
+    int start;
+    int end;
+    int remaining;    ///< files to be saved
+  };
+
+  bool load(const std::string &fileName, const std::string &settings);
+  std::string getRelativeName(const std::string &path) const;
+  void flush(bool force);
+
+  FILE *_file;
+  std::string _directory;
+  std::map<std::string, FileRecord> _files;
+  std::map<int, std::pair<int, int> > _intervals;       ///< done intervals and their frame ranges
+  std::map<int, Pending> _pending;
+  std::map<std::string, std::vector<int> > _waiting;    ///< intervals waiting for the file
+  int _unflushed;
+  bool _failed;
+};
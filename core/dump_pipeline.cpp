@@ -0,0 +1,275 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <boost/bind.hpp>
+
+#include "dump_pipeline.h"
+#include "frame_writer.h"
+#include "fileutil.h"
+#include "parallel.h"
+#include "stopwatch.h"
+#include "logger.h"
+
+namespace {
+  // one clock for all stages, so the intervals measured by different threads are comparable
+  double now()
+  {
+    static Stopwatch clock;
+    return clock.elapsed();
+  }
+
+  double rate(long frames, double seconds)
+  {
+    return seconds > 0 ? frames / seconds : 0;
+  }
+}
+
+DumpPipeline::DumpPipeline(FrameWriter &writer, int threads, AsyncFileWriter::Backend io, Listener *listener)
+: _writer(writer),
+  _listener(listener),
+  _io(IoQueueDepth, io),
+  _pushed(0),
+  _nextToWrite(0),
+  _inFlight(0),
+  _finishing(false),
+  _failed(false),
+  _writerThread(0)
+{
+  if (threads <= 0)
+    threads = getHardwareThreads();
+  if (!writer.isThreadSafe())
+    threads = 1;
+  // enough to keep every encoder busy while the writer is behind by a few frames
+  // and the disk has a full queue
+  _maxInFlight = 2 * threads + 2 + IoQueueDepth;
+
+  _stats.frames = _stats.files = 0;
+  _stats.encoders = threads;
+  _stats.decodeTime = _stats.encodeTime = _stats.writeTime = _stats.stallTime = _stats.totalTime = 0;
+  _stats.io = _io.getBackendName();
+  _stats.ioStats = _io.getStatistics();
+  _startTime = _lastPushTime = now();
+
+  for (int i = 0; i < threads; i++)
+    _encoders.create_thread(boost::bind(&DumpPipeline::encodeLoop, this));
+  _writerThread = new boost::thread(boost::bind(&DumpPipeline::writeLoop, this));
+}
+
+DumpPipeline::~DumpPipeline()
+{
+  finish();
+  for (size_t i = 0; i < _freeData.size(); i++)
+    delete _freeData[i];
+}
+
+bool DumpPipeline::push(const FrameRef &frame, const std::vector<std::string> &files)
+{
+  double pushTime = now();
+  Job *job = new Job;
+  job->frame = frame;
+  job->files = files;
+  job->data = 0;
+  job->hash = 0;
+  job->ok = false;
+
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  _stats.decodeTime += pushTime - _lastPushTime;
+  if (_finishing || _failed)
+  {
+    delete job;
+    _lastPushTime = now();
+    return false;
+  }
+  while (_inFlight >= _maxInFlight && !_failed)
+    _slotFree.wait(lock);
+  job->seq = _pushed++;
+  _inFlight++;
+  _input.push_back(job);
+  _inputReady.notify_one();
+  _lastPushTime = now();
+  _stats.stallTime += _lastPushTime - pushTime;
+  return !_failed;
+}
+
+bool DumpPipeline::finish()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    if (!_writerThread)
+      return !_failed;
+    _finishing = true;
+    _inputReady.notify_all();
+    _outputReady.notify_all();
+  }
+  _encoders.join_all();
+  _writerThread->join();
+  delete _writerThread;
+  _writerThread = 0;
+  _stats.totalTime = now() - _startTime;
+  return !_failed;
+}
+
+void DumpPipeline::encodeLoop()
+{
+  for (;;)
+  {
+    Job *job;
+    bool skip;
+    {
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      while (_input.empty() && !_finishing)
+        _inputReady.wait(lock);
+      if (_input.empty())
+        return;
+      job = _input.front();
+      _input.pop_front();
+      if (_freeData.empty())
+        job->data = new std::vector<uint8_t>;
+      else
+      {
+        job->data = _freeData.back();
+        _freeData.pop_back();
+      }
+      skip = _failed;
+    }
+
+    double start = now();
+    // after a failure the remaining frames are only drained
+    job->ok = !skip && !job->frame.isNull() && _writer.encode(*job->frame.get(), *job->data);
+    job->frame.release();
+    if (job->ok && _listener)
+      job->hash = hashData(job->data->empty() ? 0 : &(*job->data)[0], job->data->size());
+    double time = now() - start;
+
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _stats.encodeTime += time;
+    _encoded[job->seq] = job;
+    _outputReady.notify_one();
+  }
+}
+
+void DumpPipeline::writeLoop()
+{
+  std::vector<AsyncFileWriter::Completion> done;
+  for (;;)
+  {
+    Job *job = 0;
+    {
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      // with files in flight there is something to do besides waiting for the encoders
+      while (_encoded.find(_nextToWrite) == _encoded.end() && !(_finishing && _nextToWrite == _pushed)
+             && _io.getPending() == 0)
+        _outputReady.wait(lock);
+      std::map<long, Job *>::iterator it = _encoded.find(_nextToWrite);
+      if (it != _encoded.end())
+      {
+        job = it->second;
+        _encoded.erase(it);
+        _nextToWrite++;
+      }
+      else if (_io.getPending() == 0)
+        return;
+    }
+
+    double start = now();
+    if (job)
+    {
+      // only the writer sets the failure flag, so it may be read here without locking
+      if (job->ok && !job->files.empty() && !_failed)
+      {
+        const std::vector<uint8_t> &data = *job->data;
+        if (!_io.submit(job->files[0], data.empty() ? 0 : &data[0], data.size(), job))
+          finishJob(job, false);
+      }
+      else
+        finishJob(job, false);
+      _io.reap(done, false);
+    }
+    else
+      _io.reap(done, true);
+    for (size_t i = 0; i < done.size(); i++)
+      finishJob((Job *) done[i].cookie, done[i].ok);
+    done.clear();
+    double time = now() - start;
+
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _stats.writeTime += time;
+    _stats.ioStats = _io.getStatistics();
+  }
+}
+
+void DumpPipeline::finishJob(Job *job, bool ok)
+{
+  long files = 0;
+  if (ok)
+  {
+    files++;
+    // the frame is saved once, other intervals get links to the same file
+    for (size_t i = 1; i < job->files.size() && ok; i++)
+      if (job->files[i] != job->files[0])
+      {
+        ok = linkOrCopyFile(job->files[0], job->files[i]);
+        files++;
+      }
+  }
+  if (!ok && !_failed && !job->files.empty())
+    LOG_ERROR("Failed to save " << job->files[0]);
+  if (ok && _listener)
+    _listener->saved(job->files, job->data->size(), job->hash);
+
+  boost::lock_guard<boost::mutex> lock(_mutex);
+  if (ok)
+  {
+    _stats.frames++;
+    _stats.files += files;
+  }
+  else
+    _failed = true;
+  _freeData.push_back(job->data);
+  delete job;
+  _inFlight--;
+  _slotFree.notify_one();
+}
+
+DumpPipeline::Statistics DumpPipeline::getStatistics() const
+{
+  boost::lock_guard<boost::mutex> lock(_mutex);
+  return _stats;
+}
+
+void DumpPipeline::logStatistics() const
+{
+  Statistics stats = getStatistics();
+  LOG_INFO(stats.frames << " frame(s) saved, " << stats.files - stats.frames << " linked in "
+    << stats.totalTime << " s, " << rate(stats.frames, stats.totalTime) << " fps");
+  LOG_INFO("decode: " << rate(stats.frames, stats.decodeTime) << " fps, "
+    << "encode: " << rate(stats.frames, stats.encodeTime) << " fps per thread x " << stats.encoders << ", "
+    << "write: " << rate(stats.frames, stats.writeTime) << " fps, "
+    << "decoder stalled for " << stats.stallTime << " s");
+  const AsyncFileWriter::Statistics &io = stats.ioStats;
+  if (io.files > 0)
+    LOG_INFO(stats.io << ": " << io.files << " file(s), " << io.bytes / 1048576.0 << " MiB, queue depth "
+      << io.depthSum / io.files << " average, " << io.maxDepth << " max, latency "
+      << 1000 * io.latency / io.files << " ms average, " << 1000 * io.maxLatency << " ms max");
+}
@@ -0,0 +1,163 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <framepool.h>
+
+#include "async_file_writer.h"
+
+class FrameWriter;
+
+/** Encodes and saves decoded frames in background threads.
+  * The caller (decode stage) pushes frames in the order they are read, a
+  * number of encoder threads turn them into file images in parallel, and a
+  * single writer thread hands the results to AsyncFileWriter strictly in push
+  * order, keeping many files in flight.
+  * Frames are passed around as FrameRef handles, so nothing is copied and
+  * decoder buffers go back to their pool as soon as a frame is encoded;
+  * encoded file images are recycled as well.
+  * The number of frames in flight is bounded, push() blocks when the
+  * encoders or the disk fall behind.
+  */
+class DumpPipeline
+{
+public:
+  struct Statistics
+  {
+    long frames;          ///< frames written
+    long files;           ///< files written or linked
+    int encoders;         ///< number of encoder threads
+    double decodeTime;    ///< seconds spent by the caller between push() calls
+    double encodeTime;    ///< seconds spent encoding, summed over all encoders
+    double writeTime;     ///< seconds spent writing and linking files
+    double stallTime;     ///< seconds push() waited for a free slot
+    double totalTime;     ///< seconds from construction to finish()
+    const char *io;       ///< file writer backend
+    AsyncFileWriter::Statistics ioStats;
+  };
+
+  enum
+  {
+    IoQueueDepth = 16     ///< files being written at once
+  };
+
+  /** Gets to know about every saved frame, e.g. to keep a record of the work done.
+    * Called from the writer thread
+    */
+  class Listener
+  {
+  public:
+    virtual ~Listener()
+    {
+    }
+
+    /** @param[in] files Files of the frame, the first one is written and the others are linked to it
+      * @param[in] hash hashData() of the file contents
+      */
+    virtual void saved(const std::vector<std::string> &files, size_t size, uint64_t hash) = 0;
+  };
+
+  /** @param[in] threads Number of encoder threads, 0 - one per processor core.
+    *                    Writers which are not thread safe always get one
+    * @param[in] io How files are written
+    * @param[in] listener Optional, must outlive the pipeline
+    */
+  DumpPipeline(FrameWriter &writer, int threads = 0, AsyncFileWriter::Backend io = AsyncFileWriter::backendAuto,
+               Listener *listener = 0);
+
+  /** Waits for the queued frames if finish() was not called
+    */
+  ~DumpPipeline();
+
+  /** Queue a frame for saving. The frame is encoded once and written to the
+    * first file, the other files get links to it
+    * @return false Some earlier frame has failed, no point in pushing more
+    */
+  bool push(const FrameRef &frame, const std::vector<std::string> &files);
+
+  /** Waits until all queued frames are written and stops the threads
+    * @return true every frame has been saved
+    */
+  bool finish();
+
+  Statistics getStatistics() const;
+
+  /** Prints frame rates of the stages to the log
+    */
+  void logStatistics() const;
+
+private:
+  DumpPipeline(const DumpPipeline &);
+  DumpPipeline &operator= (const DumpPipeline &);
+
+  struct Job
+  {
+    long seq;
+    FrameRef frame;
+    std::vector<std::string> files;
+    std::vector<uint8_t> *data;
+    uint64_t hash;
+    bool ok;
+  };
+
+  void encodeLoop();
+  void writeLoop();
+  void finishJob(Job *job, bool ok);
+
+  FrameWriter &_writer;
+  Listener *_listener;
+  AsyncFileWriter _io;                        ///< used by the writer thread only
+  int _maxInFlight;
+
+  mutable boost::mutex _mutex;
+  boost::condition_variable _inputReady;      ///< signalled to encoders
+  boost::condition_variable _outputReady;     ///< signalled to the writer
+  boost::condition_variable _slotFree;        ///< signalled to push()
+
+  std::deque<Job *> _input;
+  std::map<long, Job *> _encoded;             ///< waiting for their turn to be written
+  std::vector<std::vector<uint8_t> *> _freeData;
+  long _pushed;
+  long _nextToWrite;
+  int _inFlight;
+  bool _finishing;
+  bool _failed;
+
+  Statistics _stats;
+  double _startTime;
+  double _lastPushTime;
+
+  boost::thread_group _encoders;
+  boost::thread *_writerThread;
+};
@@ -0,0 +1,180 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "dump_plan.h"
+
+namespace {
+  bool itemLess(const DumpPlan::Item &a, const DumpPlan::Item &b)
+  {
+    return a.start < b.start || (a.start == b.start && a.interval < b.interval);
+  }
+}
+
+bool DumpOptions::hasRegion() const
+{
+  return cropX || cropY || cropWidth || cropHeight || cropAroundBorder || outputWidth || outputHeight;
+}
+
+bool DumpOptions::parseCrop(const std::string &spec)
+{
+  int x, y, width, height;
+  char tail[16] = "";
+  int fields = sscanf(spec.c_str(), "%d,%d,%d,%d,%15s", &x, &y, &width, &height, tail);
+  if (fields < 4 || (fields == 5 && strcmp(tail, "border")) || width < 0 || height < 0)
+    return false;
+  cropX = x;
+  cropY = y;
+  cropWidth = width;
+  cropHeight = height;
+  cropAroundBorder = (fields == 5);
+  return true;
+}
+
+bool DumpOptions::parseOutputSize(const std::string &spec)
+{
+  int width, height;
+  char extra;
+  if (sscanf(spec.c_str(), "%dx%d%c", &width, &height, &extra) != 2 || width <= 0 || height <= 0)
+    return false;
+  outputWidth = width;
+  outputHeight = height;
+  return true;
+}
+
+bool DumpOptions::isRegionValid(int frameWidth, int frameHeight) const
+{
+  FrameRegion region = getRegion(video_markup::Interval(), frameWidth, frameHeight);
+  return region.width > 0 && region.height > 0;
+}
+
+FrameRegion DumpOptions::getRegion(const video_markup::Interval &interval, int frameWidth, int frameHeight) const
+{
+  FrameRegion region;
+  region.x = cropX;
+  region.y = cropY;
+  if (cropAroundBorder)
+    region.y += (interval.y_border >= 0) ? interval.y_border : frameHeight / 2;
+  region.width = std::min(cropWidth > 0 ? cropWidth : frameWidth - cropX, frameWidth);
+  region.height = std::min(cropHeight > 0 ? cropHeight : frameHeight - cropY, frameHeight);
+  region.x = std::max(0, std::min(region.x, frameWidth - region.width));
+  region.y = std::max(0, std::min(region.y, frameHeight - region.height));
+  region.outputWidth = outputWidth;
+  region.outputHeight = outputHeight;
+  return region;
+}
+
+std::string DumpOptions::getIntervalDir(int interval) const
+{
+  if (!perIntervalDirs)
+    return directory;
+  char buf[32];
+  sprintf(buf, "_interval%04d", interval);
+  return directory + "/" + prefix + buf;
+}
+
+std::string DumpOptions::getFileName(int interval, int frame, const char *extension) const
+{
+  char buf[32];
+  sprintf(buf, "_%08d.", frame);
+  return getIntervalDir(interval) + "/" + prefix + buf + extension;
+}
+
+std::string DumpOptions::getManifestName() const
+{
+  return directory + "/" + prefix + ".manifest";
+}
+
+std::string DumpOptions::getPackName(int interval) const
+{
+  if (!perIntervalDirs)
+    return directory + "/" + prefix + ".vmp";
+  char buf[32];
+  sprintf(buf, "_interval%04d.vmp", interval);
+  return directory + "/" + prefix + buf;
+}
+
+std::string DumpOptions::getClipName(int interval, const std::string &extension) const
+{
+  char buf[32];
+  sprintf(buf, "_interval%04d", interval);
+  return directory + "/" + prefix + buf + extension;
+}
+
+void DumpPlan::build(const video_markup::Markup &markup, const std::vector<int> &intervals, int margin, int totalFrames)
+{
+  std::vector<Item> items;
+  for (size_t i = 0; i < intervals.size(); i++)
+  {
+    int id = intervals[i];
+    if (id < 0 || id >= (int) markup.size())
+      continue;
+    Item item;
+    item.interval = id;
+    item.start = std::max(markup[id].start - margin, 0);
+    item.end = markup[id].end + margin;
+    if (totalFrames > 0)
+      item.end = std::min(item.end, totalFrames - 1);
+    if (item.start > item.end)
+      continue;
+    items.push_back(item);
+  }
+  build(items);
+}
+
+void DumpPlan::build(const std::vector<Item> &items)
+{
+  std::vector<Item> sorted(items);
+  std::sort(sorted.begin(), sorted.end(), itemLess);
+  _items.swap(sorted);
+  _ranges.clear();
+  _frameCount = _outputCount = 0;
+
+  for (size_t i = 0; i < _items.size(); i++)
+  {
+    _outputCount += _items[i].end - _items[i].start + 1;
+    if (!_ranges.empty() && _items[i].start <= _ranges.back().end + 1)
+    {
+      _ranges.back().end = std::max(_ranges.back().end, _items[i].end);
+      continue;
+    }
+    Range range;
+    range.start = _items[i].start;
+    range.end = _items[i].end;
+    _ranges.push_back(range);
+  }
+  for (size_t i = 0; i < _ranges.size(); i++)
+    _frameCount += _ranges[i].end - _ranges[i].start + 1;
+}
+
+void DumpPlan::build(const video_markup::Markup &markup, int margin, int totalFrames)
+{
+  std::vector<int> intervals(markup.size());
+  for (size_t i = 0; i < intervals.size(); i++)
+    intervals[i] = (int) i;
+  build(markup, intervals, margin, totalFrames);
+}
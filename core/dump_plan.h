@@ -0,0 +1,209 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <videoreader.h>
+#include "video_markup.h"
+#include "async_file_writer.h"
+
+/** Where and how dumped frames are stored
+  */
+struct DumpOptions
+{
+  DumpOptions()
+  : margin(20),
+    perIntervalDirs(false),
+    threads(0),
+    io(AsyncFileWriter::backendAuto),
+    resume(false),
+    verify(false),
+    cropX(0),
+    cropY(0),
+    cropWidth(0),
+    cropHeight(0),
+    cropAroundBorder(false),
+    outputWidth(0),
+    outputHeight(0)
+  {
+  }
+
+  std::string directory;
+  std::string prefix;       ///< file name prefix, usually the short video name
+  int margin;               ///< number of frames dumped before and after each interval
+  bool perIntervalDirs;     ///< every interval gets its own subdirectory (or frame pack)
+  int threads;              ///< number of encoding threads, 0 - one per processor core
+  AsyncFileWriter::Backend io;  ///< how image files are written
+  bool resume;              ///< frames recorded in the manifest by an earlier run are not saved again
+  bool verify;              ///< when resuming, check hashes of the existing files of partly saved intervals, not only their sizes
+
+  // part of the frame to be dumped, by default the whole frame is saved
+  int cropX;
+  int cropY;                ///< relative to y_border if cropAroundBorder is set
+  int cropWidth;            ///< 0 - up to the right edge of the frame
+  int cropHeight;           ///< 0 - up to the bottom edge of the frame
+  bool cropAroundBorder;    ///< crop rectangle follows y_border of each interval
+  int outputWidth;          ///< dumped frames are scaled to this size, 0 - no scaling
+  int outputHeight;
+
+  /** @return true only a part of the frame is dumped or frames are scaled
+    */
+  bool hasRegion() const;
+
+  /** Parses crop rectangle "X,Y,W,H" optionally followed by ",border"
+    * @return false Invalid format
+    */
+  bool parseCrop(const std::string &spec);
+
+  /** Parses output size "WxH"
+    * @return false Invalid format
+    */
+  bool parseOutputSize(const std::string &spec);
+
+  /** @return false The crop leaves nothing of frames of the given size: it
+    *         starts beyond their right or bottom edge and has no size of its own
+    */
+  bool isRegionValid(int frameWidth, int frameHeight) const;
+
+  /** Region of the frame dumped for the interval. The rectangle is moved
+    * inside the frame if it sticks out, so its size is the same for all
+    * intervals. Intervals without y_border are cropped around the frame middle.
+    * Only meaningful if isRegionValid()
+    */
+  FrameRegion getRegion(const video_markup::Interval &interval, int frameWidth, int frameHeight) const;
+
+  /** @return name of the directory the given interval is dumped to
+    */
+  std::string getIntervalDir(int interval) const;
+
+  /** @return name of the file the given frame of the given interval is dumped to
+    */
+  std::string getFileName(int interval, int frame, const char *extension) const;
+
+  /** @return name of the manifest recording the saved frames
+    */
+  std::string getManifestName() const;
+
+  /** @return name of the frame pack the given interval is dumped to
+    *         (one pack for all intervals unless perIntervalDirs is set)
+    */
+  std::string getPackName(int interval) const;
+
+  /** @return name of the video clip the given interval is exported to
+    */
+  std::string getClipName(int interval, const std::string &extension) const;
+};
+
+/** What a dump has actually done
+  */
+struct DumpStatistics
+{
+  DumpStatistics()
+  : written(0),
+    linked(0),
+    skipped(0)
+  {
+  }
+
+  long written;             ///< frames encoded (or copied to clips) and written
+  long linked;              ///< files linked to a frame written for another interval
+  long skipped;             ///< files already saved by an earlier run
+};
+
+/** Sequential plan of dumping a set of intervals.
+  * Margin-extended intervals are sorted and merged into disjoint frame ranges,
+  * so the video can be decoded once from front to back and every needed frame
+  * is visited exactly once, even when margins of neighbouring intervals overlap.
+  */
+class DumpPlan
+{
+public:
+  struct Item
+  {
+    int interval;     ///< interval id in the markup
+    int start;        ///< first frame to dump (interval start minus margin)
+    int end;          ///< last frame to dump (interval end plus margin)
+  };
+
+  struct Range
+  {
+    int start;
+    int end;
+  };
+
+  DumpPlan()
+  : _frameCount(0),
+    _outputCount(0)
+  {
+  }
+
+  /** @param[in] intervals Ids of the intervals to be dumped
+    * @param[in] totalFrames Number of frames in the video or negative if not known
+    */
+  void build(const video_markup::Markup &markup, const std::vector<int> &intervals, int margin, int totalFrames);
+
+  /** Builds a plan for all intervals of the markup
+    */
+  void build(const video_markup::Markup &markup, int margin, int totalFrames);
+
+  /** Builds a plan for the given items, e.g. for a part of another plan
+    */
+  void build(const std::vector<Item> &items);
+
+  /** @return items sorted by start frame
+    */
+  const std::vector<Item> &getItems() const
+  {
+    return _items;
+  }
+
+  /** @return disjoint frame ranges in increasing order
+    */
+  const std::vector<Range> &getRanges() const
+  {
+    return _ranges;
+  }
+
+  /** @return number of distinct frames to be decoded and saved
+    */
+  long getFrameCount() const
+  {
+    return _frameCount;
+  }
+
+  /** @return number of (interval, frame) pairs, i.e. frames counted once per interval
+    */
+  long getOutputCount() const
+  {
+    return _outputCount;
+  }
+
+private:
+  std::vector<Item> _items;
+  std::vector<Range> _ranges;
+  long _frameCount;
+  long _outputCount;
+};
@@ -0,0 +1,366 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# include <windows.h>
+# include <direct.h>
+# include <io.h>
+#else
+# include <unistd.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <dirent.h>
+#endif
+
+#include "fileutil.h"
+
+bool makeDir(const std::string &path)
+{
+#ifdef _WIN32
+  int res = _mkdir(path.c_str());
+#else
+  int res = mkdir(path.c_str(), 0777);
+#endif
+  return res == 0 || errno == EEXIST;
+}
+
+static bool copyFile(const std::string &existingPath, const std::string &newPath)
+{
+  FILE *src = fopen(existingPath.c_str(), "rb");
+  if (!src)
+    return false;
+  FILE *dst = fopen(newPath.c_str(), "wb");
+  if (!dst)
+  {
+    fclose(src);
+    return false;
+  }
+  bool ok = true;
+  char buf[65536];
+  size_t size;
+  while (ok && (size = fread(buf, 1, sizeof(buf), src)) > 0)
+    ok = fwrite(buf, 1, size, dst) == size;
+  if (ferror(src))
+    ok = false;
+  fclose(src);
+  if (fclose(dst) != 0)
+    ok = false;
+  return ok;
+}
+
+bool linkOrCopyFile(const std::string &existingPath, const std::string &newPath)
+{
+  // an existing file is replaced, as it is done when a frame is written
+  remove(newPath.c_str());
+#ifdef _WIN32
+  if (CreateHardLinkA(newPath.c_str(), existingPath.c_str(), 0))
+    return true;
+#else
+  if (link(existingPath.c_str(), newPath.c_str()) == 0)
+    return true;
+#endif
+  return copyFile(existingPath, newPath);
+}
+
+bool writeFile(const std::string &path, const void *data, size_t size)
+{
+  FILE *fp = fopen(path.c_str(), "wb");
+  if (!fp)
+    return false;
+  bool ok = size == 0 || fwrite(data, size, 1, fp) == 1;
+  if (fclose(fp) != 0)
+    ok = false;
+  return ok;
+}
+
+int64_t getFileSize(const std::string &path)
+{
+#ifdef _WIN32
+  struct _stati64 st;
+  if (_stati64(path.c_str(), &st) != 0)
+    return -1;
+#else
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return -1;
+#endif
+  return (int64_t) st.st_size;
+}
+
+bool getFileInfo(const std::string &path, int64_t &size, int64_t &modified)
+{
+#ifdef _WIN32
+  struct _stati64 st;
+  if (_stati64(path.c_str(), &st) != 0)
+    return false;
+#else
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return false;
+#endif
+  size = (int64_t) st.st_size;
+  modified = (int64_t) st.st_mtime;
+  return true;
+}
+
+bool listDir(const std::string &path, std::vector<std::string> &files, std::vector<std::string> &dirs)
+{
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE find = FindFirstFileA((path + "\\*").c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE)
+    return false;
+  do
+  {
+    std::string name = data.cFileName;
+    if (name == "." || name == "..")
+      continue;
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      dirs.push_back(name);
+    else
+      files.push_back(name);
+  }
+  while (FindNextFileA(find, &data));
+  FindClose(find);
+#else
+  DIR *dir = opendir(path.c_str());
+  if (!dir)
+    return false;
+  while (struct dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    if (name == "." || name == "..")
+      continue;
+    bool isDir = entry->d_type == DT_DIR;
+    if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+    {
+      struct stat st;
+      isDir = stat((path + "/" + name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    if (isDir)
+      dirs.push_back(name);
+    else
+      files.push_back(name);
+  }
+  closedir(dir);
+#endif
+  return true;
+}
+
+bool syncFile(FILE *fp)
+{
+  if (fflush(fp) != 0)
+    return false;
+#ifdef _WIN32
+  return _commit(_fileno(fp)) == 0;
+#else
+  return fsync(fileno(fp)) == 0;
+#endif
+}
+
+bool replaceFile(const std::string &existingPath, const std::string &newPath)
+{
+#ifdef _WIN32
+  return MoveFileExA(existingPath.c_str(), newPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return rename(existingPath.c_str(), newPath.c_str()) == 0;
+#endif
+}
+
+namespace {
+  enum
+  {
+    CacheHeaderSize = 40
+  };
+}
+
+bool saveVideoCache(const std::string &cacheName, const std::string &videoName, const char *magic,
+                    uint32_t version, uint32_t recordSize, const std::vector<uint8_t> &records)
+{
+  int64_t videoSize, videoTime;
+  if (recordSize == 0 || !getFileInfo(videoName, videoSize, videoTime))
+    return false;
+
+  uint8_t header[CacheHeaderSize];
+  memcpy(header, magic, 8);
+  putLE32(header + 8, version);
+  putLE32(header + 12, recordSize);
+  putLE32(header + 16, (uint32_t) (records.size() / recordSize));
+  putLE32(header + 20, 0);
+  putLE64(header + 24, (uint64_t) videoSize);
+  putLE64(header + 32, (uint64_t) videoTime);
+
+  std::string tempName = cacheName + ".new";
+  FILE *fp = fopen(tempName.c_str(), "wb");
+  if (!fp)
+    return false;
+  bool ok = fwrite(header, 1, CacheHeaderSize, fp) == CacheHeaderSize
+    && (records.empty() || fwrite(&records[0], 1, records.size(), fp) == records.size());
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok)
+  {
+    remove(tempName.c_str());
+    return false;
+  }
+  return replaceFile(tempName, cacheName);
+}
+
+bool loadVideoCache(const std::string &cacheName, const std::string &videoName, const char *magic,
+                    uint32_t version, uint32_t &recordSize, std::vector<uint8_t> &records)
+{
+  records.clear();
+  int64_t videoSize, videoTime;
+  if (!getFileInfo(videoName, videoSize, videoTime))
+    return false;
+
+  FILE *fp = fopen(cacheName.c_str(), "rb");
+  if (!fp)
+    return false;
+  uint8_t header[CacheHeaderSize];
+  bool ok = fread(header, 1, CacheHeaderSize, fp) == CacheHeaderSize
+    && !memcmp(header, magic, 8)
+    && getLE32(header + 8) == version
+    && getLE64(header + 24) == (uint64_t) videoSize
+    && getLE64(header + 32) == (uint64_t) videoTime;
+  // the records must fill the file exactly, a damaged header must not ask for a huge buffer
+  recordSize = ok ? getLE32(header + 12) : 0;
+  uint64_t size = (uint64_t) recordSize * (ok ? getLE32(header + 16) : 0);
+  ok = ok && recordSize > 0 && getFileSize(cacheName) == CacheHeaderSize + (int64_t) size;
+  if (ok && size > 0)
+  {
+    records.resize((size_t) size);
+    ok = fread(&records[0], 1, records.size(), fp) == records.size();
+  }
+  fclose(fp);
+  if (!ok)
+    records.clear();
+  return ok;
+}
+
+uint64_t hashData(const void *data, size_t size, uint64_t hash)
+{
+  const uint8_t *p = (const uint8_t *) data;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool hashFile(const std::string &path, uint64_t &hash)
+{
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (!fp)
+    return false;
+  hash = hashData(0, 0);
+  char buf[65536];
+  size_t size;
+  while ((size = fread(buf, 1, sizeof(buf), fp)) > 0)
+    hash = hashData(buf, size, hash);
+  bool ok = !ferror(fp);
+  fclose(fp);
+  return ok;
+}
+
+MappedFile::MappedFile()
+: _data(0),
+  _size(0)
+#ifdef _WIN32
+  , _file(INVALID_HANDLE_VALUE),
+  _mapping(0)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+  close();
+#ifdef _WIN32
+  _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  if (_file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0 || (uint64_t) size.QuadPart > (size_t) -1)
+  {
+    close();
+    return false;
+  }
+  _mapping = CreateFileMappingA(_file, 0, PAGE_READONLY, 0, 0, 0);
+  void *data = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+  if (!data)
+  {
+    close();
+    return false;
+  }
+  _data = (const uint8_t *) data;
+  _size = (size_t) size.QuadPart;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t) st.st_size <= (size_t) -1)
+    data = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  _data = (const uint8_t *) data;
+  _size = (size_t) st.st_size;
+#endif
+  return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+  if (_data)
+    UnmapViewOfFile(_data);
+  if (_mapping)
+    CloseHandle(_mapping);
+  if (_file != INVALID_HANDLE_VALUE)
+    CloseHandle(_file);
+  _mapping = 0;
+  _file = INVALID_HANDLE_VALUE;
+#else
+  if (_data)
+    munmap((void *) _data, _size);
+#endif
+  _data = 0;
+  _size = 0;
+}
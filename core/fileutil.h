@@ -0,0 +1,165 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdio>
+#include <stdint.h>
+
+/** Creates a directory if it does not exist
+  * @return false Failure
+  */
+bool makeDir(const std::string &path);
+
+/** Makes newPath a hard link to existingPath. If hard links are not supported
+  * by the file system the file is copied
+  * @return false Failure
+  */
+bool linkOrCopyFile(const std::string &existingPath, const std::string &newPath);
+
+/** Creates (or truncates) a file and writes the data into it
+  * @return false Failure
+  */
+bool writeFile(const std::string &path, const void *data, size_t size);
+
+/** @return size of the file in bytes
+  * @return -1 The file does not exist
+  */
+int64_t getFileSize(const std::string &path);
+
+/** @param[out] size Size of the file in bytes
+  * @param[out] modified Modification time in seconds since 1970
+  * @return false The file does not exist
+  */
+bool getFileInfo(const std::string &path, int64_t &size, int64_t &modified);
+
+/** Lists names of the files and subdirectories of a directory
+  * ("." and ".." are skipped), in no particular order
+  * @return false The directory cannot be read
+  */
+bool listDir(const std::string &path, std::vector<std::string> &files, std::vector<std::string> &dirs);
+
+/** Flushes the stream and waits until its data reaches the disk
+  * @return false Failure
+  */
+bool syncFile(FILE *fp);
+
+/** Renames a file replacing the existing one, atomically where the system allows it
+  * @return false Failure
+  */
+bool replaceFile(const std::string &existingPath, const std::string &newPath);
+
+/** Writes a video cache file: a header (the magic, the version, the records'
+  * size and count, the size and modification time of the video) followed by
+  * the records. The file is written under a temporary name which then
+  * replaces the old cache
+  * @param[in] magic 8 characters telling the kind of the cache
+  * @param[in] records Records of recordSize bytes each
+  * @return false Failure
+  */
+bool saveVideoCache(const std::string &cacheName, const std::string &videoName, const char *magic,
+                    uint32_t version, uint32_t recordSize, const std::vector<uint8_t> &records);
+
+/** Reads a cache written by saveVideoCache(). It is taken only if it is of
+  * the same kind and version, was made from the same video (its size and
+  * modification time are checked) and the record count matches the file size
+  * @param[out] recordSize Size of a record, not 0
+  * @return false No valid cache
+  */
+bool loadVideoCache(const std::string &cacheName, const std::string &videoName, const char *magic,
+                    uint32_t version, uint32_t &recordSize, std::vector<uint8_t> &records);
+
+/** Little endian numbers of binary files
+  */
+inline void putLE32(uint8_t *p, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = (uint8_t) (value >> (8 * i));
+}
+
+inline void putLE64(uint8_t *p, uint64_t value)
+{
+  putLE32(p, (uint32_t) value);
+  putLE32(p + 4, (uint32_t) (value >> 32));
+}
+
+inline uint32_t getLE32(const uint8_t *p)
+{
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+inline uint64_t getLE64(const uint8_t *p)
+{
+  return (uint64_t) getLE32(p) | ((uint64_t) getLE32(p + 4) << 32);
+}
+
+/** 64-bit FNV-1a hash. Pass the previous result to continue hashing
+  */
+uint64_t hashData(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+/** Computes hashData() of the whole file
+  * @return false The file cannot be read
+  */
+bool hashFile(const std::string &path, uint64_t &hash);
+
+/** Read-only view of a whole file mapped into memory
+  */
+class MappedFile
+{
+public:
+  MappedFile();
+
+  /** Unmaps the file if it is still mapped
+    */
+  ~MappedFile();
+
+  /** @return false Failure (the file cannot be opened or is empty)
+    */
+  bool open(const std::string &path);
+  void close();
+
+  const uint8_t *getData() const
+  {
+    return _data;
+  }
+
+  size_t getSize() const
+  {
+    return _size;
+  }
+
+private:
+  MappedFile(const MappedFile &);
+  MappedFile &operator= (const MappedFile &);
+
+  const uint8_t *_data;
+  size_t _size;
+#ifdef _WIN32
+  void *_file;
+  void *_mapping;
+#endif
+};
@@ -0,0 +1,247 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#include <videoreader.h>
+
+#include "frame_defects.h"
+#include "activity.h"
+#include "image_kernels.h"
+#include "video_pass.h"
+#include "fileutil.h"
+#include "logger.h"
+
+namespace {
+  const char Magic[8] = {'V', 'M', 'D', 'E', 'F', 'E', 'C', 'T'};
+
+  enum
+  {
+    Version = 2,
+    RecordSize = 14     ///< hash, difference, mean and peak luma of a frame
+  };
+
+  /** Fingerprints of the frames of a chunk, next to their differences
+    * (see LumaDifferences)
+    */
+  class FingerprintPass: public VideoPass
+  {
+  public:
+    FingerprintPass(std::vector<uint64_t> &hashes, std::vector<float> &differences,
+                    std::vector<uint8_t> &means, std::vector<uint8_t> &peaks)
+    : _hashes(hashes),
+      _differences(differences),
+      _means(means),
+      _peaks(peaks)
+    {
+    }
+
+    class Fingerprints: public LumaDifferences
+    {
+    public:
+      Fingerprints(int first)
+      : LumaDifferences(first)
+      {
+      }
+
+      std::vector<uint64_t> hashes;
+      std::vector<uint8_t> means;
+      std::vector<uint8_t> peaks;
+
+    protected:
+      virtual bool processLuma(const std::vector<uint8_t> &luma)
+      {
+        size_t size = luma.size();
+        uint64_t sum = 0;
+        uint8_t peak = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+          sum += luma[i];
+          peak = std::max(peak, luma[i]);
+        }
+        hashes.push_back(hashBytes(&luma[0], size));
+        means.push_back((uint8_t) ((sum + size / 2) / size));
+        peaks.push_back(peak);
+        return true;
+      }
+    };
+
+    virtual Chunk *createChunk(int first, int)
+    {
+      return new Fingerprints(first);
+    }
+
+    virtual void merge(Chunk &chunk)
+    {
+      Fingerprints &fingerprints = static_cast<Fingerprints &>(chunk);
+      fingerprints.merge(_differences, _lastLuma);
+      _hashes.insert(_hashes.end(), fingerprints.hashes.begin(), fingerprints.hashes.end());
+      _means.insert(_means.end(), fingerprints.means.begin(), fingerprints.means.end());
+      _peaks.insert(_peaks.end(), fingerprints.peaks.begin(), fingerprints.peaks.end());
+    }
+
+  private:
+    std::vector<uint64_t> &_hashes;
+    std::vector<float> &_differences;
+    std::vector<uint8_t> &_means;
+    std::vector<uint8_t> &_peaks;
+    std::vector<uint8_t> _lastLuma;
+  };
+}
+
+bool FrameDefectIndex::build(const std::string &videoName, int threads, const volatile bool *cancel, volatile int *progress)
+{
+  clear();
+  VideoInfo info;
+  if (!probeVideo(videoName.c_str(), info) || info.width <= 0 || info.height <= 0)
+  {
+    LOG_ERROR("Cannot read '" << videoName << "'");
+    return false;
+  }
+
+  VideoPassOptions options;
+  options.threads = threads;
+  options.cancel = cancel;
+  options.progress = progress;
+  options.region.x = 0;
+  options.region.y = 0;
+  options.region.width = info.width;
+  options.region.height = info.height;
+  options.region.outputWidth = std::min((int) LumaWidth, info.width);
+  options.region.outputHeight = std::min((int) LumaHeight, info.height);
+  if (info.totalFrames > 0)
+  {
+    _hashes.reserve(info.totalFrames);
+    _differences.reserve(info.totalFrames);
+    _means.reserve(info.totalFrames);
+    _peaks.reserve(info.totalFrames);
+  }
+
+  FingerprintPass pass(_hashes, _differences, _means, _peaks);
+  if (!runVideoPass(videoName, pass, options))
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+std::string FrameDefectIndex::getCacheName(const std::string &videoName)
+{
+  return videoName + ".defects";
+}
+
+void FrameDefectIndex::clear()
+{
+  std::vector<uint64_t>().swap(_hashes);
+  std::vector<float>().swap(_differences);
+  std::vector<uint8_t>().swap(_means);
+  std::vector<uint8_t>().swap(_peaks);
+}
+
+void FrameDefectIndex::swap(FrameDefectIndex &other)
+{
+  _hashes.swap(other._hashes);
+  _differences.swap(other._differences);
+  _means.swap(other._means);
+  _peaks.swap(other._peaks);
+}
+
+bool FrameDefectIndex::load(const std::string &cacheName, const std::string &videoName)
+{
+  clear();
+  uint32_t recordSize;
+  std::vector<uint8_t> data;
+  if (!loadVideoCache(cacheName, videoName, Magic, Version, recordSize, data) || recordSize != RecordSize)
+    return false;
+  // numbers are little endian, the difference is an IEEE float
+  size_t frames = data.size() / RecordSize;
+  _hashes.resize(frames);
+  _differences.resize(frames);
+  _means.resize(frames);
+  _peaks.resize(frames);
+  for (size_t i = 0; i < frames; i++)
+  {
+    const uint8_t *record = &data[i * RecordSize];
+    uint32_t bits = getLE32(record + 8);
+    memcpy(&_differences[i], &bits, 4);
+    _hashes[i] = getLE64(record);
+    _means[i] = record[12];
+    _peaks[i] = record[13];
+  }
+  return true;
+}
+
+bool FrameDefectIndex::save(const std::string &cacheName, const std::string &videoName) const
+{
+  std::vector<uint8_t> data(_hashes.size() * RecordSize);
+  for (size_t i = 0; i < _hashes.size(); i++)
+  {
+    uint8_t *record = &data[i * RecordSize];
+    uint32_t bits;
+    memcpy(&bits, &_differences[i], 4);
+    putLE64(record, _hashes[i]);
+    putLE32(record + 8, bits);
+    record[12] = _means[i];
+    record[13] = _peaks[i];
+  }
+  return saveVideoCache(cacheName, videoName, Magic, Version, RecordSize, data);
+}
+
+FrameDefectIndex::FrameKind FrameDefectIndex::classify(int frame, const FrameDefectOptions &options) const
+{
+  if (_peaks[frame] <= options.blackLevel)
+    return frameBlack;
+  if (frame == 0)
+    return frameNormal;
+  if (_hashes[frame] == _hashes[frame - 1])
+    return frameRepeat;
+  if (_differences[frame] < options.nearDifference)
+    return frameNearRepeat;
+  return frameNormal;
+}
+
+void FrameDefectIndex::findDefects(std::vector<FrameDefect> &defects, const FrameDefectOptions &options) const
+{
+  defects.clear();
+  for (int frame = 0; frame < getFrames(); frame++)
+  {
+    FrameKind kind = classify(frame, options);
+    if (kind == frameNormal)
+      continue;
+    FrameDefect::Kind defectKind = kind == frameBlack ? FrameDefect::defectBlack : FrameDefect::defectFrozen;
+    if (defects.empty() || defects.back().end != frame - 1 || defects.back().kind != defectKind)
+    {
+      FrameDefect defect;
+      defect.start = frame;
+      defect.kind = defectKind;
+      defect.exact = 0;
+      defects.push_back(defect);
+    }
+    defects.back().end = frame;
+    if (kind == frameRepeat)
+      defects.back().exact++;
+  }
+}
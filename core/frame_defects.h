@@ -0,0 +1,148 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct FrameDefectOptions
+{
+  FrameDefectOptions()
+  : nearDifference(0.5),
+    blackLevel(24)
+  {
+  }
+
+  double nearDifference;  ///< frames differing from the previous one by less (mean absolute luma difference) repeat it
+  int blackLevel;         ///< frames with no luma brighter than this are black
+};
+
+/** Run of consecutive defective frames
+  */
+struct FrameDefect
+{
+  enum Kind
+  {
+    defectFrozen,       ///< every frame repeats its predecessor, exactly or nearly
+    defectBlack
+  };
+
+  int start;
+  int end;
+  Kind kind;
+  int exact;            ///< frames of a frozen run repeating their predecessor exactly
+};
+
+/** Fingerprints of every frame of a video, made from its luma scaled down to
+  * LumaWidth x LumaHeight: a hash (equal hashes of consecutive frames mean an
+  * exact repeat), the difference from the previous frame (a near repeat, e.g.
+  * a frozen capture re-encoded) and the brightness (black frames)
+  */
+class FrameDefectIndex
+{
+public:
+  enum
+  {
+    LumaWidth = 32,
+    LumaHeight = 24
+  };
+
+  /** Kind of a single frame, see classify()
+    */
+  enum FrameKind
+  {
+    frameNormal,
+    frameRepeat,
+    frameNearRepeat,
+    frameBlack
+  };
+
+  /** @param[in] cancel, progress See VideoPassOptions
+    * @return false Failure or cancel
+    */
+  bool build(const std::string &videoName, int threads = 0, const volatile bool *cancel = 0, volatile int *progress = 0);
+
+  /** @return false No valid cache (see loadVideoCache())
+    */
+  bool load(const std::string &cacheName, const std::string &videoName);
+
+  /** @return false Failure
+    */
+  bool save(const std::string &cacheName, const std::string &videoName) const;
+
+  /** @return name of the cache file kept next to the video
+    */
+  static std::string getCacheName(const std::string &videoName);
+
+  void clear();
+  void swap(FrameDefectIndex &other);
+
+  bool empty() const
+  {
+    return _hashes.empty();
+  }
+
+  int getFrames() const
+  {
+    return (int) _hashes.size();
+  }
+
+  uint64_t getHash(int frame) const
+  {
+    return _hashes[frame];
+  }
+
+  /** @return mean absolute luma difference from the previous frame, 0 for the first frame
+    */
+  float getDifference(int frame) const
+  {
+    return _differences[frame];
+  }
+
+  int getMeanLuma(int frame) const
+  {
+    return _means[frame];
+  }
+
+  int getPeakLuma(int frame) const
+  {
+    return _peaks[frame];
+  }
+
+  /** A black frame is not counted as a repeat, even if it is one
+    */
+  FrameKind classify(int frame, const FrameDefectOptions &options = FrameDefectOptions()) const;
+
+  /** Joins defective frames into runs, in frame order
+    */
+  void findDefects(std::vector<FrameDefect> &defects, const FrameDefectOptions &options = FrameDefectOptions()) const;
+
+private:
+  std::vector<uint64_t> _hashes;
+  std::vector<float> _differences;
+  std::vector<uint8_t> _means;
+  std::vector<uint8_t> _peaks;
+};
@@ -0,0 +1,365 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <videoreader.h>
+
+#include "frame_fingerprints.h"
+#include "frame_pack.h"
+#include "image_kernels.h"
+#include "fileutil.h"
+#include "logger.h"
+
+namespace {
+  const char *Title = "# video_marker frame fingerprints";
+
+  bool entryLess(const FrameFingerprints::Entry &a, const FrameFingerprints::Entry &b)
+  {
+    return a.frame < b.frame;
+  }
+
+  class FingerprintPass: public VideoPass
+  {
+  public:
+    FingerprintPass(std::vector<FrameFingerprints::Entry> &entries)
+    : _entries(entries)
+    {
+    }
+
+    class Fingerprints: public Chunk
+    {
+    public:
+      virtual bool process(int frame, const MinImg &image)
+      {
+        FrameFingerprints::Entry entry;
+        entry.frame = frame;
+        entry.hash = hashImage(image);
+        entries.push_back(entry);
+        return true;
+      }
+
+      std::vector<FrameFingerprints::Entry> entries;
+    };
+
+    virtual Chunk *createChunk(int, int)
+    {
+      return new Fingerprints;
+    }
+
+    virtual void merge(Chunk &chunk)
+    {
+      const std::vector<FrameFingerprints::Entry> &entries = static_cast<Fingerprints &>(chunk).entries;
+      _entries.insert(_entries.end(), entries.begin(), entries.end());
+    }
+
+  private:
+    std::vector<FrameFingerprints::Entry> &_entries;
+  };
+
+  /** Reads a number of a PNM header, skipping whitespace and comments
+    * @return -1 No number
+    */
+  int readHeaderNumber(const uint8_t *&p, const uint8_t *end)
+  {
+    while (p < end && (isspace(*p) || *p == '#'))
+      if (*p == '#')
+        while (p < end && *p != '\n')
+          p++;
+      else
+        p++;
+    if (p == end || !isdigit(*p))
+      return -1;
+    int value = 0;
+    for (; p < end && isdigit(*p) && value < 1000000; p++)
+      value = value * 10 + (*p - '0');
+    return value;
+  }
+
+  /** Fingerprint of a binary PPM (or PGM) image
+    * @return false Not a supported image
+    */
+  bool hashPnm(const uint8_t *data, size_t size, uint64_t &hash)
+  {
+    if (size < 2 || data[0] != 'P' || (data[1] != '6' && data[1] != '5'))
+      return false;
+    const uint8_t *p = data + 2, *end = data + size;
+    int width = readHeaderNumber(p, end);
+    int height = readHeaderNumber(p, end);
+    int maxValue = readHeaderNumber(p, end);
+    if (width <= 0 || height <= 0 || maxValue != 255 || p == end || !isspace(*p))
+      return false;
+    p++;      // a single whitespace ends the header
+    MinImg image;
+    memset(&image, 0, sizeof(image));
+    image.width = width;
+    image.height = height;
+    image.channels = data[1] == '6' ? 3 : 1;
+    image.channelDepth = 1;
+    image.format = FMT_UINT;
+    image.stride = width * image.channels;
+    if ((size_t) (end - p) < (size_t) image.stride * height)
+      return false;
+    image.pScan0 = const_cast<uint8_t *>(p);
+    hash = hashImage(image);
+    return true;
+  }
+
+  /** @return frame number of a dumped file ("<prefix>_<frame>.<extension>")
+    * @return -1 Not a frame file
+    */
+  int getDumpedFrame(const std::string &name)
+  {
+    size_t dot = name.rfind('.');
+    size_t underscore = name.rfind('_', dot);
+    if (dot == std::string::npos || underscore == std::string::npos || dot == underscore + 1)
+      return -1;
+    for (size_t i = underscore + 1; i < dot; i++)
+      if (!isdigit((unsigned char) name[i]))
+        return -1;
+    return atoi(name.c_str() + underscore + 1);
+  }
+
+  bool hashDumpDir(const std::string &directory, std::vector<FrameFingerprints::Entry> &entries)
+  {
+    std::vector<std::string> files, dirs;
+    if (!listDir(directory, files, dirs))
+    {
+      LOG_ERROR("Cannot read directory '" << directory << "'");
+      return false;
+    }
+    for (size_t i = 0; i < files.size(); i++)
+    {
+      const std::string &name = files[i];
+      if (name.size() < 4 || name.compare(name.size() - 4, 4, ".ppm") != 0 || getDumpedFrame(name) < 0)
+        continue;
+      std::string path = directory + "/" + name;
+      MappedFile file;
+      FrameFingerprints::Entry entry;
+      entry.frame = getDumpedFrame(name);
+      if (!file.open(path) || !hashPnm(file.getData(), file.getSize(), entry.hash))
+      {
+        LOG_ERROR("Cannot read frame '" << path << "'");
+        return false;
+      }
+      entries.push_back(entry);
+    }
+    for (size_t i = 0; i < dirs.size(); i++)
+      if (!hashDumpDir(directory + "/" + dirs[i], entries))
+        return false;
+    return true;
+  }
+}
+
+bool FrameFingerprints::build(const std::string &videoName, int threads, VideoPassStatistics *stats)
+{
+  clear();
+  VideoPassOptions options;
+  options.threads = threads;
+  FingerprintPass pass(_entries);
+  if (!runVideoPass(videoName, pass, options, stats))
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+bool FrameFingerprints::buildFromPack(const std::string &packName)
+{
+  clear();
+  MappedFile file;
+  if (!file.open(packName))
+  {
+    LOG_ERROR("Cannot read '" << packName << "'");
+    return false;
+  }
+  // see the layout in frame_pack.h
+  const uint8_t *data = file.getData();
+  size_t size = file.getSize();
+  if (size < FramePackWriter::HeaderSize || memcmp(data, "VMPACK01", 8) != 0)
+  {
+    LOG_ERROR("'" << packName << "' is not a frame pack");
+    return false;
+  }
+  MinImg image;
+  memset(&image, 0, sizeof(image));
+  image.width = (int) getLE32(data + 12);
+  image.height = (int) getLE32(data + 16);
+  image.channels = (int) getLE32(data + 20);
+  image.channelDepth = 1;
+  image.format = FMT_UINT;
+  image.stride = image.width * image.channels;
+  uint32_t frames = getLE32(data + 24);
+  uint64_t tableOffset = getLE64(data + 40);
+  uint64_t dataOffset = getLE64(data + 64);
+  uint64_t frameSize = (uint64_t) image.stride * image.height;
+  if (tableOffset + (uint64_t) frames * FramePackWriter::FrameEntrySize > size
+      || dataOffset + frames * frameSize > size)
+  {
+    LOG_ERROR("Frame pack '" << packName << "' is cut short");
+    return false;
+  }
+  for (uint32_t i = 0; i < frames; i++)
+  {
+    Entry entry;
+    entry.frame = (int) getLE32(data + tableOffset + (uint64_t) i * FramePackWriter::FrameEntrySize);
+    image.pScan0 = const_cast<uint8_t *>(data + dataOffset + i * frameSize);
+    entry.hash = hashImage(image);
+    _entries.push_back(entry);
+  }
+  if (!normalize())
+  {
+    LOG_ERROR("Frame pack '" << packName << "' has different copies of a frame");
+    clear();
+    return false;
+  }
+  return true;
+}
+
+bool FrameFingerprints::buildFromDump(const std::string &directory)
+{
+  clear();
+  if (!hashDumpDir(directory, _entries))
+  {
+    clear();
+    return false;
+  }
+  if (!normalize())
+  {
+    LOG_ERROR("Dump '" << directory << "' has different copies of a frame");
+    clear();
+    return false;
+  }
+  return true;
+}
+
+bool FrameFingerprints::normalize()
+{
+  std::stable_sort(_entries.begin(), _entries.end(), entryLess);
+  size_t kept = 0;
+  for (size_t i = 0; i < _entries.size(); i++)
+  {
+    if (kept > 0 && _entries[kept - 1].frame == _entries[i].frame)
+    {
+      if (_entries[kept - 1].hash != _entries[i].hash)
+        return false;
+      continue;
+    }
+    _entries[kept++] = _entries[i];
+  }
+  _entries.resize(kept);
+  return true;
+}
+
+std::string FrameFingerprints::getFileName(const std::string &sourceName)
+{
+  std::string name = sourceName;
+  while (name.size() > 1 && (name[name.size() - 1] == '/' || name[name.size() - 1] == '\\'))
+    name.erase(name.size() - 1);
+  return name + ".fingerprints";
+}
+
+void FrameFingerprints::clear()
+{
+  std::vector<Entry>().swap(_entries);
+}
+
+bool FrameFingerprints::load(const std::string &fileName)
+{
+  clear();
+  FILE *fp = fopen(fileName.c_str(), "r");
+  if (!fp)
+    return false;
+  char line[1024];
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), fp))
+  {
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+      continue;
+    Entry entry;
+    unsigned long long hash;
+    ok = sscanf(line, "%d %llx", &entry.frame, &hash) == 2;
+    entry.hash = hash;
+    _entries.push_back(entry);
+  }
+  fclose(fp);
+  if (!ok || !normalize())
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+bool FrameFingerprints::save(const std::string &fileName, const std::string &source) const
+{
+  std::string text = std::string(Title) + "\n# source " + source + "\n";
+  text.reserve(text.size() + _entries.size() * 28);
+  char line[64];
+  for (size_t i = 0; i < _entries.size(); i++)
+  {
+    sprintf(line, "%d %016llx\n", _entries[i].frame, (unsigned long long) _entries[i].hash);
+    text += line;
+  }
+  std::string tempName = fileName + ".new";
+  if (!writeFile(tempName, text.data(), text.size()))
+  {
+    remove(tempName.c_str());
+    return false;
+  }
+  return replaceFile(tempName, fileName);
+}
+
+void compareFingerprints(const FrameFingerprints &first, const FrameFingerprints &second, FingerprintComparison &result)
+{
+  result.common = result.onlyFirst = result.onlySecond = 0;
+  result.differing.clear();
+  int i = 0, j = 0;
+  while (i < first.size() || j < second.size())
+  {
+    if (j == second.size() || (i < first.size() && first[i].frame < second[j].frame))
+    {
+      result.onlyFirst++;
+      i++;
+    }
+    else if (i == first.size() || second[j].frame < first[i].frame)
+    {
+      result.onlySecond++;
+      j++;
+    }
+    else
+    {
+      result.common++;
+      if (first[i].hash != second[j].hash)
+        result.differing.push_back(first[i].frame);
+      i++;
+      j++;
+    }
+  }
+}
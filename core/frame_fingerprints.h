@@ -0,0 +1,119 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "video_pass.h"
+
+/** Fingerprints (hashImage()) of decoded frames by frame number, kept as a
+  * text sidecar so that dumps, transcodes and decoder builds can be checked
+  * for identical frames:
+  *
+  *   # video_marker frame fingerprints
+  *   # source <name of the video, frame pack or dump directory>
+  *   <frame number> <fingerprint, 16 hex digits>
+  *
+  * Frames of a video are all listed; a dump lists the frames it has
+  */
+class FrameFingerprints
+{
+public:
+  struct Entry
+  {
+    int frame;
+    uint64_t hash;
+  };
+
+  /** Fingerprints every frame of a video, decoded by a key frame parallel pass
+    * @param[out] stats If given, gets the statistics of the pass
+    * @return false Failure
+    */
+  bool build(const std::string &videoName, int threads = 0, VideoPassStatistics *stats = 0);
+
+  /** Fingerprints the frames of a frame pack (.vmp). A frame stored by several
+    * intervals is taken once; differing copies make the build fail
+    * @return false Failure (error is logged)
+    */
+  bool buildFromPack(const std::string &packName);
+
+  /** Fingerprints the PPM frames of a dump directory (subdirectories of
+    * intervals included); frame numbers are taken from the file names
+    * @return false Failure (error is logged)
+    */
+  bool buildFromDump(const std::string &directory);
+
+  /** @return false Failure
+    */
+  bool load(const std::string &fileName);
+
+  /** @param[in] source Name of what was fingerprinted, recorded in the file
+    * @return false Failure
+    */
+  bool save(const std::string &fileName, const std::string &source) const;
+
+  /** @return name of the sidecar kept next to a video, pack or dump directory
+    */
+  static std::string getFileName(const std::string &sourceName);
+
+  void clear();
+
+  bool empty() const
+  {
+    return _entries.empty();
+  }
+
+  int size() const
+  {
+    return (int) _entries.size();
+  }
+
+  /** Entries are sorted by frame number
+    */
+  const Entry &operator[] (int i) const
+  {
+    return _entries[i];
+  }
+
+private:
+  /** Sorts the entries and drops repeated frames
+    * @return false A frame has different fingerprints
+    */
+  bool normalize();
+
+  std::vector<Entry> _entries;
+};
+
+struct FingerprintComparison
+{
+  int common;                     ///< frames present in both
+  int onlyFirst;
+  int onlySecond;
+  std::vector<int> differing;     ///< common frames with different fingerprints
+};
+
+void compareFingerprints(const FrameFingerprints &first, const FrameFingerprints &second, FingerprintComparison &result);
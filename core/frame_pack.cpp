@@ -0,0 +1,217 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+
+#include "frame_pack.h"
+#include "fileutil.h"
+#include "logger.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+namespace {
+  bool seek(FILE *file, uint64_t offset)
+  {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64) offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t) offset, SEEK_SET) == 0;
+#endif
+  }
+
+  // appends the string to the pool and stores its offset and size at the given place
+  void putString(std::vector<uint8_t> &buffer, size_t offset, std::string &pool, const std::string &value)
+  {
+    putLE32(&buffer[offset], (uint32_t) pool.size());
+    putLE32(&buffer[offset + 4], (uint32_t) value.size());
+    pool += value;
+  }
+}
+
+FramePackWriter::FramePackWriter()
+: _file(0),
+  _nextSlice(0),
+  _width(0),
+  _height(0),
+  _channels(0),
+  _frameCount(0),
+  _framesStored(0),
+  _dataOffset(0),
+  _failed(false)
+{
+}
+
+FramePackWriter::~FramePackWriter()
+{
+  if (_file)
+    close();
+}
+
+bool FramePackWriter::create(const std::string &fileName, const Markup &markup,
+                             const std::vector<DumpPlan::Item> &items, int width, int height, int channels)
+{
+  if (_file)
+    close();
+  _fileName = fileName;
+  _width = width;
+  _height = height;
+  _channels = channels;
+  _slices.clear();
+  _active.clear();
+  _nextSlice = 0;
+  _frameCount = 0;
+  _framesStored = 0;
+  _failed = false;
+  for (size_t i = 0; i < items.size(); i++)
+  {
+    Slice slice;
+    slice.item = items[i];
+    slice.firstFrame = (int) _frameCount;
+    _slices.push_back(slice);
+    _frameCount += items[i].end - items[i].start + 1;
+  }
+
+  // tables are small, they are built in memory and written at once
+  uint64_t frameTableOffset = HeaderSize;
+  uint64_t intervalTableOffset = frameTableOffset + (uint64_t) _frameCount * FrameEntrySize;
+  uint64_t stringPoolOffset = intervalTableOffset + (uint64_t) _slices.size() * IntervalEntrySize;
+  std::vector<uint8_t> tables((size_t) stringPoolOffset, 0);
+  std::string pool;
+
+  for (size_t i = 0; i < _slices.size(); i++)
+  {
+    const DumpPlan::Item &item = _slices[i].item;
+    const Interval &interval = markup[item.interval];
+    size_t entry = (size_t) intervalTableOffset + i * IntervalEntrySize;
+    putLE32(&tables[entry], item.interval);
+    putLE32(&tables[entry + 4], interval.start);
+    putLE32(&tables[entry + 8], interval.end);
+    putLE32(&tables[entry + 12], interval.type);
+    putLE32(&tables[entry + 16], interval.y_border);
+    putLE32(&tables[entry + 20], _slices[i].firstFrame);
+    putLE32(&tables[entry + 24], item.end - item.start + 1);
+    std::string labels;
+    for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+      labels += (labels.empty() ? "" : "\n") + *it;
+    putString(tables, entry + 28, pool, labels);
+    putString(tables, entry + 36, pool, interval.comment);
+
+    for (int frame = item.start; frame <= item.end; frame++)
+    {
+      size_t frameEntry = (size_t) frameTableOffset + (size_t) (_slices[i].firstFrame + frame - item.start) * FrameEntrySize;
+      putLE32(&tables[frameEntry], frame);
+      putLE32(&tables[frameEntry + 4], (uint32_t) i);
+      putLE32(&tables[frameEntry + 8], interval.contains(frame) ? 1 : 0);
+    }
+  }
+
+  _dataOffset = stringPoolOffset + pool.size();
+  _dataOffset = (_dataOffset + DataAlignment - 1) / DataAlignment * DataAlignment;
+
+  memcpy(&tables[0], "VMPACK01", 8);
+  putLE32(&tables[8], 1);
+  putLE32(&tables[12], width);
+  putLE32(&tables[16], height);
+  putLE32(&tables[20], channels);
+  putLE32(&tables[24], (uint32_t) _frameCount);
+  putLE32(&tables[28], (uint32_t) _slices.size());
+  putLE32(&tables[32], (uint32_t) pool.size());
+  putLE64(&tables[40], frameTableOffset);
+  putLE64(&tables[48], intervalTableOffset);
+  putLE64(&tables[56], stringPoolOffset);
+  putLE64(&tables[64], _dataOffset);
+  tables.insert(tables.end(), pool.begin(), pool.end());
+  tables.resize((size_t) _dataOffset, 0);
+
+  _file = fopen(fileName.c_str(), "wb");
+  if (!_file || fwrite(&tables[0], tables.size(), 1, _file) != 1)
+  {
+    LOG_ERROR("Cannot write '" << fileName << "'");
+    _failed = true;
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool FramePackWriter::putFrame(int frame, const MinImg &image, int interval)
+{
+  if (!_file || _failed)
+    return false;
+  if (image.width != _width || image.height != _height || image.channels != _channels || image.channelDepth != 1)
+  {
+    LOG_ERROR("Frame " << frame << " does not match the geometry of '" << _fileName << "'");
+    _failed = true;
+    return false;
+  }
+
+  while (_nextSlice < _slices.size() && _slices[_nextSlice].item.start <= frame)
+    _active.push_back(&_slices[_nextSlice++]);
+  for (size_t i = 0; i < _active.size(); )
+    if (_active[i]->item.end < frame)
+      _active.erase(_active.begin() + i);
+    else
+      i++;
+
+  size_t rowSize = (size_t) _width * _channels;
+  uint64_t frameSize = (uint64_t) rowSize * _height;
+  for (size_t i = 0; i < _active.size(); i++)
+  {
+    if (interval >= 0 && _active[i]->item.interval != interval)
+      continue;
+    uint64_t index = _active[i]->firstFrame + (frame - _active[i]->item.start);
+    if (!seek(_file, _dataOffset + index * frameSize))
+      _failed = true;
+    // rows are written one by one since the frame may have a stride larger than its width
+    for (int y = 0; y < _height && !_failed; y++)
+      if (fwrite(image.pScan0 + y * image.stride, rowSize, 1, _file) != 1)
+        _failed = true;
+    if (_failed)
+    {
+      LOG_ERROR("Cannot write frame " << frame << " to '" << _fileName << "'");
+      return false;
+    }
+    _framesStored++;
+  }
+  return true;
+}
+
+bool FramePackWriter::close()
+{
+  if (_file && fclose(_file) != 0)
+    _failed = true;
+  _file = 0;
+  if (!_failed && _framesStored != _frameCount)
+  {
+    LOG_ERROR("Only " << _framesStored << " of " << _frameCount << " frame(s) were stored to '" << _fileName << "'");
+    _failed = true;
+  }
+  return !_failed;
+}
+
+uint64_t FramePackWriter::getFileSize() const
+{
+  return _dataOffset + (uint64_t) _frameCount * _width * _height * _channels;
+}
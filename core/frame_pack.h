@@ -0,0 +1,141 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <minimg.h>
+
+#include "dump_plan.h"
+#include "video_markup.h"
+
+/** Frame pack (.vmp) is a single file with dumped frames and their markup,
+  * meant to be memory mapped by training pipelines: frames are stored
+  * uncompressed back to back, so a reader can slice them without decoding.
+  *
+  * All numbers are little endian. Layout:
+  *
+  *   offset  size  header
+  *        0     8  magic "VMPACK01"
+  *        8     4  version (1)
+  *       12     4  frame width
+  *       16     4  frame height
+  *       20     4  channels (3 - RGB)
+  *       24     4  number of frames
+  *       28     4  number of intervals
+  *       32     4  size of the string pool
+  *       36     4  reserved (0)
+  *       40     8  offset of the frame table
+  *       48     8  offset of the interval table
+  *       56     8  offset of the string pool
+  *       64     8  offset of frame data (multiple of 4096)
+  *       72    56  reserved (0)
+  *
+  *   frame table, 16 bytes per frame:
+  *     int32 frame number in the video
+  *     int32 index of the interval in the interval table
+  *     int32 flags: 1 - the frame is inside the interval (not in the margin)
+  *     int32 reserved
+  *
+  *   interval table, 48 bytes per interval:
+  *     int32 interval id in the markup
+  *     int32 start, end, type, y_border (as in the markup)
+  *     int32 first frame of the interval in the frame table
+  *     int32 number of frames of the interval (margins included)
+  *     uint32 offset and size of the labels in the string pool (separated by '\n')
+  *     uint32 offset and size of the comment in the string pool
+  *     int32 reserved
+  *
+  *   frame data: frames of height x width x channels bytes (rows without padding)
+  *
+  * Frames of every interval are contiguous, a frame shared by the margins of
+  * several intervals is stored once per interval. E.g. with numpy:
+  *   numpy.memmap(name, numpy.uint8, 'r', dataOffset, (frames, height, width, channels))
+  */
+class FramePackWriter
+{
+public:
+  enum
+  {
+    HeaderSize = 128,
+    FrameEntrySize = 16,
+    IntervalEntrySize = 48,
+    DataAlignment = 4096
+  };
+
+  FramePackWriter();
+
+  /** Closes the file if it is still open
+    */
+  ~FramePackWriter();
+
+  /** Creates the file and writes everything except frame data
+    * @param[in] items Intervals of a dump plan with their margins, sorted by start frame
+    * @return false Failure (error is logged)
+    */
+  bool create(const std::string &fileName, const video_markup::Markup &markup,
+              const std::vector<DumpPlan::Item> &items, int width, int height, int channels);
+
+  /** Stores a frame into all intervals containing it.
+    * Frames must be given in increasing order
+    * @param[in] interval If not negative the frame is stored only into the slices of this interval
+    *                     (used when intervals get differently cropped images of the same frame)
+    * @return false Failure (error is logged)
+    */
+  bool putFrame(int frame, const MinImg &image, int interval = -1);
+
+  /** Closes the file
+    * @return false Not all frames were stored or a write error occurred
+    */
+  bool close();
+
+  /** @return number of bytes in the file
+    */
+  uint64_t getFileSize() const;
+
+private:
+  FramePackWriter(const FramePackWriter &);
+  FramePackWriter &operator= (const FramePackWriter &);
+
+  struct Slice
+  {
+    DumpPlan::Item item;
+    int firstFrame;     ///< index of the item's first frame in the pack
+  };
+
+  FILE *_file;
+  std::string _fileName;
+  std::vector<Slice> _slices;
+  size_t _nextSlice;
+  std::vector<const Slice *> _active;
+  int _width;
+  int _height;
+  int _channels;
+  long _frameCount;
+  long _framesStored;
+  uint64_t _dataOffset;
+  bool _failed;
+};
@@ -0,0 +1,230 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#include "frame_writer.h"
+#include "fileutil.h"
+#ifdef VIDEO_MARKER_HAVE_JPEG
+# include "jpeg_frame_writer.h"
+#endif
+
+namespace {
+  bool isByteImage(const MinImg &frame)
+  {
+    return frame.channelDepth == 1 && frame.format == FMT_UINT && frame.width > 0 && frame.height > 0;
+  }
+
+  // sets data to the header followed by rows of rowSize bytes; returns the first row
+  uint8_t *startFile(std::vector<uint8_t> &data, const char *header, int headerSize, size_t rowSize, int rows)
+  {
+    data.resize(headerSize + rowSize * rows);
+    memcpy(&data[0], header, headerSize);
+    return &data[headerSize];
+  }
+
+  void putBigEndian32(uint8_t *p, uint32_t value)
+  {
+    p[0] = (uint8_t) (value >> 24);
+    p[1] = (uint8_t) (value >> 16);
+    p[2] = (uint8_t) (value >> 8);
+    p[3] = (uint8_t) value;
+  }
+}
+
+bool FrameWriter::write(const MinImg &frame, const char *fileName)
+{
+  std::vector<uint8_t> data;
+  if (!encode(frame, data))
+    return false;
+  return writeFile(fileName, data.empty() ? 0 : &data[0], data.size());
+}
+
+bool PpmFrameWriter::encode(const MinImg &frame, std::vector<uint8_t> &data)
+{
+  if (!isByteImage(frame) || (frame.channels != 3 && frame.channels != 1))
+    return false;
+  char header[64];
+  int headerSize = sprintf(header, "P%d\n%d %d\n255\n", frame.channels == 3 ? 6 : 5, frame.width, frame.height);
+  int rowSize = frame.width * frame.channels;
+  uint8_t *dst = startFile(data, header, headerSize, rowSize, frame.height);
+  // rows are copied one by one since the frame may have a stride larger than its width
+  for (int i = 0; i < frame.height; i++, dst += rowSize)
+    memcpy(dst, frame.pScan0 + i * frame.stride, rowSize);
+  return true;
+}
+
+bool PgmFrameWriter::encode(const MinImg &frame, std::vector<uint8_t> &data)
+{
+  if (!isByteImage(frame) || (frame.channels != 3 && frame.channels != 1))
+    return false;
+  char header[64];
+  int headerSize = sprintf(header, "P5\n%d %d\n255\n", frame.width, frame.height);
+  uint8_t *dst = startFile(data, header, headerSize, frame.width, frame.height);
+  for (int i = 0; i < frame.height; i++)
+  {
+    const uint8_t *src = frame.pScan0 + i * frame.stride;
+    if (frame.channels == 1)
+      memcpy(dst, src, frame.width);
+    else
+      // Y = 0.299 R + 0.587 G + 0.114 B in 16 bit fixed point
+      for (int j = 0; j < frame.width; j++, src += 3)
+        dst[j] = (uint8_t) ((19595 * src[0] + 38470 * src[1] + 7471 * src[2] + 32768) >> 16);
+    dst += frame.width;
+  }
+  return true;
+}
+
+namespace {
+  enum
+  {
+    QoiOpIndex = 0x00,
+    QoiOpDiff  = 0x40,
+    QoiOpLuma  = 0x80,
+    QoiOpRun   = 0xc0,
+    QoiOpRgb   = 0xfe,
+    QoiMaxRun  = 62
+  };
+
+  // pixels are packed as r | g << 8 | b << 16 | 255 << 24, so that comparisons take one
+  // instruction; the channel count is a template argument to keep the loop free of branches on it
+  template <int Channels>
+  uint8_t *encodeQoiPixels(const MinImg &frame, uint8_t *out)
+  {
+    // alpha of the pixels is always 255, but the decoder starts with a zeroed
+    // index (alpha 0 included), so alpha is kept in the index for comparison
+    uint32_t index[64];
+    memset(index, 0, sizeof(index));
+    uint32_t prev = 0xff000000;
+    int run = 0;
+    for (int i = 0; i < frame.height; i++)
+    {
+      const uint8_t *src = frame.pScan0 + i * frame.stride;
+      const uint8_t *end = src + frame.width * Channels;
+      for (; src < end; src += Channels)
+      {
+        uint32_t r = src[0], g = src[Channels == 3 ? 1 : 0], b = src[Channels == 3 ? 2 : 0];
+        uint32_t pixel = r | g << 8 | b << 16 | 0xff000000;
+        if (pixel == prev)
+        {
+          if (++run == QoiMaxRun)
+          {
+            *out++ = (uint8_t) (QoiOpRun | (run - 1));
+            run = 0;
+          }
+          continue;
+        }
+        if (run > 0)
+        {
+          *out++ = (uint8_t) (QoiOpRun | (run - 1));
+          run = 0;
+        }
+
+        uint32_t hash = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+        if (index[hash] == pixel)
+          *out++ = (uint8_t) (QoiOpIndex | hash);
+        else
+        {
+          index[hash] = pixel;
+          signed char dr = (signed char) (r - (prev & 0xff));
+          signed char dg = (signed char) (g - (prev >> 8 & 0xff));
+          signed char db = (signed char) (b - (prev >> 16 & 0xff));
+          signed char dgr = (signed char) (dr - dg);
+          signed char dgb = (signed char) (db - dg);
+          if ((unsigned) (dr + 2) < 4 && (unsigned) (dg + 2) < 4 && (unsigned) (db + 2) < 4)
+            *out++ = (uint8_t) (QoiOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+          else if ((unsigned) (dgr + 8) < 16 && (unsigned) (dg + 32) < 64 && (unsigned) (dgb + 8) < 16)
+          {
+            out[0] = (uint8_t) (QoiOpLuma | (dg + 32));
+            out[1] = (uint8_t) ((dgr + 8) << 4 | (dgb + 8));
+            out += 2;
+          }
+          else
+          {
+            out[0] = QoiOpRgb;
+            out[1] = (uint8_t) r;
+            out[2] = (uint8_t) g;
+            out[3] = (uint8_t) b;
+            out += 4;
+          }
+        }
+        prev = pixel;
+      }
+    }
+    if (run > 0)
+      *out++ = (uint8_t) (QoiOpRun | (run - 1));
+    return out;
+  }
+}
+
+bool QoiFrameWriter::encode(const MinImg &frame, std::vector<uint8_t> &data)
+{
+  if (!isByteImage(frame) || (frame.channels != 3 && frame.channels != 1))
+    return false;
+
+  static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  // the worst case is OpRgb for every pixel
+  size_t maxSize = 14 + (size_t) frame.width * frame.height * 4 + sizeof(padding);
+  if (data.size() < maxSize)
+    data.resize(maxSize);
+  uint8_t *out = &data[0];
+  memcpy(out, "qoif", 4);
+  putBigEndian32(out + 4, frame.width);
+  putBigEndian32(out + 8, frame.height);
+  out[12] = 3;      // channels, alpha is never stored
+  out[13] = 0;      // sRGB
+  out += 14;
+  out = frame.channels == 3 ? encodeQoiPixels<3>(frame, out) : encodeQoiPixels<1>(frame, out);
+  memcpy(out, padding, sizeof(padding));
+  out += sizeof(padding);
+  data.resize(out - &data[0]);
+  return true;
+}
+
+FrameWriter *createFrameWriter(const std::string &format, int quality)
+{
+  if (format == "ppm")
+    return new PpmFrameWriter;
+  if (format == "pgm")
+    return new PgmFrameWriter;
+  if (format == "qoi")
+    return new QoiFrameWriter;
+#ifdef VIDEO_MARKER_HAVE_JPEG
+  if (format == "jpg" || format == "jpeg")
+    return new JpegFrameWriter(quality);
+#else
+  (void) quality;
+#endif
+  return 0;
+}
+
+const char *getFrameWriterFormats()
+{
+#ifdef VIDEO_MARKER_HAVE_JPEG
+  return "ppm pgm qoi jpg";
+#else
+  return "ppm pgm qoi";
+#endif
+}
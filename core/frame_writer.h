@@ -0,0 +1,118 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <minimg.h>
+
+/** Saves frames to image files. Used for dumping intervals
+  */
+class FrameWriter
+{
+public:
+  virtual ~FrameWriter()
+  {
+  }
+
+  /** Encode the frame into the contents of an image file
+    * @param[out] data Encoded file contents (previous contents are replaced,
+    *                  the capacity is reused)
+    * @return true Success
+    * @return false Failure
+    */
+  virtual bool encode(const MinImg &frame, std::vector<uint8_t> &data) = 0;
+
+  /** Save the frame to the given file
+    * @return true Success
+    * @return false Failure
+    */
+  virtual bool write(const MinImg &frame, const char *fileName);
+
+  /** @return extension (without the dot) of the files produced by the writer
+    */
+  virtual const char *getExtension() const = 0;
+
+  /** @return true encode() may be called from several threads at once
+    */
+  virtual bool isThreadSafe() const
+  {
+    return true;
+  }
+};
+
+/** Writes frames as binary PNM files without any conversion: 24 bit RGB
+  * frames become PPM, single channel frames become PGM. Does not depend on
+  * any image library, so it is used by default in the command line tool
+  */
+class PpmFrameWriter: public FrameWriter
+{
+public:
+  virtual bool encode(const MinImg &frame, std::vector<uint8_t> &data);
+  virtual const char *getExtension() const
+  {
+    return "ppm";
+  }
+};
+
+/** Writes frames as 8 bit grayscale binary PGM files. Color frames are
+  * converted to luma (ITU-R BT.601 weights)
+  */
+class PgmFrameWriter: public FrameWriter
+{
+public:
+  virtual bool encode(const MinImg &frame, std::vector<uint8_t> &data);
+  virtual const char *getExtension() const
+  {
+    return "pgm";
+  }
+};
+
+/** Writes frames in the lossless QOI format (http://qoiformat.org).
+  * Files are typically 2-4 times smaller than PPM, but this is the slowest
+  * writer: every pixel is encoded on its own, and on noisy camera footage
+  * encoding is some 30 times slower than PPM and about twice as slow as
+  * JPEG (see bench-writers)
+  */
+class QoiFrameWriter: public FrameWriter
+{
+public:
+  virtual bool encode(const MinImg &frame, std::vector<uint8_t> &data);
+  virtual const char *getExtension() const
+  {
+    return "qoi";
+  }
+};
+
+/** Creates a writer for the given format
+  * @param[in] format File extension: ppm, pgm, qoi or jpg (if built with libjpeg)
+  * @param[in] quality Quality of lossy formats, 1..100
+  * @return NULL Unknown format
+  */
+FrameWriter *createFrameWriter(const std::string &format, int quality = 90);
+
+/** @return space separated list of formats supported by createFrameWriter
+  */
+const char *getFrameWriterFormats();
@@ -0,0 +1,202 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <cstring>
+
+#include "image_kernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define VIDEO_MARKER_SSE2
+# include <emmintrin.h>
+#endif
+
+uint64_t sumAbsDiff(const uint8_t *a, const uint8_t *b, size_t size)
+{
+  uint64_t sum = 0;
+  size_t i = 0;
+#ifdef VIDEO_MARKER_SSE2
+  // psadbw gives two 16 bit sums per 16 bytes, they are gathered in 64 bit lanes
+  __m128i total = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+    total = _mm_add_epi64(total, _mm_sad_epu8(x, y));
+  }
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *) lanes, total);
+  sum = lanes[0] + lanes[1];
+#endif
+  for (; i < size; i++)
+    sum += (uint64_t) abs((int) a[i] - (int) b[i]);
+  return sum;
+}
+
+uint64_t sumBytes(const uint8_t *data, size_t size)
+{
+  uint64_t sum = 0;
+  size_t i = 0;
+#ifdef VIDEO_MARKER_SSE2
+  // psadbw against zero sums 8 bytes into each 64 bit lane
+  __m128i total = _mm_setzero_si128();
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16)
+    total = _mm_add_epi64(total, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (data + i)), zero));
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *) lanes, total);
+  sum = lanes[0] + lanes[1];
+#endif
+  for (; i < size; i++)
+    sum += data[i];
+  return sum;
+}
+
+namespace {
+  // lane keys of the blocks (a block uses the pair of its number modulo 8) and the scramble key
+  const uint64_t BlockKeys[18] =
+  {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+    0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+    0xcb00c391bb52283cULL, 0xa32e531b8b65d088ULL, 0x4ef90da297486471ULL, 0xd8acdea946ef1938ULL,
+    0x3f349ce33f76faa8ULL, 0x1d4f0bc7c7bbdcf9ULL, 0x3159b4cd4be0518aULL, 0x647378d9c97e9fc8ULL,
+    0xc3ebd33483acc5eaULL, 0xeb6313faffa081c5ULL
+  };
+
+  const uint32_t ScramblePrime = 0x9e3779b1U;
+
+  enum
+  {
+    BlockSize = 16,
+    BlocksPerRound = 8    ///< the lanes are scrambled after that many blocks
+  };
+
+  uint64_t read64(const uint8_t *p)
+  {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+      value = (value << 8) | p[i];
+    return value;
+  }
+
+  void accumulateBlock(uint64_t acc[2], const uint8_t *p, int key)
+  {
+    for (int lane = 0; lane < 2; lane++)
+    {
+      uint64_t value = read64(p + 8 * lane);
+      uint64_t keyed = value ^ BlockKeys[2 * key + lane];
+      acc[lane] += (keyed & 0xffffffffU) * (keyed >> 32);
+      acc[lane ^ 1] += value;
+    }
+  }
+
+  void scramble(uint64_t acc[2])
+  {
+    for (int lane = 0; lane < 2; lane++)
+    {
+      acc[lane] ^= acc[lane] >> 47;
+      acc[lane] ^= BlockKeys[16 + lane];
+      acc[lane] *= ScramblePrime;
+    }
+  }
+
+  uint64_t avalanche(uint64_t h)
+  {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+}
+
+uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed)
+{
+  uint64_t acc[2] = {seed ^ 0x9e3779b185ebca87ULL, ~seed ^ 0xc2b2ae3d27d4eb4fULL};
+  size_t blocks = size / BlockSize;
+  size_t block = 0;
+#ifdef VIDEO_MARKER_SSE2
+  // the same arithmetic on both lanes at once; pmuludq multiplies the low
+  // halves of the lanes by the high halves brought down by the shuffle
+  __m128i total = _mm_loadu_si128((const __m128i *) acc);
+  const __m128i prime = _mm_set1_epi32((int) ScramblePrime);
+  const __m128i scrambleKey = _mm_loadu_si128((const __m128i *) (BlockKeys + 16));
+  for (; block < blocks; block++)
+  {
+    __m128i value = _mm_loadu_si128((const __m128i *) (data + block * BlockSize));
+    __m128i keyed = _mm_xor_si128(value, _mm_loadu_si128((const __m128i *) (BlockKeys + 2 * (block % BlocksPerRound))));
+    __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+    total = _mm_add_epi64(total, _mm_add_epi64(product, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2))));
+    if (block % BlocksPerRound == BlocksPerRound - 1)
+    {
+      total = _mm_xor_si128(total, _mm_srli_epi64(total, 47));
+      total = _mm_xor_si128(total, scrambleKey);
+      __m128i low = _mm_mul_epu32(total, prime);
+      __m128i high = _mm_mul_epu32(_mm_srli_epi64(total, 32), prime);
+      total = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+    }
+  }
+  _mm_storeu_si128((__m128i *) acc, total);
+#endif
+  for (; block < blocks; block++)
+  {
+    accumulateBlock(acc, data + block * BlockSize, (int) (block % BlocksPerRound));
+    if (block % BlocksPerRound == BlocksPerRound - 1)
+      scramble(acc);
+  }
+
+  // the tail is padded with zeros, the size tells it from real zeros
+  size_t tail = size - blocks * BlockSize;
+  if (tail)
+  {
+    uint8_t last[BlockSize] = {0};
+    memcpy(last, data + blocks * BlockSize, tail);
+    accumulateBlock(acc, last, (int) (blocks % BlocksPerRound));
+  }
+  return avalanche(acc[0] ^ (acc[1] * 0x9e3779b97f4a7c15ULL) ^ (uint64_t) size);
+}
+
+uint64_t hashImage(const MinImg &image)
+{
+  uint8_t geometry[16];
+  int32_t values[4] = {image.width, image.height, image.channels, image.channelDepth};
+  for (int i = 0; i < 16; i++)
+    geometry[i] = (uint8_t) (values[i / 4] >> (8 * (i % 4)));
+  uint64_t hash = hashBytes(geometry, sizeof(geometry));
+  size_t rowSize = (size_t) image.width * image.channels * image.channelDepth;
+  for (int y = 0; y < image.height; y++)
+    hash = hashBytes(image.pScan0 + (size_t) y * image.stride, rowSize, hash);
+  return hash;
+}
+
+void rgbToLuma(const MinImg &image, uint8_t *luma)
+{
+  for (int y = 0; y < image.height; y++)
+  {
+    const uint8_t *pixel = image.pScan0 + (size_t) y * image.stride;
+    for (int x = 0; x < image.width; x++, pixel += 3)
+      *luma++ = (uint8_t) ((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+  }
+}
@@ -0,0 +1,61 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <minimg.h>
+
+/** Small per-pixel kernels shared by the whole video passes. They use SSE2
+  * where the compiler targets it (always on x86-64) and plain loops elsewhere;
+  * both give the same results
+  */
+
+/** @return sum of absolute differences of two byte arrays
+  */
+uint64_t sumAbsDiff(const uint8_t *a, const uint8_t *b, size_t size);
+
+/** @return sum of the bytes of an array
+  */
+uint64_t sumBytes(const uint8_t *data, size_t size);
+
+/** Fast 64-bit hash of a byte array for frame fingerprints: 16 byte blocks
+  * are folded into two multiply-accumulate lanes (the scheme of XXH3) and
+  * mixed at the end. Not cryptographic, but any change of the data changes
+  * the result with overwhelming probability
+  */
+uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed = 0);
+
+/** Fingerprint of an image: hashBytes() of its geometry and of its rows one
+  * after another. The row padding is skipped, so a frame gives the same
+  * fingerprint whatever its stride (decoded, dumped or packed)
+  */
+uint64_t hashImage(const MinImg &image);
+
+/** Converts a 24 bit RGB image to 8 bit luma (BT.601, integer arithmetic).
+  * The result is packed: width bytes per row, no padding
+  */
+void rgbToLuma(const MinImg &image, uint8_t *luma);
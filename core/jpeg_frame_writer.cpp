@@ -0,0 +1,126 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <csetjmp>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+#include "jpeg_frame_writer.h"
+#include "logger.h"
+
+namespace {
+  // libjpeg calls exit() on errors by default, here we jump back to encode()
+  struct ErrorManager
+  {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+  };
+
+  void errorExit(j_common_ptr cinfo)
+  {
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    LOG_ERROR("libjpeg: " << message);
+    longjmp(((ErrorManager *) cinfo->err)->jump, 1);
+  }
+
+  // destination manager which appends to a std::vector, the vector capacity is reused
+  struct VectorDestination
+  {
+    jpeg_destination_mgr pub;
+    std::vector<uint8_t> *data;
+  };
+
+  void initDestination(j_compress_ptr cinfo)
+  {
+    VectorDestination *dest = (VectorDestination *) cinfo->dest;
+    std::vector<uint8_t> &data = *dest->data;
+    data.resize(data.capacity() < 65536 ? 65536 : data.capacity());
+    dest->pub.next_output_byte = &data[0];
+    dest->pub.free_in_buffer = data.size();
+  }
+
+  boolean emptyOutputBuffer(j_compress_ptr cinfo)
+  {
+    VectorDestination *dest = (VectorDestination *) cinfo->dest;
+    std::vector<uint8_t> &data = *dest->data;
+    // libjpeg expects the whole buffer to be flushed when this is called
+    size_t used = data.size();
+    data.resize(used * 2);
+    dest->pub.next_output_byte = &data[used];
+    dest->pub.free_in_buffer = data.size() - used;
+    return TRUE;
+  }
+
+  void termDestination(j_compress_ptr cinfo)
+  {
+    VectorDestination *dest = (VectorDestination *) cinfo->dest;
+    dest->data->resize(dest->data->size() - dest->pub.free_in_buffer);
+  }
+}
+
+bool JpegFrameWriter::encode(const MinImg &frame, std::vector<uint8_t> &data)
+{
+  if (frame.channelDepth != 1 || frame.format != FMT_UINT || (frame.channels != 3 && frame.channels != 1))
+    return false;
+
+  jpeg_compress_struct cinfo;
+  ErrorManager error;
+  VectorDestination dest;
+
+  cinfo.err = jpeg_std_error(&error.pub);
+  error.pub.error_exit = errorExit;
+  // nothing with a destructor may live in this scope past this point
+  if (setjmp(error.jump))
+  {
+    jpeg_destroy_compress(&cinfo);
+    return false;
+  }
+  jpeg_create_compress(&cinfo);
+
+  dest.pub.init_destination = initDestination;
+  dest.pub.empty_output_buffer = emptyOutputBuffer;
+  dest.pub.term_destination = termDestination;
+  dest.data = &data;
+  cinfo.dest = &dest.pub;
+
+  cinfo.image_width = frame.width;
+  cinfo.image_height = frame.height;
+  cinfo.input_components = frame.channels;
+  cinfo.in_color_space = frame.channels == 3 ? JCS_RGB : JCS_GRAYSCALE;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, _quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height)
+  {
+    JSAMPROW row = (JSAMPROW) (frame.pScan0 + cinfo.next_scanline * frame.stride);
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return true;
+}
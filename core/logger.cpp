@@ -36,10 +36,25 @@ THE SOFTWARE.
 #include <sstream>
 #include "logger.h"
 
+#ifdef LOGGER_THREAD_SAFE
+# include <boost/thread/recursive_mutex.hpp>
+# include <boost/thread/locks.hpp>
+// never destroyed on purpose: the logger itself logs from static destructors
+static boost::recursive_mutex &loggerMutex()
+{
+  static boost::recursive_mutex *mutex = new boost::recursive_mutex;
+  return *mutex;
+}
+# define LOGGER_CRITICAL_SECTION   boost::lock_guard<boost::recursive_mutex> lock(loggerMutex());
+#else
+# define LOGGER_CRITICAL_SECTION
+#endif
+
 namespace Logger {
 
 MessageLevel SetLogLevel(MessageLevel newLevel)
 {
+  LOGGER_CRITICAL_SECTION
   Logger &logger = LoggerHolder::getLogger();
   MessageLevel old = logger.logLevel;
   logger.logLevel = newLevel;
@@ -103,6 +118,7 @@ Logger::Logger()
 
 void Logger::RawLog(const std::string &buf, MessageLevel messageLevel)
 {
+  LOGGER_CRITICAL_SECTION
   *outputStream << buf << std::flush;
   if (customLogFunction)
     customLogFunction(buf, messageLevel);
@@ -110,6 +126,7 @@ void Logger::RawLog(const std::string &buf, MessageLevel messageLevel)
 
 void Logger::Log(MessageLevel level, const std::string &msg, const SourceInfo *si)
 {
+  LOGGER_CRITICAL_SECTION
   if (level < trace || level > error)
     level = MessageLevel(error + 1);
   stats[level]++;
@@ -164,6 +181,7 @@ void Logger::Log(MessageLevel level, const std::string &msg, const SourceInfo *s
 
 void Logger::LogStats()
 {
+  LOGGER_CRITICAL_SECTION
   std::stringstream oss;
   oss << std::endl;
   oss <<  "******* LOG STATISTICS *******" << std::endl;
@@ -179,11 +197,13 @@ void Logger::LogStats()
 
 LogStatistics Logger::GetLogStatistics()
 {
+  LOGGER_CRITICAL_SECTION
   return LogStatistics(stats[trace], stats[debug], stats[info], stats[warning], stats[error], stats[error+1]);
 }
 
 RawLogFunction Logger::SetLogFunction(RawLogFunction newFunction)
 {
+  LOGGER_CRITICAL_SECTION
   RawLogFunction oldFunc = customLogFunction;
   if (newFunction)
     Log(info, "*** Setting new additional logging function ***");
@@ -195,6 +215,7 @@ RawLogFunction Logger::SetLogFunction(RawLogFunction newFunction)
 
 void Logger::SetLogStream(std::ostream *newStream, bool __needCleanUp)
 {
+  LOGGER_CRITICAL_SECTION
   if (!newStream)
   {
     Log(error, "cannot log to a NULL-stream");
@@ -262,6 +283,7 @@ LoggerHolder::~LoggerHolder()
 
 Logger &LoggerHolder::getLogger()
 {
+  LOGGER_CRITICAL_SECTION
   if (!theLogger)
     theLogger = new Logger;
   return *theLogger;
@@ -34,6 +34,7 @@ THE SOFTWARE.
 //
 //  Allows to log messages with different importance levels
 //  It dumps memory leaks information if executed under MS Visual Studio in debug mode
+//  If built with LOGGER_THREAD_SAFE the logger may be used from several threads at once
 //
 //  The logger can log any objects which are able to print themselves to std::ostream.
 //
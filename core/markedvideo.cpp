@@ -0,0 +1,899 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <algorithm>
+#include <set>
+
+#include <videoreader.h>
+#include <videoclip.h>
+
+#include "markedvideo.h"
+#include "frame_writer.h"
+#include "dump_plan.h"
+#include "dump_pipeline.h"
+#include "dump_manifest.h"
+#include "frame_pack.h"
+#include "markup_binary.h"
+#include "markup_journal.h"
+#include "markup_query.h"
+#include "fileutil.h"
+#include "logger.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+// if we jump to less than this many frames forward, use multiple readNextFrame()
+// instead of seeking - this increases speed
+#define GOTOFRAME_SEEK_THRES   200
+
+MarkedVideo::MarkedVideo()
+: _autoLoadMarkup_flag(true),
+  _journaling(false),
+  _recoveredEdits(0)
+{
+  _videoReader = createVideoReader(VideoReader::FFMpegReader);
+  _journal = new MarkupJournal;
+}
+
+MarkedVideo::~MarkedVideo()
+{
+  closeVideo();
+  deleteVideoReader(_videoReader);
+  _videoReader = 0;
+  delete _journal;
+}
+
+void MarkedVideo::closeVideo()
+{
+  _videoReader->close();
+  _videoName = "";
+
+  _journal->close();
+  _markup.clear();
+  _markupName = "";
+  _recoveredEdits = 0;
+  _proposals.clear();
+}
+
+bool MarkedVideo::loadVideo(const std::string &name, const char *markupName)
+{
+  closeVideo();
+
+  if (!_videoReader->open(name.c_str()))
+    return false;
+  if (!_videoReader->readNextFrame())
+    return false;
+  _videoName = name;
+
+  std::string markupPath;
+  if (markupName)
+  {
+    markupPath = markupName;
+    LOG_INFO("Using custom markup '" << markupPath << "'...");
+    loadMarkup(markupPath);
+  }
+  else if (_autoLoadMarkup_flag)
+  {
+    markupPath = guessMarkupName(name);
+    LOG_INFO("Trying to load markup automatically from '" << markupPath << "'...");
+    loadMarkup(markupPath);
+  }
+
+  // a markup which has never been saved is journaled too
+  if (_journaling && _markupName.empty())
+  {
+    if (markupPath.empty() || getFileSize(markupPath) >= 0)
+      markupPath = guessMarkupName(name);
+    if (getFileSize(markupPath) < 0)
+    {
+      _markup.clear();
+      _recoveredEdits = std::max(_journal->replay(markupPath, _markup), 0);
+      if (_recoveredEdits > 0)
+      {
+        LOG_INFO(_recoveredEdits << " edit(s) of an unsaved markup recovered from the journal");
+        _markupName = markupPath;
+      }
+      _journal->open(markupPath);
+    }
+  }
+
+  std::string proposalsName = getProposalsName(name);
+  if (getFileSize(proposalsName) >= 0 && loadProposals(proposalsName))
+    LOG_INFO(_proposals.size() << " proposed interval(s) loaded from '" << proposalsName << "'");
+  return true;
+}
+
+bool MarkedVideo::loadMarkup(const std::string &name)
+{
+  _journal->close();
+  _markup.clear();
+  _markupName = "";
+  _recoveredEdits = 0;
+  if (!_videoReader->isOpened())
+  {
+    LOG_ERROR("Video must be loaded prior to markup");
+    return false;
+  }
+  std::vector<std::string> errors;
+  if (!video_markup::loadMarkupFile(_markup, name.c_str(), &errors))
+  {
+    for (size_t i = 0; i < errors.size(); i++)
+      LOG_ERROR(errors[i]);
+    LOG_ERROR("Failed to load markup from '" << name << "'");
+    return false;
+  }
+  _recoveredEdits = std::max(_journal->replay(name, _markup), 0);
+  if (_recoveredEdits > 0)
+    LOG_INFO(_recoveredEdits << " edit(s) recovered from the journal");
+  if (_journaling)
+    _journal->open(name);
+
+  int totalFrames = _videoReader->getTotalFrames();
+  if (totalFrames >= 0 && _markup.size() > 0 && _markup.at(_markup.size() - 1).end >= totalFrames)
+  {
+    LOG_WARNING("Last markup interval is outside of the video");
+  }
+
+  int comments = 0;
+  for (unsigned i = 0; i < _markup.size(); i++)
+    if (_markup.at(i).comment != "")
+      comments++;
+
+  std::ostringstream oss;
+  oss << _markup.size() << " interval(s) loaded";
+  if (comments)
+    oss << " and " << comments << " comment(s)";
+
+  LOG_INFO(oss.str());
+  _markupName = name;
+  return true;
+}
+
+int MarkedVideo::getTotalFrames()
+{
+  return _videoReader->getTotalFrames();
+}
+
+const Interval *MarkedVideo::getCurrentInterval()
+{
+  int frame = getCurrentFrameNumber();
+  if (frame < 0)
+    return 0;
+  int id = _markup.find(frame);
+  if (id < 0)
+    return 0;
+  else
+    return &_markup.at(id);
+}
+
+int MarkedVideo::getTotalIntervals()
+{
+  return _markup.size();
+}
+
+bool MarkedVideo::pushInterval(const Interval *interval)
+{
+  if (_markup.push(*interval) < 0)
+    return false;
+  _journal->push(*interval);
+  return true;
+}
+
+bool MarkedVideo::deleteCurrentInterval()
+{
+  int frame = getCurrentFrameNumber();
+  if (frame < 0)
+    return false;
+  int id = _markup.find(frame);
+  if (id < 0)
+    return false;
+  int start = _markup[id].start;
+  if (!_markup.erase(id))
+    return false;
+  _journal->erase(start);
+  return true;
+}
+
+bool MarkedVideo::updateInterval(int id, const Interval &interval)
+{
+  if (id < 0 || id >= (int) _markup.size())
+    return false;
+  int oldStart = _markup[id].start;
+  if (!_markup.update(id, interval))
+    return false;
+  _journal->update(oldStart, interval);
+  return true;
+}
+
+bool MarkedVideo::moveToIntervalEnd()
+{
+  const Interval *interval = getCurrentInterval();
+  if (interval)
+    return goToFrame(interval->end);
+  else
+    return false;
+}
+
+bool MarkedVideo::moveToIntervalStart()
+{
+  const Interval *interval = getCurrentInterval();
+  if (interval)
+    return goToFrame(interval->start);
+  else
+    return false;
+}
+
+bool MarkedVideo::moveToNextInterval()
+{
+  int interval = _markup.findNextClosest(getCurrentFrameNumber());
+  if (interval < 0)
+    return false;
+  goToFrame(_markup.at(interval).start);
+  return true;
+}
+
+void MarkedVideo::setProposals(const Markup &proposals)
+{
+  _proposals = proposals;
+}
+
+bool MarkedVideo::loadProposals(const std::string &name)
+{
+  _proposals.clear();
+  if (!_proposals.load(name.c_str()))
+  {
+    LOG_WARNING("Cannot load proposals '" << name << "'");
+    _proposals.clear();
+    return false;
+  }
+  return true;
+}
+
+bool MarkedVideo::acceptProposal()
+{
+  int id = _proposals.find(getCurrentFrameNumber());
+  if (id < 0)
+    return false;
+  Interval interval = _proposals[id];
+  if (!pushInterval(&interval))
+    return false;
+  _proposals.erase(id);
+  return true;
+}
+
+bool MarkedVideo::moveToNextProposal()
+{
+  int id = _proposals.findNextClosest(getCurrentFrameNumber());
+  if (id < 0)
+    return false;
+  goToFrame(_proposals.at(id).start);
+  return true;
+}
+
+bool MarkedVideo::moveToPrevProposal()
+{
+  int id = _proposals.findPrevClosest(getCurrentFrameNumber());
+  if (id < 0)
+    return false;
+  goToFrame(_proposals.at(id).start);
+  return true;
+}
+
+bool MarkedVideo::moveToPrevInterval()
+{
+  int interval = _markup.findPrevClosest(getCurrentFrameNumber());
+  if (interval < 0)
+    return false;
+  goToFrame(_markup.at(interval).start);
+  return true;
+}
+
+bool MarkedVideo::moveToNextMatch(video_markup::QueryResult &result)
+{
+  result.refresh(_markup);
+  int interval = result.findNext(_markup, getCurrentFrameNumber());
+  if (interval < 0)
+    return false;
+  goToFrame(_markup.at(interval).start);
+  return true;
+}
+
+bool MarkedVideo::moveToPrevMatch(video_markup::QueryResult &result)
+{
+  result.refresh(_markup);
+  int interval = result.findPrev(_markup, getCurrentFrameNumber());
+  if (interval < 0)
+    return false;
+  goToFrame(_markup.at(interval).start);
+  return true;
+}
+
+const MinImg *MarkedVideo::getNextFrame()
+{
+  return _videoReader->readNextFrame();
+}
+
+const MinImg *MarkedVideo::getCurrentFrame()
+{
+  return _videoReader->getCurrentFrame();
+}
+
+int MarkedVideo::getCurrentIntervalId()
+{
+  int frame = getCurrentFrameNumber();
+  if (frame < 0)
+    return -1;
+  return _markup.find(frame);
+}
+
+int MarkedVideo::getCurrentFrameNumber()
+{
+  int pos = _videoReader->getPos();
+  if (pos < 0)
+    return -1;
+  else
+    return pos - 1;
+}
+
+bool MarkedVideo::saveMarkup(const std::string &name) const
+{
+  if (!video_markup::saveMarkupFile(_markup, name.c_str()))
+    return false;
+  // saved edits are not needed in the journal any more
+  if (_journaling && name == _journal->getMarkupName())
+    _journal->reset();
+  else if (_journaling)
+    _journal->open(name);
+  return true;
+}
+
+void MarkedVideo::setJournaling(bool yesOrNo)
+{
+  _journaling = yesOrNo;
+  if (!_journaling)
+    _journal->close();
+}
+
+bool MarkedVideo::pollJournal()
+{
+  return _journal->poll(_markup);
+}
+
+bool MarkedVideo::gotoInterval(int id)
+{
+  if (!_videoReader->isOpened())
+    return false;
+  if (id < 0 || id >= (int) _markup.size())
+    return false;
+  if (!_videoReader->seek(_markup.at(id).start))
+  {
+    LOG_ERROR("VideoReader::seek() failed");
+    return false;
+  }
+  if (!_videoReader->readNextFrame())
+    return false;
+  return true;
+}
+
+bool MarkedVideo::frameWithinBorders(int frame) const
+{
+  int start = _markup.getStartFrame();
+  int end   = _markup.getEndFrame();
+  if (start >= 0 && frame < start)
+    return false;
+  else if (end >= 0 && frame > end)
+    return false;
+  else
+    return true;
+}
+
+bool MarkedVideo::setStartFrame(int startFrame)
+{
+  if (!_markup.setStartFrame(startFrame))
+  {
+    LOG_ERROR("Failed to set start frame. Check if intervals before the frame exist");
+    return false;
+  }
+  _journal->setStartFrame(startFrame);
+  return true;
+}
+
+bool MarkedVideo::setEndFrame(int endFrame)
+{
+  if (!_markup.setEndFrame(endFrame))
+  {
+    LOG_ERROR("Failed to set end frame. Check if intervals after the frame exist");
+    return false;
+  }
+  _journal->setEndFrame(endFrame);
+  return true;
+}
+
+bool MarkedVideo::goToFrame(int frameNumber)
+{
+  if (!_videoReader->isOpened())
+    return false;
+  if (frameNumber < 0)
+    frameNumber = 0;
+  if (getTotalFrames() > 0 && frameNumber >= getTotalFrames())
+    frameNumber = getTotalFrames() - 1;
+
+  int diff = frameNumber - getCurrentFrameNumber();
+  // after skipNextFrame() there is no current frame, so even the same frame has to be read again
+  if (diff >= 0 && diff < GOTOFRAME_SEEK_THRES && (diff > 0 || _videoReader->getCurrentFrame()))
+  {
+    for (int i = 0; i < diff; i++)
+      if (!_videoReader->readNextFrame())
+      {
+        LOG_ERROR("VideoReader::seek() failed");
+        return false;
+      }
+  }
+  else
+  {
+    if (!_videoReader->seek(frameNumber))
+    {
+      LOG_ERROR("VideoReader::seek() failed");
+      return false;
+    }
+    if (!_videoReader->readNextFrame())
+    {
+      LOG_ERROR("Failed to read frame " << frameNumber);
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string MarkedVideo::getMarkupName() const
+{
+  return _markupName;
+}
+
+void MarkedVideo::setMarkupName(std::string name)
+{
+  _markupName = name;
+}
+
+bool MarkedVideo::dump(int startFrame, int endFrame, const char *format, FrameWriter &writer)
+{
+  int pos = getCurrentFrameNumber();
+  if (startFrame < 0)
+    startFrame = 0;
+  if (getTotalFrames() > 0 && endFrame >= getTotalFrames())
+    endFrame = getTotalFrames() - 1;
+  if (!goToFrame(startFrame))
+    return false;
+  bool fError = false;
+  for (int i = startFrame; i <= endFrame; i++)
+  {
+    char buf[4096];
+    sprintf(buf, format, i);
+
+    const MinImg *minimg = getCurrentFrame();
+    if (!minimg || !writer.write(*minimg, buf))
+    {
+      fError = true;
+      break;
+    }
+
+    if (i < endFrame && !getNextFrame())
+      break;
+  }
+  goToFrame(pos);
+  return !fError;
+}
+
+bool MarkedVideo::checkRegion(const DumpOptions &options) const
+{
+  int width = _videoReader->getWidth();
+  int height = _videoReader->getHeight();
+  if (options.hasRegion() && !options.isRegionValid(width, height))
+  {
+    LOG_ERROR("Crop " << options.cropX << "," << options.cropY << (options.cropAroundBorder ? " (from the border)" : "")
+              << " is outside of the " << width << "x" << height << " frame of '" << _videoName << "'");
+    return false;
+  }
+  return true;
+}
+
+bool MarkedVideo::dump(const DumpPlan &plan, const DumpOptions &options, FrameWriter &writer, DumpStatistics *stats)
+{
+  if (!_videoReader->isOpened() || !checkRegion(options))
+    return false;
+
+  if (options.perIntervalDirs)
+    for (size_t i = 0; i < plan.getItems().size(); i++)
+      if (!makeDir(options.getIntervalDir(plan.getItems()[i].interval)))
+      {
+        LOG_ERROR("Cannot create directory " << options.getIntervalDir(plan.getItems()[i].interval));
+        return false;
+      }
+
+  // the manifest records every saved frame, so an interrupted dump can be resumed
+  std::ostringstream settings;
+  settings << "format=" << writer.getExtension() << " margin=" << options.margin
+           << " per-interval=" << options.perIntervalDirs
+           << " crop=" << options.cropX << "," << options.cropY << "," << options.cropWidth << "," << options.cropHeight
+           << (options.cropAroundBorder ? ",border" : "")
+           << " size=" << options.outputWidth << "x" << options.outputHeight;
+  DumpManifest manifest;
+  if (!manifest.open(options.getManifestName(), options.directory, settings.str(), options.resume))
+    return false;
+
+  // frames saved by an earlier run are skipped, completely saved intervals are not even decoded
+  // and their files are trusted, only those of partly saved intervals are checked
+  std::vector<DumpPlan::Item> left;
+  std::set<std::string> missing;
+  std::vector<std::string> names;
+  std::set<std::string> present;    // intervals sharing frames share their files too
+  for (size_t i = 0; i < plan.getItems().size(); i++)
+  {
+    const DumpPlan::Item &item = plan.getItems()[i];
+    if (options.resume && manifest.isIntervalDone(item.interval, item.start, item.end))
+    {
+      for (int frame = item.start; frame <= item.end; frame++)
+        present.insert(options.getFileName(item.interval, frame, writer.getExtension()));
+      continue;
+    }
+    names.clear();
+    for (int frame = item.start; frame <= item.end; frame++)
+    {
+      std::string name = options.getFileName(item.interval, frame, writer.getExtension());
+      if (options.resume && manifest.hasFile(name, options.verify))
+        present.insert(name);
+      else
+        names.push_back(name);
+    }
+    if (names.empty())
+    {
+      manifest.setIntervalDone(item.interval, item.start, item.end);
+      continue;
+    }
+    manifest.expect(item.interval, item.start, item.end, names);
+    if (options.resume)
+      missing.insert(names.begin(), names.end());
+    left.push_back(item);
+  }
+  if (options.resume)
+    LOG_INFO(plan.getItems().size() - left.size() << " interval(s) complete, "
+             << present.size() << " file(s) already saved by earlier runs");
+  DumpPlan rest;
+  rest.build(left);
+
+  const std::vector<DumpPlan::Item> &items = rest.getItems();
+  const std::vector<DumpPlan::Range> &ranges = rest.getRanges();
+
+  int pos = getCurrentFrameNumber();
+  bool fError = false;
+  size_t nextItem = 0;
+  std::vector<const DumpPlan::Item *> active;   // items containing the current frame
+  std::vector<std::string> files;
+  bool regions = options.hasRegion();
+  int width = _videoReader->getWidth();
+  int height = _videoReader->getHeight();
+  // decoding happens here, encoding and saving go on in the background
+  DumpPipeline pipeline(writer, options.threads, options.io, &manifest);
+  for (size_t r = 0; r < ranges.size() && !fError; r++)
+  {
+    // ranges are increasing, so this only moves forward
+    if (!goToFrame(ranges[r].start))
+    {
+      fError = true;
+      break;
+    }
+    for (int frame = ranges[r].start; frame <= ranges[r].end; frame++)
+    {
+      while (nextItem < items.size() && items[nextItem].start <= frame)
+        active.push_back(&items[nextItem++]);
+      for (size_t i = 0; i < active.size(); )
+        if (active[i]->end < frame)
+          active.erase(active.begin() + i);
+        else
+          i++;
+
+      if (!regions)
+      {
+        files.clear();
+        for (size_t i = 0; i < active.size(); i++)
+        {
+          std::string name = options.getFileName(active[i]->interval, frame, writer.getExtension());
+          if (!options.resume || missing.count(name))
+            files.push_back(name);
+        }
+        if (!files.empty())
+          fError = !pipeline.push(_videoReader->getCurrentFrameRef(), files);
+      }
+      else
+      {
+        // only the regions are converted; intervals with equal regions share the file
+        std::vector<bool> saved(active.size(), false);
+        for (size_t i = 0; i < active.size() && !fError; i++)
+        {
+          if (saved[i])
+            continue;
+          FrameRegion region = options.getRegion(_markup[active[i]->interval], width, height);
+          files.clear();
+          for (size_t j = i; j < active.size(); j++)
+            if (!saved[j] && options.getRegion(_markup[active[j]->interval], width, height) == region)
+            {
+              std::string name = options.getFileName(active[j]->interval, frame, writer.getExtension());
+              if (!options.resume || missing.count(name))
+                files.push_back(name);
+              saved[j] = true;
+            }
+          if (files.empty())
+            continue;
+          FrameRef image = _videoReader->convertCurrentFrame(region);
+          if (image.isNull())
+            LOG_ERROR("Failed to convert frame " << frame);
+          fError = image.isNull() || !pipeline.push(image, files);
+        }
+      }
+      if (fError)
+        break;
+
+      if (frame < ranges[r].end && !(regions ? _videoReader->skipNextFrame() : getNextFrame() != 0))
+      {
+        LOG_ERROR("Failed to read frame " << frame + 1);
+        fError = true;
+        break;
+      }
+    }
+  }
+  if (!pipeline.finish())
+    fError = true;
+  if (!manifest.close())
+    fError = true;
+  goToFrame(pos);
+
+  pipeline.logStatistics();
+  if (stats)
+  {
+    DumpPipeline::Statistics pipelineStats = pipeline.getStatistics();
+    stats->written = pipelineStats.frames;
+    stats->linked = pipelineStats.files - pipelineStats.frames;
+    stats->skipped = (long) present.size();
+  }
+  return !fError;
+}
+
+bool MarkedVideo::dumpPack(const DumpPlan &plan, const DumpOptions &options, DumpStatistics *stats)
+{
+  if (!_videoReader->isOpened() || !checkRegion(options))
+    return false;
+
+  const std::vector<DumpPlan::Item> &items = plan.getItems();
+  const std::vector<DumpPlan::Range> &ranges = plan.getRanges();
+  int width = _videoReader->getWidth();
+  int height = _videoReader->getHeight();
+  bool regions = options.hasRegion();
+  int packWidth = width, packHeight = height;
+  if (regions)
+  {
+    // the region size does not depend on the interval, only its position does
+    FrameRegion region = options.getRegion(video_markup::Interval(), width, height);
+    packWidth = region.outputWidth > 0 ? region.outputWidth : region.width;
+    packHeight = region.outputHeight > 0 ? region.outputHeight : region.height;
+  }
+
+  // per interval packs are opened when their interval starts and closed when it ends,
+  // so only a few files are open at a time
+  std::vector<FramePackWriter *> packs;
+  std::vector<const DumpPlan::Item *> active;   // items containing the current frame
+  FramePackWriter wholePack;
+  bool fError = false;
+  if (!options.perIntervalDirs)
+  {
+    if (!wholePack.create(options.getPackName(-1), _markup, items, packWidth, packHeight, 3))
+      return false;
+    packs.push_back(&wholePack);
+  }
+
+  int pos = getCurrentFrameNumber();
+  long files = 0, frames = 0;
+  uint64_t bytes = 0;
+  size_t nextItem = 0;
+  for (size_t r = 0; r < ranges.size() && !fError; r++)
+  {
+    if (!goToFrame(ranges[r].start))
+    {
+      fError = true;
+      break;
+    }
+    for (int frame = ranges[r].start; frame <= ranges[r].end && !fError; frame++)
+    {
+      for (size_t i = 0; i < active.size() && !fError; )
+        if (active[i]->end < frame)
+        {
+          if (options.perIntervalDirs)
+          {
+            fError = !packs[i]->close();
+            files++;
+            bytes += packs[i]->getFileSize();
+            delete packs[i];
+            packs.erase(packs.begin() + i);
+          }
+          active.erase(active.begin() + i);
+        }
+        else
+          i++;
+      while (nextItem < items.size() && items[nextItem].start <= frame && !fError)
+      {
+        const DumpPlan::Item &item = items[nextItem++];
+        active.push_back(&item);
+        if (options.perIntervalDirs)
+        {
+          packs.push_back(new FramePackWriter);
+          fError = !packs.back()->create(options.getPackName(item.interval), _markup,
+                                         std::vector<DumpPlan::Item>(1, item), packWidth, packHeight, 3);
+        }
+      }
+
+      if (!regions)
+      {
+        const MinImg *minimg = getCurrentFrame();
+        for (size_t i = 0; i < packs.size() && !fError; i++)
+        {
+          fError = !minimg || !packs[i]->putFrame(frame, *minimg);
+          frames += !fError;
+        }
+      }
+      else
+      {
+        for (size_t i = 0; i < active.size() && !fError; i++)
+        {
+          FrameRegion region = options.getRegion(_markup[active[i]->interval], width, height);
+          FrameRef image = _videoReader->convertCurrentFrame(region);
+          if (image.isNull())
+          {
+            LOG_ERROR("Failed to convert frame " << frame);
+            fError = true;
+            break;
+          }
+          FramePackWriter *pack = options.perIntervalDirs ? packs[i] : &wholePack;
+          fError = !pack->putFrame(frame, *image.get(), active[i]->interval);
+          frames += !fError;
+        }
+      }
+
+      if (!fError && frame < ranges[r].end && !(regions ? _videoReader->skipNextFrame() : getNextFrame() != 0))
+      {
+        LOG_ERROR("Failed to read frame " << frame + 1);
+        fError = true;
+      }
+    }
+  }
+  for (size_t i = 0; i < packs.size(); i++)
+  {
+    if (!packs[i]->close())
+      fError = true;
+    files++;
+    bytes += packs[i]->getFileSize();
+    if (packs[i] != &wholePack)
+      delete packs[i];
+  }
+  goToFrame(pos);
+
+  LOG_INFO(frames << " frame(s) packed into " << files << " file(s), " << bytes / 1048576.0 << " MiB");
+  if (stats)
+    stats->written = frames;
+  return !fError;
+}
+
+bool MarkedVideo::exportClips(const DumpPlan &plan, const DumpOptions &options, DumpStatistics *stats)
+{
+  if (!_videoReader->isOpened())
+    return false;
+
+  // a separate instance is used, so the current position stays untouched
+  VideoClipWriter clipWriter;
+  if (!clipWriter.open(_videoName.c_str()))
+  {
+    LOG_ERROR("Cannot open '" << _videoName << "' for copying");
+    return false;
+  }
+  std::string extension;
+  std::string::size_type dot = _videoName.rfind('.');
+  if (dot != std::string::npos && _videoName.find_first_of("/\\", dot) == std::string::npos)
+    extension = _videoName.substr(dot);
+
+  const std::vector<DumpPlan::Item> &items = plan.getItems();
+  bool fError = false;
+  long clips = 0, frames = 0, extraFrames = 0;
+  for (size_t i = 0; i < items.size() && !fError; i++)
+  {
+    const DumpPlan::Item &item = items[i];
+    std::string clipName = options.getClipName(item.interval, extension);
+    int firstFrame = -1;
+    int copied = clipWriter.write(item.start, item.end, clipName.c_str(), &firstFrame);
+    if (copied <= 0 || firstFrame + copied <= item.start)
+    {
+      LOG_ERROR("Failed to export interval " << item.interval << " to " << clipName);
+      fError = true;
+      break;
+    }
+    frames += copied;
+    extraFrames += item.start - firstFrame;
+
+    // the clip markup keeps exact borders relative to the first frame of the clip;
+    // if the video ends early they are cut to the frames actually copied
+    int lastFrame = firstFrame + copied - 1;
+    if (lastFrame < item.end)
+      LOG_WARNING("Interval " << item.interval << " is cut at frame " << lastFrame << ", the video ends there");
+    video_markup::Markup clipMarkup;
+    Interval interval = _markup[item.interval];
+    interval.start -= firstFrame;
+    interval.end = std::min(interval.end, lastFrame) - firstFrame;
+    if (clipMarkup.push(interval) < 0 || !clipMarkup.setStartFrame(item.start - firstFrame)
+        || !clipMarkup.setEndFrame(std::min(item.end, lastFrame) - firstFrame))
+    {
+      LOG_ERROR("Cannot make the markup of clip " << clipName << " (interval " << item.interval
+                << ", frames " << firstFrame << "-" << lastFrame << " copied)");
+      fError = true;
+      break;
+    }
+    std::string markupName = guessMarkupName(clipName);
+    if (!clipMarkup.save(markupName.c_str()))
+    {
+      LOG_ERROR("Failed to save " << markupName);
+      fError = true;
+    }
+    else
+      clips++;
+  }
+
+  LOG_INFO(clips << " clip(s) exported, " << frames << " frame(s) copied (" << extraFrames
+           << " before interval starts to reach key frames)");
+  if (stats)
+    stats->written = frames;
+  return !fError;
+}
+
+std::string MarkedVideo::guessMarkupName(const std::string &videoName)
+{
+  std::string xmlName = videoName + ".xml";
+  std::string binaryName = videoName + ".vmb";
+  if (getFileSize(xmlName) < 0 && getFileSize(binaryName) >= 0)
+    return binaryName;
+  return xmlName;
+}
+
+std::string MarkedVideo::getProposalsName(const std::string &videoName)
+{
+  return videoName + ".proposals.xml";
+}
+
+std::string MarkedVideo::getShortName(const std::string &videoName)
+{
+  std::string::size_type slash = videoName.find_last_of("/\\");
+  std::string name = (slash == std::string::npos) ? videoName : videoName.substr(slash + 1);
+  std::string::size_type dot = name.rfind('.');
+  if (dot != std::string::npos && dot > 0)
+    name.erase(dot);
+  return name;
+}
@@ -0,0 +1,218 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <minimg.h>
+#include "video_markup.h"
+
+class VideoReader;
+class FrameWriter;
+class DumpPlan;
+struct DumpOptions;
+struct DumpStatistics;
+class MarkupJournal;
+namespace video_markup { class QueryResult; }
+
+class MarkedVideo
+{
+public:
+  MarkedVideo();
+  ~MarkedVideo();
+
+  bool loadVideo(const std::string &name, const char *markupName = 0);
+  void closeVideo();
+  std::string getVideoName() const
+  {
+    return _videoName;
+  }
+
+  const MinImg *getCurrentFrame();
+  const MinImg *getNextFrame();
+  bool goToFrame(int frameNumber);
+  int getCurrentFrameNumber();
+  int getTotalFrames();
+
+  /** Loads an XML or a binary markup, the format is told by the file contents
+    */
+  bool loadMarkup(const std::string &name);
+
+  /** Saves the markup in the binary format if the name ends with ".vmb" and as XML otherwise
+    */
+  bool saveMarkup(const std::string &name) const;
+  std::string getMarkupName() const;
+  void setMarkupName(std::string name);
+
+  /** @return VIDEO.xml, or VIDEO.vmb if only the binary markup exists
+    */
+  static std::string guessMarkupName(const std::string &videoName);
+
+  /** @return video file name without directory and extension
+    */
+  static std::string getShortName(const std::string &videoName);
+
+  const video_markup::Markup &getMarkup() const
+  {
+    return _markup;
+  }
+
+  bool gotoInterval(int id);
+  const video_markup::Interval *getCurrentInterval();
+  int getTotalIntervals();
+  bool pushInterval(const video_markup::Interval *);
+  bool deleteCurrentInterval();
+
+  /** Changes the interval (see Markup::update). Intervals must only be changed
+    * through MarkedVideo, so that the journal gets every edit
+    */
+  bool updateInterval(int id, const video_markup::Interval &interval);
+  int getCurrentIntervalId();
+  bool moveToNextInterval();
+  bool moveToPrevInterval();
+
+  /** Go to the next (previous) interval selected by the query.
+    * The selection is refreshed first if the markup has changed
+    */
+  bool moveToNextMatch(video_markup::QueryResult &result);
+  bool moveToPrevMatch(video_markup::QueryResult &result);
+  /** Proposed intervals (see proposeIntervals()) are kept apart from the markup
+    * until the annotator accepts them. They are loaded with the video from
+    * getProposalsName() if that file exists
+    */
+  const video_markup::Markup &getProposals() const
+  {
+    return _proposals;
+  }
+
+  void setProposals(const video_markup::Markup &proposals);
+  bool loadProposals(const std::string &name);
+
+  /** @return VIDEO.proposals.xml
+    */
+  static std::string getProposalsName(const std::string &videoName);
+
+  /** Moves the proposal containing the current frame into the markup
+    * @return false There is no proposal here or it overlaps a marked interval
+    */
+  bool acceptProposal();
+  bool moveToNextProposal();
+  bool moveToPrevProposal();
+
+  bool moveToIntervalEnd();
+  bool moveToIntervalStart();
+
+  bool setStartFrame(int startFrame);
+  bool setEndFrame(int endFrame);
+  
+  bool frameWithinBorders(int frame) const;
+
+  /** Saves frames [startFrame, endFrame] to files named after the printf-like
+    * format which receives the frame number. The range is clipped to the video
+    * @return true Success
+    * @return false Failure
+    */
+  bool dump(int startFrame, int endFrame, const char *format, FrameWriter &writer);
+
+  /** Saves frames according to the plan. The video is read once from front to
+    * back; a frame needed by several intervals is saved once and linked to
+    * the other intervals' files. Frames are encoded and written in parallel
+    * with decoding (see DumpPipeline). Current position is restored afterwards
+    * @param[out] stats If given, gets what was written, linked and skipped
+    * @return true Success
+    * @return false Failure
+    */
+  bool dump(const DumpPlan &plan, const DumpOptions &options, FrameWriter &writer, DumpStatistics *stats = 0);
+
+  /** Saves frames according to the plan into frame packs (see FramePackWriter):
+    * one file for all intervals or one per interval if options.perIntervalDirs
+    * is set. Current position is restored afterwards
+    * @param[out] stats If given, gets the number of frames packed
+    * @return true Success
+    * @return false Failure
+    */
+  bool dumpPack(const DumpPlan &plan, const DumpOptions &options, DumpStatistics *stats = 0);
+
+  /** Exports every interval of the plan (with its margins) as a video clip
+    * of the same format by copying compressed packets, without re-encoding.
+    * A clip starts at the key frame preceding the requested range, so exact
+    * borders are saved to the clip's markup (guessMarkupName of the clip):
+    * the interval itself plus start/end frames marking the requested range
+    * @param[out] stats If given, gets the number of frames copied
+    * @return true Success
+    * @return false Failure
+    */
+  bool exportClips(const DumpPlan &plan, const DumpOptions &options, DumpStatistics *stats = 0);
+
+  void setAutoLoadMarkup(bool yesOrNo)
+  {
+    _autoLoadMarkup_flag = yesOrNo;
+  }
+
+  bool getAutoLoadMarkup() const
+  {
+    return _autoLoadMarkup_flag;
+  }
+
+  /** Enables the markup journal (see MarkupJournal): edits are logged next to
+    * the markup as they are made and recovered when the markup is loaded after
+    * a crash. Markups without a file are journaled next to guessMarkupName()
+    */
+  void setJournaling(bool yesOrNo);
+
+  /** Syncs the journal and compacts it into the markup file when it gets long.
+    * Meant to be called periodically
+    * @return true The markup file has just been rewritten
+    */
+  bool pollJournal();
+
+  /** @return number of edits recovered from the journal when the markup was loaded
+    */
+  int getRecoveredEdits() const
+  {
+    return _recoveredEdits;
+  }
+
+private:
+  MarkedVideo(const MarkedVideo &);
+  MarkedVideo &operator= (const MarkedVideo &);
+
+  /** Logs an error if the crop of options leaves nothing of the frames
+    */
+  bool checkRegion(const DumpOptions &options) const;
+
+  bool _autoLoadMarkup_flag;
+  int _frameNumber;
+  VideoReader *_videoReader;
+  video_markup::Markup _markup;
+  video_markup::Markup _proposals;
+  std::string _videoName;
+  std::string _markupName;
+  bool _journaling;
+  MarkupJournal *_journal;
+  int _recoveredEdits;
+};
@@ -0,0 +1,342 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include "markup_binary.h"
+#include "fileutil.h"
+
+namespace video_markup {
+
+namespace {
+  const char Magic[8] = {'V', 'M', 'M', 'A', 'R', 'K', 'U', 'P'};
+
+  // gives every distinct string its index in the string table
+  class StringInterner
+  {
+  public:
+    StringInterner()
+    {
+      intern("");
+    }
+
+    uint32_t intern(const std::string &s)
+    {
+      std::pair<std::map<std::string, uint32_t>::iterator, bool> res = _indices.insert(std::make_pair(s, (uint32_t) _strings.size()));
+      if (res.second)
+        _strings.push_back(&res.first->first);
+      return res.first->second;
+    }
+
+    const std::vector<const std::string *> &getStrings() const
+    {
+      return _strings;
+    }
+
+  private:
+    std::map<std::string, uint32_t> _indices;
+    std::vector<const std::string *> _strings;
+  };
+}
+
+BinaryMarkupView::BinaryMarkupView()
+{
+  close();
+}
+
+void BinaryMarkupView::close()
+{
+  _file.close();
+  _startFrame = _endFrame = -1;
+  _intervalCount = _labelCount = _stringCount = 0;
+  _intervals = _labels = _strings = _pool = 0;
+}
+
+bool BinaryMarkupView::open(const std::string &fileName, std::string *error)
+{
+  close();
+  std::string problem;
+  if (!_file.open(fileName))
+    problem = "cannot map the file";
+  else if (_file.getSize() < HeaderSize || memcmp(_file.getData(), Magic, sizeof(Magic)))
+    problem = "not a binary markup";
+  else if (getLE32(_file.getData() + 8) != Version)
+    problem = "unsupported version";
+
+  const uint8_t *data = _file.getData();
+  uint64_t fileSize = _file.getSize();
+  uint64_t poolSize = 0;
+  if (problem.empty())
+  {
+    _startFrame = (int) getLE32(data + 12);
+    _endFrame = (int) getLE32(data + 16);
+    _intervalCount = getLE32(data + 20);
+    _labelCount = getLE32(data + 24);
+    _stringCount = getLE32(data + 28);
+    poolSize = getLE32(data + 32);
+
+    // every table must lie inside the file (sizes are 32-bit, offsets are checked first)
+    uint64_t offsets[] = {getLE64(data + 40), getLE64(data + 48), getLE64(data + 56), getLE64(data + 64)};
+    uint64_t sizes[] = {(uint64_t) _intervalCount * IntervalEntrySize, (uint64_t) _labelCount * 4,
+                        (uint64_t) _stringCount * StringEntrySize, poolSize};
+    for (int i = 0; i < 4 && problem.empty(); i++)
+      if (offsets[i] > fileSize || sizes[i] > fileSize - offsets[i])
+        problem = "table is outside of the file";
+    if (problem.empty())
+    {
+      _intervals = data + offsets[0];
+      _labels = data + offsets[1];
+      _strings = data + offsets[2];
+      _pool = data + offsets[3];
+    }
+  }
+
+  // indices are checked once here, so the accessors need not check them
+  if (problem.empty() && _stringCount == 0)
+    problem = "string table is empty";
+  for (size_t i = 0; i < _stringCount && problem.empty(); i++)
+  {
+    uint64_t offset = getLE32(_strings + i * StringEntrySize);
+    uint64_t size = getLE32(_strings + i * StringEntrySize + 4);
+    if (offset + size > poolSize)
+      problem = "string is outside of the pool";
+  }
+  for (size_t i = 0; i < _labelCount && problem.empty(); i++)
+    if (getLE32(_labels + i * 4) >= _stringCount)
+      problem = "invalid label";
+  for (size_t i = 0; i < _intervalCount && problem.empty(); i++)
+  {
+    const uint8_t *entry = getEntry(i);
+    uint64_t firstLabel = getLE32(entry + 20);
+    if (getLE32(entry + 16) >= _stringCount)
+      problem = "invalid comment";
+    else if (firstLabel + getLE32(entry + 24) > _labelCount)
+      problem = "invalid labels";
+    else if (i > 0 && getStart(i) < getStart(i - 1))
+      problem = "intervals are not sorted";
+  }
+
+  if (problem.empty())
+    return true;
+  if (error)
+    *error = problem;
+  close();
+  return false;
+}
+
+int BinaryMarkupView::getStart(size_t index) const
+{
+  return (int) getLE32(getEntry(index));
+}
+
+int BinaryMarkupView::getEnd(size_t index) const
+{
+  return (int) getLE32(getEntry(index) + 4);
+}
+
+std::string BinaryMarkupView::getString(uint32_t index) const
+{
+  const uint8_t *entry = _strings + index * StringEntrySize;
+  return std::string((const char *) _pool + getLE32(entry), getLE32(entry + 4));
+}
+
+void BinaryMarkupView::getInterval(size_t index, Interval &interval) const
+{
+  const uint8_t *entry = getEntry(index);
+  interval.start = (int) getLE32(entry);
+  interval.end = (int) getLE32(entry + 4);
+  interval.type = (int) getLE32(entry + 8);
+  interval.y_border = (int) getLE32(entry + 12);
+  interval.comment = getString(getLE32(entry + 16));
+  interval.labels.clear();
+  const uint8_t *label = _labels + (size_t) getLE32(entry + 20) * 4;
+  for (uint32_t i = getLE32(entry + 24); i > 0; i--, label += 4)
+    interval.labels.insert(getString(getLE32(label)));
+}
+
+int BinaryMarkupView::find(int frame) const
+{
+  // the first interval starting after the frame, the one before it may contain the frame
+  size_t low = 0, high = _intervalCount;
+  while (low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+    if (getStart(middle) <= frame)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  if (low > 0 && getEnd(low - 1) >= frame)
+    return (int) low - 1;
+  return -1;
+}
+
+bool BinaryMarkupView::toMarkup(Markup &markup, std::vector<std::string> *errors) const
+{
+  // every interned string is converted once
+  std::vector<std::string> strings(_stringCount);
+  for (size_t i = 0; i < _stringCount; i++)
+    strings[i] = getString((uint32_t) i);
+  // labels are looked up in the label dictionary once per string as well
+  std::vector<int> labelIds(_stringCount, -1);
+  for (size_t i = 0; i < _labelCount; i++)
+  {
+    uint32_t string = getLE32(_labels + i * 4);
+    if (labelIds[string] < 0)
+      labelIds[string] = LabelSet::intern(strings[string]);
+  }
+
+  std::vector<Interval> intervals(_intervalCount);
+  for (size_t i = 0; i < _intervalCount; i++)
+  {
+    const uint8_t *entry = getEntry(i);
+    Interval &interval = intervals[i];
+    interval.start = (int) getLE32(entry);
+    interval.end = (int) getLE32(entry + 4);
+    interval.type = (int) getLE32(entry + 8);
+    interval.y_border = (int) getLE32(entry + 12);
+    interval.comment = strings[getLE32(entry + 16)];
+    const uint8_t *label = _labels + (size_t) getLE32(entry + 20) * 4;
+    for (uint32_t l = getLE32(entry + 24); l > 0; l--, label += 4)
+      interval.labels.insert(labelIds[getLE32(label)]);
+  }
+
+  markup.clear();
+  markup.setStartFrame(_startFrame);
+  markup.setEndFrame(_endFrame);
+  if (markup.build(intervals, errors))
+    return true;
+  markup.clear();
+  return false;
+}
+
+bool saveBinaryMarkup(const Markup &markup, const char *fileName)
+{
+  StringInterner interner;
+  size_t labelCount = 0;
+  for (size_t i = 0; i < markup.size(); i++)
+    labelCount += markup[i].labels.size();
+
+  uint64_t intervalTableOffset = BinaryMarkupView::HeaderSize;
+  uint64_t labelTableOffset = intervalTableOffset + (uint64_t) markup.size() * BinaryMarkupView::IntervalEntrySize;
+  uint64_t stringTableOffset = labelTableOffset + (uint64_t) labelCount * 4;
+  std::vector<uint8_t> tables((size_t) stringTableOffset, 0);
+
+  size_t label = 0;
+  for (size_t i = 0; i < markup.size(); i++)
+  {
+    const Interval &interval = markup[i];
+    size_t entry = (size_t) intervalTableOffset + i * BinaryMarkupView::IntervalEntrySize;
+    putLE32(&tables[entry], interval.start);
+    putLE32(&tables[entry + 4], interval.end);
+    putLE32(&tables[entry + 8], interval.type);
+    putLE32(&tables[entry + 12], interval.y_border);
+    putLE32(&tables[entry + 16], interner.intern(interval.comment));
+    putLE32(&tables[entry + 20], (uint32_t) label);
+    putLE32(&tables[entry + 24], (uint32_t) interval.labels.size());
+    for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it, label++)
+      putLE32(&tables[(size_t) labelTableOffset + label * 4], interner.intern(*it));
+  }
+
+  const std::vector<const std::string *> &strings = interner.getStrings();
+  size_t stringTableStart = tables.size();
+  tables.resize(stringTableStart + strings.size() * BinaryMarkupView::StringEntrySize);
+  uint64_t poolSize = 0;
+  for (size_t i = 0; i < strings.size(); i++)
+  {
+    putLE32(&tables[stringTableStart + i * BinaryMarkupView::StringEntrySize], (uint32_t) poolSize);
+    putLE32(&tables[stringTableStart + i * BinaryMarkupView::StringEntrySize + 4], (uint32_t) strings[i]->size());
+    poolSize += strings[i]->size();
+  }
+  if (poolSize > 0xFFFFFFFFULL)
+    return false;
+
+  memcpy(&tables[0], Magic, sizeof(Magic));
+  putLE32(&tables[8], BinaryMarkupView::Version);
+  putLE32(&tables[12], markup.getStartFrame());
+  putLE32(&tables[16], markup.getEndFrame());
+  putLE32(&tables[20], (uint32_t) markup.size());
+  putLE32(&tables[24], (uint32_t) labelCount);
+  putLE32(&tables[28], (uint32_t) strings.size());
+  putLE32(&tables[32], (uint32_t) poolSize);
+  putLE64(&tables[40], intervalTableOffset);
+  putLE64(&tables[48], labelTableOffset);
+  putLE64(&tables[56], stringTableOffset);
+  putLE64(&tables[64], tables.size());
+
+  FILE *fp = fopen(fileName, "wb");
+  if (!fp)
+    return false;
+  bool ok = fwrite(&tables[0], tables.size(), 1, fp) == 1;
+  for (size_t i = 0; i < strings.size() && ok; i++)
+    if (!strings[i]->empty())
+      ok = fwrite(strings[i]->data(), strings[i]->size(), 1, fp) == 1;
+  if (fclose(fp) != 0)
+    ok = false;
+  return ok;
+}
+
+bool isBinaryMarkup(const char *fileName)
+{
+  FILE *fp = fopen(fileName, "rb");
+  if (!fp)
+    return false;
+  char magic[sizeof(Magic)];
+  bool res = fread(magic, sizeof(magic), 1, fp) == 1 && !memcmp(magic, Magic, sizeof(Magic));
+  fclose(fp);
+  return res;
+}
+
+bool loadMarkupFile(Markup &markup, const char *fileName, std::vector<std::string> *errors)
+{
+  if (!isBinaryMarkup(fileName))
+    return markup.load(fileName, errors);
+
+  BinaryMarkupView view;
+  std::string error;
+  if (!view.open(fileName, &error))
+  {
+    markup.clear();
+    if (errors)
+      errors->push_back(error);
+    return false;
+  }
+  return view.toMarkup(markup, errors);
+}
+
+bool isBinaryMarkupName(const std::string &fileName)
+{
+  return fileName.size() >= 4 && !fileName.compare(fileName.size() - 4, 4, ".vmb");
+}
+
+bool saveMarkupFile(const Markup &markup, const char *fileName)
+{
+  if (isBinaryMarkupName(fileName))
+    return saveBinaryMarkup(markup, fileName);
+  return markup.save(fileName);
+}
+
+} // namespace video_markup
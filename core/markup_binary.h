@@ -0,0 +1,169 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "fileutil.h"
+#include "video_markup.h"
+
+/** Binary markup (.vmb) holds the same data as the XML markup in a form that
+  * is read without parsing: intervals are stored in a fixed size table
+  * sorted by start frame, comments and labels are interned in a string pool,
+  * so a label used by many intervals is stored once.
+  *
+  * All numbers are little endian. Layout:
+  *
+  *   offset  size  header
+  *        0     8  magic "VMMARKUP"
+  *        8     4  version (1)
+  *       12     4  start frame (-1 if not set)
+  *       16     4  end frame (-1 if not set)
+  *       20     4  number of intervals
+  *       24     4  number of label references
+  *       28     4  number of strings
+  *       32     4  size of the string pool
+  *       36     4  reserved (0)
+  *       40     8  offset of the interval table
+  *       48     8  offset of the label table
+  *       56     8  offset of the string table
+  *       64     8  offset of the string pool
+  *       72     8  reserved (0)
+  *
+  *   interval table, 32 bytes per interval:
+  *     int32 start, end, type, y_border
+  *     uint32 index of the comment in the string table (string 0 is always empty)
+  *     uint32 first label of the interval in the label table
+  *     uint32 number of labels
+  *     uint32 reserved
+  *
+  *   label table: uint32 index in the string table per label
+  *   string table, 8 bytes per string: uint32 offset in the string pool and size
+  *   string pool: contents of the strings (not terminated)
+  */
+namespace video_markup {
+
+class BinaryMarkupView
+{
+public:
+  enum
+  {
+    HeaderSize = 80,
+    IntervalEntrySize = 32,
+    StringEntrySize = 8,
+    Version = 1
+  };
+
+  BinaryMarkupView();
+
+  /** Maps the file and checks its tables. Nothing is copied, intervals
+    * are read from the mapped file when they are asked for
+    * @param[out] error If given, gets the reason of a failure
+    * @return false Failure
+    */
+  bool open(const std::string &fileName, std::string *error = 0);
+  void close();
+
+  int getStartFrame() const
+  {
+    return _startFrame;
+  }
+
+  int getEndFrame() const
+  {
+    return _endFrame;
+  }
+
+  size_t size() const
+  {
+    return _intervalCount;
+  }
+
+  int getStart(size_t index) const;
+  int getEnd(size_t index) const;
+
+  /** Reads the whole interval (the comment and the labels are copied)
+    */
+  void getInterval(size_t index, Interval &interval) const;
+
+  /** @return index of the interval containing the frame
+    * @return -1 There is no such interval
+    */
+  int find(int frame) const;
+
+  /** Copies everything into the markup
+    * @param[out] errors If given, gets a description of every invalid or overlapping interval
+    * @return false Some intervals are invalid, the markup is left empty
+    */
+  bool toMarkup(Markup &markup, std::vector<std::string> *errors = 0) const;
+
+private:
+  BinaryMarkupView(const BinaryMarkupView &);
+  BinaryMarkupView &operator= (const BinaryMarkupView &);
+
+  const uint8_t *getEntry(size_t index) const
+  {
+    return _intervals + index * IntervalEntrySize;
+  }
+
+  std::string getString(uint32_t index) const;
+
+  MappedFile _file;
+  int _startFrame;
+  int _endFrame;
+  size_t _intervalCount;
+  size_t _labelCount;
+  size_t _stringCount;
+  const uint8_t *_intervals;
+  const uint8_t *_labels;
+  const uint8_t *_strings;
+  const uint8_t *_pool;
+};
+
+/** Saves the markup in the binary format
+  * @return false Failure
+  */
+bool saveBinaryMarkup(const Markup &markup, const char *fileName);
+
+/** @return true The file starts with the binary markup magic
+  */
+bool isBinaryMarkup(const char *fileName);
+
+/** @return true The name ends with ".vmb", such markups are saved in the binary format
+  */
+bool isBinaryMarkupName(const std::string &fileName);
+
+/** Loads a markup in either format, the format is told by the file contents
+  * @param[out] errors If given, gets a description of every invalid or overlapping interval
+  */
+bool loadMarkupFile(Markup &markup, const char *fileName, std::vector<std::string> *errors = 0);
+
+/** Saves a markup in the binary format if isBinaryMarkupName() and as XML otherwise
+  */
+bool saveMarkupFile(const Markup &markup, const char *fileName);
+
+} // namespace video_markup
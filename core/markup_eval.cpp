@@ -0,0 +1,259 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#include "markup_eval.h"
+
+namespace video_markup {
+
+double EvaluationCounts::getPrecision() const
+{
+  long detected = truePositives + falsePositives;
+  return detected ? (double) truePositives / detected : 1.0;
+}
+
+double EvaluationCounts::getRecall() const
+{
+  long expected = truePositives + falseNegatives;
+  return expected ? (double) truePositives / expected : 1.0;
+}
+
+double EvaluationCounts::getF1() const
+{
+  double precision = getPrecision(), recall = getRecall();
+  return precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+}
+
+namespace {
+  enum Outcome
+  {
+    Unmatched = 0,
+    Matched,
+    OtherType       ///< overlaps an interval of another type well enough
+  };
+
+  void countLabels(std::map<std::string, EvaluationCounts> &byLabel, const Interval &interval,
+                   long EvaluationCounts::*counter)
+  {
+    for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+      byLabel[*it].*counter += 1;
+  }
+
+  bool startLess(const Mismatch *a, const Mismatch *b)
+  {
+    return a->interval.start < b->interval.start;
+  }
+
+  void printCounts(std::ostream &os, const std::string &name, const EvaluationCounts &counts)
+  {
+    os << std::left << std::setw(20) << name << std::right
+       << std::setw(8) << counts.truePositives
+       << std::setw(8) << counts.falsePositives
+       << std::setw(8) << counts.falseNegatives
+       << std::setw(11) << counts.getPrecision()
+       << std::setw(8) << counts.getRecall()
+       << std::setw(8) << counts.getF1() << std::endl;
+  }
+}
+
+void Evaluation::evaluate(const Markup &reference, const Markup &detected, const EvaluationOptions &options)
+{
+  // only the part of the video the reference markup is made for is evaluated
+  std::vector<const Interval *> found;
+  found.reserve(detected.size());
+  for (size_t j = 0; j < detected.size(); j++)
+  {
+    const Interval &interval = detected[j];
+    if ((reference.getStartFrame() >= 0 && interval.end < reference.getStartFrame())
+        || (reference.getEndFrame() >= 0 && interval.start > reference.getEndFrame()))
+      continue;
+    found.push_back(&interval);
+  }
+
+  std::vector<char> referenceOutcome(reference.size(), Unmatched);
+  std::vector<char> foundOutcome(found.size(), Unmatched);
+  std::vector<int> otherTypes(reference.size(), -1);
+  std::vector<size_t> otherFound(reference.size());
+
+  size_t i = 0, j = 0;
+  while (i < reference.size() && j < found.size())
+  {
+    const Interval &r = reference[i];
+    const Interval &d = *found[j];
+    if (r.end < d.start)
+    {
+      i++;
+      continue;
+    }
+    if (d.end < r.start)
+    {
+      j++;
+      continue;
+    }
+
+    if (referenceOutcome[i] != Matched && foundOutcome[j] != Matched)
+    {
+      double intersection = std::min(r.end, d.end) - std::max(r.start, d.start) + 1;
+      double joined = std::max(r.end, d.end) - std::min(r.start, d.start) + 1;   // they overlap, so there is no gap
+      if (intersection / joined >= options.minIoU && intersection / (r.end - r.start + 1) >= options.minCoverage)
+      {
+        if (!options.matchTypes || r.type == d.type)
+        {
+          // a detection of another type seen before is a false alarm after all
+          if (referenceOutcome[i] == OtherType)
+            foundOutcome[otherFound[i]] = Unmatched;
+          referenceOutcome[i] = foundOutcome[j] = Matched;
+        }
+        else if (referenceOutcome[i] == Unmatched && foundOutcome[j] == Unmatched)
+        {
+          referenceOutcome[i] = foundOutcome[j] = OtherType;
+          otherTypes[i] = d.type;
+          otherFound[i] = j;
+        }
+      }
+    }
+
+    // the interval ending first cannot overlap anything further
+    if (r.end < d.end)
+      i++;
+    else
+      j++;
+  }
+
+  references += reference.size();
+  detections += found.size();
+  for (i = 0; i < reference.size(); i++)
+  {
+    const Interval &interval = reference[i];
+    long EvaluationCounts::*counter = &EvaluationCounts::truePositives;
+    if (referenceOutcome[i] != Matched)
+    {
+      counter = &EvaluationCounts::falseNegatives;
+      Mismatch mismatch;
+      mismatch.kind = referenceOutcome[i] == OtherType ? Mismatch::WrongType : Mismatch::Missed;
+      mismatch.interval = interval;
+      mismatch.otherType = otherTypes[i];
+      mismatches.push_back(mismatch);
+    }
+    total.*counter += 1;
+    byType[interval.type].*counter += 1;
+    countLabels(byLabel, interval, counter);
+  }
+  for (j = 0; j < found.size(); j++)
+  {
+    if (foundOutcome[j] == Matched)
+      continue;
+    const Interval &interval = *found[j];
+    total.falsePositives++;
+    byType[interval.type].falsePositives++;
+    countLabels(byLabel, interval, &EvaluationCounts::falsePositives);
+    // a detection of a wrong type is already listed with the reference interval
+    if (foundOutcome[j] == OtherType)
+      continue;
+    Mismatch mismatch;
+    mismatch.kind = Mismatch::FalseAlarm;
+    mismatch.interval = interval;
+    mismatch.otherType = -1;
+    mismatches.push_back(mismatch);
+  }
+}
+
+void Evaluation::add(const Evaluation &other)
+{
+  references += other.references;
+  detections += other.detections;
+  total.add(other.total);
+  for (std::map<int, EvaluationCounts>::const_iterator it = other.byType.begin(); it != other.byType.end(); ++it)
+    byType[it->first].add(it->second);
+  for (std::map<std::string, EvaluationCounts>::const_iterator it = other.byLabel.begin(); it != other.byLabel.end(); ++it)
+    byLabel[it->first].add(it->second);
+}
+
+void Evaluation::print(std::ostream &os) const
+{
+  os << "reference intervals: " << references << ", detections: " << detections << std::endl;
+  os << std::left << std::setw(20) << "" << std::right
+     << std::setw(8) << "tp" << std::setw(8) << "fp" << std::setw(8) << "fn"
+     << std::setw(11) << "precision" << std::setw(8) << "recall" << std::setw(8) << "f1" << std::endl;
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  os << std::fixed << std::setprecision(3);
+  printCounts(os, "total", total);
+  for (std::map<int, EvaluationCounts>::const_iterator it = byType.begin(); it != byType.end(); ++it)
+  {
+    std::ostringstream name;
+    name << "type " << it->first;
+    printCounts(os, name.str(), it->second);
+  }
+  for (std::map<std::string, EvaluationCounts>::const_iterator it = byLabel.begin(); it != byLabel.end(); ++it)
+    printCounts(os, "label " + it->first, it->second);
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void Evaluation::makeMismatchMarkup(Markup &markup) const
+{
+  std::vector<const Mismatch *> sorted;
+  for (size_t i = 0; i < mismatches.size(); i++)
+    sorted.push_back(&mismatches[i]);
+  std::stable_sort(sorted.begin(), sorted.end(), startLess);
+
+  static const char *const kindLabels[] = {"missed", "false_alarm", "wrong_type"};
+  std::vector<Interval> intervals;
+  for (size_t i = 0; i < sorted.size(); i++)
+  {
+    const Mismatch &mismatch = *sorted[i];
+    std::ostringstream what;
+    if (mismatch.kind == Mismatch::Missed)
+      what << "missed type " << mismatch.interval.type;
+    else if (mismatch.kind == Mismatch::FalseAlarm)
+      what << "false alarm of type " << mismatch.interval.type;
+    else
+      what << "type " << mismatch.interval.type << " detected as " << mismatch.otherType;
+
+    if (!intervals.empty() && mismatch.interval.start <= intervals.back().end)
+    {
+      Interval &joined = intervals.back();
+      joined.end = std::max(joined.end, mismatch.interval.end);
+      joined.comment += "; " + what.str();
+      joined.labels.insert(kindLabels[mismatch.kind]);
+      continue;
+    }
+    Interval interval;
+    interval.start = mismatch.interval.start;
+    interval.end = mismatch.interval.end;
+    interval.type = mismatch.interval.type;
+    interval.comment = what.str();
+    interval.labels.insert(kindLabels[mismatch.kind]);
+    intervals.push_back(interval);
+  }
+  markup.clear();
+  markup.build(intervals);
+}
+
+} // namespace video_markup
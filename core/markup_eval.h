@@ -0,0 +1,140 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iosfwd>
+
+#include "video_markup.h"
+
+namespace video_markup {
+
+struct EvaluationOptions
+{
+  EvaluationOptions()
+  : minIoU(0.5),
+    minCoverage(0),
+    matchTypes(true)
+  {
+  }
+
+  double minIoU;        ///< intersection over union of matched intervals, in frames
+  double minCoverage;   ///< part of the reference interval covered by the detection
+  bool matchTypes;      ///< a detection of another type does not count as a match
+};
+
+struct EvaluationCounts
+{
+  EvaluationCounts()
+  : truePositives(0),
+    falsePositives(0),
+    falseNegatives(0)
+  {
+  }
+
+  void add(const EvaluationCounts &other)
+  {
+    truePositives += other.truePositives;
+    falsePositives += other.falsePositives;
+    falseNegatives += other.falseNegatives;
+  }
+
+  /** @return 1 if nothing was detected
+    */
+  double getPrecision() const;
+
+  /** @return 1 if there was nothing to detect
+    */
+  double getRecall() const;
+
+  double getF1() const;
+
+  long truePositives;     ///< reference intervals matched by a detection
+  long falsePositives;    ///< detections matching no reference interval
+  long falseNegatives;    ///< reference intervals matched by no detection
+};
+
+/** A reference interval missed or a detection not matching any, with the
+  * type of the other interval if it overlapped one of another type
+  */
+struct Mismatch
+{
+  enum Kind
+  {
+    Missed,
+    FalseAlarm,
+    WrongType
+  };
+
+  Kind kind;
+  Interval interval;    ///< the reference interval (Missed, WrongType) or the detection
+  int otherType;        ///< type of the detection (WrongType), -1 otherwise
+};
+
+/** Comparison of detections with reference markups. Both are markups, so
+  * intervals on each side are sorted and do not overlap, and they are
+  * paired in a single sweep over the two lists. Every interval is matched
+  * at most once: overlapping pairs are taken in the order of the sweep if
+  * they pass the thresholds (with minIoU of 0.5 or more no interval can
+  * pass with two others, so the matching does not depend on the order).
+  * Results of several videos are summed with add()
+  */
+class Evaluation
+{
+public:
+  Evaluation()
+  : references(0),
+    detections(0)
+  {
+  }
+
+  /** Adds the results of one video. Detections outside the start and end
+    * frames of the reference markup are ignored
+    */
+  void evaluate(const Markup &reference, const Markup &detected, const EvaluationOptions &options);
+
+  void add(const Evaluation &other);
+
+  /** Precision and recall in total, by type and by label
+    */
+  void print(std::ostream &os) const;
+
+  /** Makes a markup of the mismatches for reviewing them in the GUI:
+    * intervals are labelled missed, false_alarm or wrong_type, mismatches
+    * overlapping each other are joined into one interval
+    */
+  void makeMismatchMarkup(Markup &markup) const;
+
+  long references;
+  long detections;
+  EvaluationCounts total;
+  std::map<int, EvaluationCounts> byType;         ///< by the type of the reference interval or the detection
+  std::map<std::string, EvaluationCounts> byLabel;
+  std::vector<Mismatch> mismatches;               ///< in frames of one video, so add() does not take them
+};
+
+} // namespace video_markup
@@ -0,0 +1,524 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <boost/ref.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "markup_journal.h"
+#include "markup_binary.h"
+#include "fileutil.h"
+#include "logger.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+namespace {
+  const char *NewSuffix = ".new";
+
+  void formatString(std::ostringstream &os, const std::string &s)
+  {
+    os << ' ' << s.size() << ':' << s;
+  }
+
+  void formatInterval(std::ostringstream &os, const Interval &interval)
+  {
+    os << ' ' << interval.start << ' ' << interval.end << ' ' << interval.type << ' ' << interval.y_border
+       << ' ' << interval.labels.size();
+    for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+      formatString(os, *it);
+    formatString(os, interval.comment);
+  }
+
+  std::string formatHeader(const std::string &markupName)
+  {
+    int64_t size = getFileSize(markupName);
+    uint64_t hash = 0;
+    if (size >= 0 && !hashFile(markupName, hash))
+      size = -1;
+    char header[64];
+    sprintf(header, "journal 1 %lld %016llx\n", (long long) size, (unsigned long long) hash);
+    return header;
+  }
+
+  /** Reads records of the journal, every reader stops at the end of the text
+    */
+  class RecordReader
+  {
+  public:
+    RecordReader(const char *begin, const char *end)
+    : _p(begin),
+      _end(end)
+    {
+    }
+
+    const char *getPosition() const
+    {
+      return _p;
+    }
+
+    bool atEnd() const
+    {
+      return _p >= _end;
+    }
+
+    bool readWord(std::string &word)
+    {
+      skipSpaces();
+      const char *start = _p;
+      while (_p < _end && *_p != ' ' && *_p != '\n')
+        _p++;
+      word.assign(start, _p);
+      return _p > start && _p < _end;
+    }
+
+    bool readInt(long long &value)
+    {
+      std::string word;
+      if (!readWord(word))
+        return false;
+      char *end;
+      value = strtoll(word.c_str(), &end, 10);
+      return *end == 0;
+    }
+
+    bool readInt(int &value)
+    {
+      long long v;
+      if (!readInt(v))
+        return false;
+      value = (int) v;
+      return true;
+    }
+
+    bool readString(std::string &s)
+    {
+      skipSpaces();
+      const char *colon = _p;
+      while (colon < _end && *colon >= '0' && *colon <= '9')
+        colon++;
+      if (colon == _p || colon >= _end || *colon != ':')
+        return false;
+      size_t length = (size_t) strtoul(std::string(_p, colon).c_str(), 0, 10);
+      if ((size_t) (_end - colon - 1) < length)
+        return false;
+      s.assign(colon + 1, length);
+      _p = colon + 1 + length;
+      return true;
+    }
+
+    bool readInterval(Interval &interval)
+    {
+      int labels;
+      if (!readInt(interval.start) || !readInt(interval.end) || !readInt(interval.type)
+          || !readInt(interval.y_border) || !readInt(labels) || labels < 0)
+        return false;
+      interval.labels.clear();
+      std::string s;
+      for (int i = 0; i < labels; i++)
+      {
+        if (!readString(s))
+          return false;
+        interval.labels.insert(s);
+      }
+      return readString(interval.comment);
+    }
+
+    /** A record is complete when its line is ended
+      */
+    bool readEnd()
+    {
+      if (_p >= _end || *_p != '\n')
+        return false;
+      _p++;
+      return true;
+    }
+
+  private:
+    void skipSpaces()
+    {
+      while (_p < _end && *_p == ' ')
+        _p++;
+    }
+
+    const char *_p;
+    const char *_end;
+  };
+
+  bool readWholeFile(const std::string &fileName, std::string &contents)
+  {
+    FILE *fp = fopen(fileName.c_str(), "rb");
+    if (!fp)
+      return false;
+    char buf[65536];
+    size_t size;
+    contents.clear();
+    while ((size = fread(buf, 1, sizeof(buf), fp)) > 0)
+      contents.append(buf, size);
+    bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+  }
+
+  int findStart(const Markup &markup, int start)
+  {
+    int id = markup.find(start);
+    return (id >= 0 && markup[id].start == start) ? id : -1;
+  }
+}
+
+void MarkupJournal::Compaction::operator() ()
+{
+  bool res = video_markup::isBinaryMarkupName(markupName) ? video_markup::saveBinaryMarkup(markup, fileName.c_str())
+                                                          : markup.save(fileName.c_str());
+  if (res)
+  {
+    FILE *fp = fopen(fileName.c_str(), "r+b");
+    res = fp && syncFile(fp);
+    if (fp)
+      fclose(fp);
+  }
+  boost::lock_guard<boost::mutex> lock(mutex);
+  ok = res;
+  done = true;
+}
+
+MarkupJournal::MarkupJournal()
+: _file(0),
+  _replayedRecords(0),
+  _replayedLength(0),
+  _records(0),
+  _unsynced(0),
+  _failed(false),
+  _thread(0),
+  _compaction(0)
+{
+}
+
+MarkupJournal::~MarkupJournal()
+{
+  if (_file)
+    sync();
+  finishCompaction(false);
+  if (_file)
+    fclose(_file);
+}
+
+std::string MarkupJournal::getJournalName(const std::string &markupName)
+{
+  return markupName + ".journal";
+}
+
+int MarkupJournal::replay(const std::string &markupName, Markup &markup)
+{
+  _replayedName = "";
+  _replayedRecords = 0;
+  _replayedLength = 0;
+
+  // compaction leaves the new journal aside until the markup file is replaced
+  std::string journalName = getJournalName(markupName);
+  std::string header = formatHeader(markupName);
+  std::string contents;
+  if (readWholeFile(journalName + NewSuffix, contents) && !contents.compare(0, header.size(), header))
+  {
+    if (!replaceFile(journalName + NewSuffix, journalName))
+      return -1;
+  }
+  else if (!readWholeFile(journalName, contents))
+    return -1;
+  if (contents.compare(0, header.size(), header))
+  {
+    LOG_WARNING("Journal '" << journalName << "' was made for another version of the markup, it is ignored");
+    return -1;
+  }
+
+  RecordReader reader(contents.data() + header.size(), contents.data() + contents.size());
+  int records = 0;
+  const char *validEnd = reader.getPosition();
+  std::string word;
+  while (!reader.atEnd())
+  {
+    bool ok = reader.readWord(word);
+    Interval interval;
+    int value = -1, id = -1;
+    if (!ok)
+      ;
+    else if (word == "push")
+      ok = reader.readInterval(interval) && reader.readEnd() && markup.push(interval) >= 0;
+    else if (word == "update")
+      ok = reader.readInt(value) && reader.readInterval(interval) && reader.readEnd()
+           && (id = findStart(markup, value)) >= 0 && markup.update(id, interval);
+    else if (word == "erase")
+      ok = reader.readInt(value) && reader.readEnd() && (id = findStart(markup, value)) >= 0 && markup.erase(id);
+    else if (word == "start_frame")
+      ok = reader.readInt(value) && reader.readEnd() && markup.setStartFrame(value);
+    else if (word == "end_frame")
+      ok = reader.readInt(value) && reader.readEnd() && markup.setEndFrame(value);
+    else
+      ok = false;
+    if (!ok)
+    {
+      // the last record may be cut short by a crash, anything else is worth a warning
+      if (reader.getPosition() < contents.data() + contents.size())
+        LOG_WARNING("Journal '" << journalName << "': record " << records + 1 << " cannot be applied, the rest is ignored");
+      break;
+    }
+    records++;
+    validEnd = reader.getPosition();
+  }
+
+  _replayedName = markupName;
+  _replayedRecords = records;
+  _replayedLength = validEnd - contents.data();
+  return records;
+}
+
+bool MarkupJournal::open(const std::string &markupName)
+{
+  close();
+  _markupName = markupName;
+  _records = 0;
+  _failed = false;
+  std::string journalName = getJournalName(markupName);
+
+  bool ok;
+  if (markupName == _replayedName)
+  {
+    // what follows the valid records (a record cut short) is dropped
+    std::string contents;
+    ok = readWholeFile(journalName, contents) && contents.size() >= _replayedLength;
+    if (ok && contents.size() > _replayedLength)
+      ok = start(journalName, contents.substr(0, _replayedLength));
+    if (ok)
+    {
+      _file = fopen(journalName.c_str(), "ab");
+      _records = _replayedRecords;
+    }
+  }
+  else
+    ok = start(journalName, formatHeader(markupName));
+  _replayedName = "";
+  if (!ok || !_file)
+  {
+    LOG_ERROR("Cannot open markup journal '" << journalName << "'");
+    if (_file)
+      fclose(_file);
+    _file = 0;
+    return false;
+  }
+  return true;
+}
+
+bool MarkupJournal::start(const std::string &fileName, const std::string &contents)
+{
+  // the journal is replaced at once, a crash leaves either the old or the new one
+  std::string newName = fileName + NewSuffix;
+  FILE *fp = fopen(newName.c_str(), "wb");
+  if (!fp)
+    return false;
+  bool ok = fwrite(contents.data(), contents.size(), 1, fp) == 1 && syncFile(fp);
+  if (fclose(fp) != 0)
+    ok = false;
+  if (_file)
+  {
+    fclose(_file);
+    _file = 0;
+  }
+  if (ok)
+    ok = replaceFile(newName, fileName);
+  if (!ok)
+    remove(newName.c_str());
+  if (ok)
+    _file = fopen(fileName.c_str(), "ab");
+  _unsynced = 0;
+  return ok && _file;
+}
+
+void MarkupJournal::close()
+{
+  finishCompaction(false);
+  if (!_file)
+    return;
+  fclose(_file);
+  _file = 0;
+  remove(getJournalName(_markupName).c_str());
+  _markupName = "";
+  _records = 0;
+}
+
+void MarkupJournal::write(const std::string &record)
+{
+  if (!_file)
+    return;
+  if (fwrite(record.data(), record.size(), 1, _file) != 1)
+  {
+    if (!_failed)
+      LOG_ERROR("Failed to write markup journal '" << getJournalName(_markupName) << "'");
+    _failed = true;
+  }
+  _records++;
+  if (_compaction)
+    _tail.push_back(record);
+  if (++_unsynced >= SyncBatch)
+    sync();
+}
+
+void MarkupJournal::push(const Interval &interval)
+{
+  std::ostringstream os;
+  os << "push";
+  formatInterval(os, interval);
+  os << '\n';
+  write(os.str());
+}
+
+void MarkupJournal::update(int oldStart, const Interval &interval)
+{
+  std::ostringstream os;
+  os << "update " << oldStart;
+  formatInterval(os, interval);
+  os << '\n';
+  write(os.str());
+}
+
+void MarkupJournal::erase(int start)
+{
+  std::ostringstream os;
+  os << "erase " << start << '\n';
+  write(os.str());
+}
+
+void MarkupJournal::setStartFrame(int frame)
+{
+  std::ostringstream os;
+  os << "start_frame " << frame << '\n';
+  write(os.str());
+}
+
+void MarkupJournal::setEndFrame(int frame)
+{
+  std::ostringstream os;
+  os << "end_frame " << frame << '\n';
+  write(os.str());
+}
+
+bool MarkupJournal::sync()
+{
+  if (_file && _unsynced > 0 && !syncFile(_file))
+    _failed = true;
+  _unsynced = 0;
+  return !_failed;
+}
+
+bool MarkupJournal::poll(const Markup &markup)
+{
+  if (!_file)
+    return false;
+  sync();
+  if (_compaction)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(_compaction->mutex);
+      if (!_compaction->done)
+        return false;
+    }
+    return finishCompaction(true);
+  }
+  if (_records >= CompactRecords)
+  {
+    _compaction = new Compaction;
+    _compaction->fileName = _markupName + ".compact";
+    _compaction->markupName = _markupName;
+    _compaction->markup = markup;
+    _compaction->done = false;
+    _compaction->ok = false;
+    _tail.clear();
+    _thread = new boost::thread(boost::ref(*_compaction));
+  }
+  return false;
+}
+
+bool MarkupJournal::finishCompaction(bool apply)
+{
+  if (!_compaction)
+    return false;
+  _thread->join();
+  delete _thread;
+  _thread = 0;
+
+  bool replaced = false;
+  std::string compactName = _compaction->fileName;
+  if (apply && !_compaction->ok)
+  {
+    LOG_ERROR("Failed to save markup to '" << compactName << "', the journal is kept");
+  }
+  else if (apply)
+  {
+    // the new journal is put aside first: until the markup file is replaced it is of no use,
+    // after that replay() picks it up even if the old journal has not been replaced yet
+    std::string journalName = getJournalName(_markupName);
+    std::string contents = formatHeader(compactName);
+    for (size_t i = 0; i < _tail.size(); i++)
+      contents += _tail[i];
+    FILE *fp = fopen((journalName + NewSuffix).c_str(), "wb");
+    bool ok = fp && fwrite(contents.data(), contents.size(), 1, fp) == 1 && syncFile(fp);
+    if (fp && fclose(fp) != 0)
+      ok = false;
+    if (ok && replaceFile(compactName, _markupName))
+    {
+      replaced = true;
+      fclose(_file);
+      _file = 0;
+      if (replaceFile(journalName + NewSuffix, journalName))
+        _file = fopen(journalName.c_str(), "ab");
+      if (!_file)
+      {
+        LOG_ERROR("Cannot reopen markup journal '" << journalName << "'");
+        _failed = true;
+      }
+      _records = (int) _tail.size();
+      _unsynced = 0;
+    }
+    else
+    {
+      LOG_ERROR("Failed to replace '" << _markupName << "' by its compacted version");
+    }
+  }
+  remove(compactName.c_str());
+  delete _compaction;
+  _compaction = 0;
+  _tail.clear();
+  return replaced;
+}
+
+void MarkupJournal::reset()
+{
+  finishCompaction(false);
+  if (_file)
+    start(getJournalName(_markupName), formatHeader(_markupName));
+  _records = 0;
+}
@@ -0,0 +1,166 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "video_markup.h"
+
+/** Append-only log of markup edits kept next to the markup file (its name
+  * followed by ".journal"), so that edits made since the last save survive
+  * a crash. It is a text file:
+  *
+  *   journal 1 <size of the markup file> <hash of the markup file>
+  *   push <interval>
+  *   update <start of the old interval> <interval>
+  *   erase <start of the interval>
+  *   start_frame <frame>
+  *   end_frame <frame>
+  *
+  * where an interval is written as
+  *   <start> <end> <type> <y_border> <number of labels> <label>... <comment>
+  * and every string as <length>:<bytes>. Size -1 stands for a markup which
+  * has not been saved yet. The journal only applies to the markup file it
+  * was started for; a line cut short by a crash is ignored.
+  *
+  * Records are synced to the disk in batches. When the journal gets long it
+  * is compacted: a copy of the markup is saved into the markup file by a
+  * background thread and the journal is started anew.
+  */
+class MarkupJournal
+{
+public:
+  enum
+  {
+    SyncBatch = 16,           ///< records written without waiting for the disk
+    CompactRecords = 2048     ///< journal length at which compaction starts
+  };
+
+  MarkupJournal();
+
+  /** Waits for compaction to finish and closes the journal
+    */
+  ~MarkupJournal();
+
+  static std::string getJournalName(const std::string &markupName);
+
+  /** Applies the journal of the markup file to the markup loaded from it
+    * (an empty one if the file does not exist). Replayed records are kept
+    * by the following open() of the same markup
+    * @return number of edits replayed
+    * @return -1 There is no journal for this markup file
+    */
+  int replay(const std::string &markupName, video_markup::Markup &markup);
+
+  /** Starts recording edits of the markup. The journal just replayed is
+    * continued, otherwise the journal is started anew
+    * @return false Failure (error is logged)
+    */
+  bool open(const std::string &markupName);
+
+  /** Closes the journal and removes its file: edits which have not got into
+    * the markup file are dropped. Meant for closing a markup normally, after
+    * it has been saved or its changes have been abandoned
+    */
+  void close();
+
+  bool isOpen() const
+  {
+    return _file != 0;
+  }
+
+  std::string getMarkupName() const
+  {
+    return _markupName;
+  }
+
+  void push(const video_markup::Interval &interval);
+  void update(int oldStart, const video_markup::Interval &interval);
+  void erase(int start);
+  void setStartFrame(int frame);
+  void setEndFrame(int frame);
+
+  /** Writes pending records to the disk
+    * @return false A write error occurred
+    */
+  bool sync();
+
+  /** Meant to be called periodically. Syncs pending records, starts compaction
+    * if the journal is long and completes the compaction when it is done
+    * @return true The markup file has just been rewritten by compaction
+    */
+  bool poll(const video_markup::Markup &markup);
+
+  /** Starts the journal anew after the markup has been saved
+    */
+  void reset();
+
+  int getRecordCount() const
+  {
+    return _records;
+  }
+
+private:
+  MarkupJournal(const MarkupJournal &);
+  MarkupJournal &operator= (const MarkupJournal &);
+
+  struct Compaction
+  {
+    std::string fileName;
+    std::string markupName;     ///< tells the format
+    video_markup::Markup markup;
+    boost::mutex mutex;
+    bool done;
+    bool ok;
+
+    void operator() ();
+  };
+
+  bool start(const std::string &fileName, const std::string &contents);
+  void write(const std::string &record);
+  /** Waits for the compaction thread
+    * @param[in] apply Replace the markup file and the journal if the compaction has succeeded
+    * @return true The markup file has been replaced
+    */
+  bool finishCompaction(bool apply);
+
+  FILE *_file;
+  std::string _markupName;
+  std::string _replayedName;
+  int _replayedRecords;
+  size_t _replayedLength;             ///< the valid part of the replayed journal
+  int _records;
+  int _unsynced;
+  bool _failed;
+  boost::thread *_thread;
+  Compaction *_compaction;
+  std::vector<std::string> _tail;      ///< records written while compaction is running
+};
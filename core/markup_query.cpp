@@ -0,0 +1,347 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#include "markup_query.h"
+
+namespace video_markup {
+
+namespace {
+  /** Splits the text by spaces, double quotes keep spaces within a term
+    * and are removed
+    * @return false A quote is not closed
+    */
+  bool splitTerms(const std::string &text, std::vector<std::string> &terms)
+  {
+    std::string term;
+    bool inTerm = false;
+    bool quoted = false;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+      char c = text[i];
+      if (c == '"')
+      {
+        quoted = !quoted;
+        inTerm = true;
+      }
+      else if (!quoted && (c == ' ' || c == '\t'))
+      {
+        if (inTerm)
+          terms.push_back(term);
+        term.clear();
+        inTerm = false;
+      }
+      else
+      {
+        term += c;
+        inTerm = true;
+      }
+    }
+    if (inTerm)
+      terms.push_back(term);
+    return !quoted;
+  }
+
+  bool parseNumber(const std::string &text, int &value)
+  {
+    if (text.empty())
+      return false;
+    char *end = 0;
+    long number = strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || number < INT_MIN || number > INT_MAX)
+      return false;
+    value = (int) number;
+    return true;
+  }
+
+  bool startsWith(const std::string &text, const char *prefix)
+  {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+  }
+
+  /** The query with label names resolved to ids, as used for a run
+    */
+  struct Filter
+  {
+    std::vector<int> labels;
+    std::vector<int> excludedLabels;
+    const std::vector<int> *types;
+    const std::string *comment;
+    int firstFrame;
+    int lastFrame;
+
+    bool matches(const Interval &interval) const
+    {
+      for (size_t i = 0; i < labels.size(); i++)
+        if (!interval.labels.has(labels[i]))
+          return false;
+      for (size_t i = 0; i < excludedLabels.size(); i++)
+        if (interval.labels.has(excludedLabels[i]))
+          return false;
+      if (!types->empty() && !std::binary_search(types->begin(), types->end(), interval.type))
+        return false;
+      if (!comment->empty() && interval.comment.find(*comment) == std::string::npos)
+        return false;
+      if (firstFrame >= 0 && interval.end < firstFrame)
+        return false;
+      if (lastFrame >= 0 && interval.start > lastFrame)
+        return false;
+      return true;
+    }
+  };
+}
+
+MarkupQuery::MarkupQuery()
+: _firstFrame(-1),
+  _lastFrame(-1)
+{
+}
+
+void MarkupQuery::clear()
+{
+  _labels.clear();
+  _excludedLabels.clear();
+  _types.clear();
+  _comment.clear();
+  _firstFrame = _lastFrame = -1;
+  _text.clear();
+}
+
+bool MarkupQuery::empty() const
+{
+  return _labels.empty() && _excludedLabels.empty() && _types.empty() && _comment.empty()
+      && _firstFrame < 0 && _lastFrame < 0;
+}
+
+bool MarkupQuery::parse(const std::string &text, std::string *error)
+{
+  clear();
+  std::vector<std::string> terms;
+  std::string problem;
+  if (!splitTerms(text, terms))
+    problem = "quote is not closed";
+  for (size_t i = 0; i < terms.size() && problem.empty(); i++)
+  {
+    const std::string &term = terms[i];
+    if (startsWith(term, "type:"))
+    {
+      std::string list = term.substr(5);
+      for (size_t begin = 0; begin <= list.size() && problem.empty(); )
+      {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+          end = list.size();
+        int type;
+        if (parseNumber(list.substr(begin, end - begin), type))
+          _types.push_back(type);
+        else
+          problem = "invalid type in '" + term + "'";
+        begin = end + 1;
+      }
+    }
+    else if (startsWith(term, "comment:"))
+    {
+      _comment = term.substr(8);
+      if (_comment.empty())
+        problem = "empty comment text";
+    }
+    else if (startsWith(term, "frames:"))
+    {
+      std::string range = term.substr(7);
+      size_t dash = range.find('-');
+      std::string first = range.substr(0, dash);
+      std::string last = dash == std::string::npos ? first : range.substr(dash + 1);
+      if ((!first.empty() && (!parseNumber(first, _firstFrame) || _firstFrame < 0))
+          || (!last.empty() && (!parseNumber(last, _lastFrame) || _lastFrame < 0))
+          || (first.empty() && last.empty())
+          || (_lastFrame >= 0 && _firstFrame > _lastFrame))
+        problem = "invalid frame range '" + term + "'";
+    }
+    else if (term[0] == '-' && term.size() > 1)
+      _excludedLabels.push_back(term.substr(1));
+    else if (term != "-")
+      _labels.push_back(term);
+    else
+      problem = "label is missing after '-'";
+  }
+
+  if (!problem.empty())
+  {
+    clear();
+    if (error)
+      *error = problem;
+    return false;
+  }
+  std::sort(_types.begin(), _types.end());
+  _types.erase(std::unique(_types.begin(), _types.end()), _types.end());
+  _text = text;
+  return true;
+}
+
+bool MarkupQuery::matches(const Interval &interval) const
+{
+  Filter filter;
+  for (size_t i = 0; i < _labels.size(); i++)
+    filter.labels.push_back(LabelSet::lookup(_labels[i]));
+  for (size_t i = 0; i < _excludedLabels.size(); i++)
+    filter.excludedLabels.push_back(LabelSet::lookup(_excludedLabels[i]));
+  filter.types = &_types;
+  filter.comment = &_comment;
+  filter.firstFrame = _firstFrame;
+  filter.lastFrame = _lastFrame;
+  return filter.matches(interval);
+}
+
+void MarkupQuery::run(const Markup &markup, std::vector<int> &starts) const
+{
+  starts.clear();
+  const IntervalIndex &index = markup.getIndex();
+
+  Filter filter;
+  filter.types = &_types;
+  filter.comment = &_comment;
+  filter.firstFrame = _firstFrame;
+  filter.lastFrame = _lastFrame;
+
+  // the shortest posting list gives the candidates, the rest of the query is checked on them
+  const IntervalIndex::Postings *candidates = 0;
+  for (size_t i = 0; i < _labels.size(); i++)
+  {
+    int id = LabelSet::lookup(_labels[i]);
+    const IntervalIndex::Postings *postings = index.findLabel(id);
+    if (!postings)
+      return;
+    if (!candidates || postings->size() < candidates->size())
+      candidates = postings;
+    filter.labels.push_back(id);
+  }
+  for (size_t i = 0; i < _excludedLabels.size(); i++)
+  {
+    int id = LabelSet::lookup(_excludedLabels[i]);
+    if (id >= 0)
+      filter.excludedLabels.push_back(id);
+  }
+
+  IntervalIndex::Postings typeStarts;
+  if (!_types.empty())
+  {
+    std::vector<const IntervalIndex::Postings *> lists;
+    size_t total = 0;
+    for (size_t i = 0; i < _types.size(); i++)
+      if (const IntervalIndex::Postings *postings = index.findType(_types[i]))
+      {
+        lists.push_back(postings);
+        total += postings->size();
+      }
+    if (lists.empty())
+      return;
+    if (!candidates || total < candidates->size())
+    {
+      typeStarts.reserve(total);
+      for (size_t i = 0; i < lists.size(); i++)
+        typeStarts.insert(typeStarts.end(), lists[i]->begin(), lists[i]->end());
+      if (lists.size() > 1)
+        std::sort(typeStarts.begin(), typeStarts.end());
+      candidates = &typeStarts;
+    }
+  }
+
+  // the frame range turns into a range of starts: from the interval reaching the first frame on
+  int firstId = 0;
+  if (_firstFrame >= 0)
+  {
+    firstId = markup.find(_firstFrame);
+    if (firstId < 0)
+      firstId = markup.findNextClosest(_firstFrame);
+    if (firstId < 0)
+      return;
+  }
+  int lastStart = _lastFrame >= 0 ? _lastFrame : INT_MAX;
+
+  if (candidates)
+  {
+    IntervalIndex::Postings::const_iterator it = candidates->begin();
+    if (firstId > 0)
+      it = std::lower_bound(candidates->begin(), candidates->end(), markup[firstId].start);
+    for (; it != candidates->end() && *it <= lastStart; ++it)
+    {
+      int id = markup.find(*it);
+      if (id >= 0 && filter.matches(markup[id]))
+        starts.push_back(*it);
+    }
+  }
+  else
+    for (int id = firstId; id < (int) markup.size() && markup[id].start <= lastStart; id++)
+      if (filter.matches(markup[id]))
+        starts.push_back(markup[id].start);
+}
+
+QueryResult::QueryResult()
+: _markup(0),
+  _revision(0)
+{
+}
+
+void QueryResult::setQuery(const MarkupQuery &query)
+{
+  _query = query;
+  _starts.clear();
+  _markup = 0;
+}
+
+void QueryResult::refresh(const Markup &markup)
+{
+  if (_markup == &markup && _revision == markup.getRevision())
+    return;
+  _query.run(markup, _starts);
+  _markup = &markup;
+  _revision = markup.getRevision();
+}
+
+int QueryResult::findNext(const Markup &markup, int frame) const
+{
+  std::vector<int>::const_iterator it = std::upper_bound(_starts.begin(), _starts.end(), frame);
+  return it != _starts.end() ? markup.find(*it) : -1;
+}
+
+int QueryResult::findPrev(const Markup &markup, int frame) const
+{
+  int current = markup.find(frame);
+  if (current >= 0)
+    frame = markup[current].start;
+  std::vector<int>::const_iterator it = std::lower_bound(_starts.begin(), _starts.end(), frame);
+  return it != _starts.begin() ? markup.find(*(it - 1)) : -1;
+}
+
+int QueryResult::getPosition(const Interval &interval) const
+{
+  std::vector<int>::const_iterator it = std::lower_bound(_starts.begin(), _starts.end(), interval.start);
+  return it != _starts.end() && *it == interval.start ? (int) (it - _starts.begin()) : -1;
+}
+
+} // namespace video_markup
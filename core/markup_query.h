@@ -0,0 +1,133 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "video_markup.h"
+
+namespace video_markup {
+
+/** Selection of intervals by labels, types, comment text and frames.
+  * A query is written as space separated terms, all of which must hold:
+  *
+  *   bad             the interval has label "bad"
+  *   -bad            the interval does not have label "bad"
+  *   type:4          the interval is of type 4
+  *   type:1,4        the interval is of type 1 or 4
+  *   comment:text    the comment contains the text (comment:"two words" for spaces)
+  *   frames:A-B      the interval has frames within A..B (A- and -B are open ranges)
+  *
+  * Labels and types are looked up in the posting lists of the markup, so
+  * the time of a query depends on the number of intervals it selects rather
+  * than on the size of the markup
+  */
+class MarkupQuery
+{
+public:
+  MarkupQuery();
+
+  /** @param[out] error If given, gets the description of a syntax error
+    * @return false Syntax error, the query is left empty
+    */
+  bool parse(const std::string &text, std::string *error = 0);
+
+  void clear();
+
+  /** @return true Every interval is selected
+    */
+  bool empty() const;
+
+  const std::string &getText() const
+  {
+    return _text;
+  }
+
+  bool matches(const Interval &interval) const;
+
+  /** @param[out] starts Starts of the selected intervals in ascending order
+    */
+  void run(const Markup &markup, std::vector<int> &starts) const;
+
+private:
+  std::vector<std::string> _labels;
+  std::vector<std::string> _excludedLabels;
+  std::vector<int> _types;            ///< sorted, empty if any type goes
+  std::string _comment;
+  int _firstFrame;                    ///< <0 if not limited
+  int _lastFrame;                     ///< <0 if not limited
+  std::string _text;
+};
+
+/** Intervals selected by a query, for stepping through them. The selection
+  * is kept up to date with the markup: it is rebuilt by refresh() when the
+  * markup has been changed since the last run
+  */
+class QueryResult
+{
+public:
+  QueryResult();
+
+  void setQuery(const MarkupQuery &query);
+
+  const MarkupQuery &getQuery() const
+  {
+    return _query;
+  }
+
+  /** Runs the query again if the markup has changed
+    */
+  void refresh(const Markup &markup);
+
+  size_t size() const
+  {
+    return _starts.size();
+  }
+
+  /** @return id of the first selected interval starting after the frame
+    * @return -1 There is no such interval
+    */
+  int findNext(const Markup &markup, int frame) const;
+
+  /** @return id of the last selected interval starting before the frame
+    *         (or before the interval containing the frame)
+    * @return -1 There is no such interval
+    */
+  int findPrev(const Markup &markup, int frame) const;
+
+  /** @return position of the interval within the selection
+    * @return -1 The interval is not selected
+    */
+  int getPosition(const Interval &interval) const;
+
+private:
+  MarkupQuery _query;
+  std::vector<int> _starts;
+  const Markup *_markup;      ///< markup the selection was made for
+  unsigned _revision;
+};
+
+} // namespace video_markup
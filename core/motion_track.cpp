@@ -0,0 +1,129 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#include "motion_track.h"
+#include "activity.h"
+#include "fileutil.h"
+
+namespace {
+  const char Magic[8] = {'V', 'M', 'M', 'O', 'T', 'I', 'O', 'N'};
+
+  enum
+  {
+    Version = 2
+  };
+
+  /// energy of sensor and compression noise of a still picture never reaches this many grey levels
+  const double MaxNoiseEnergy = 2.0;
+
+  double percentile(std::vector<float> values, double fraction)
+  {
+    if (values.empty())
+      return 0;
+    std::vector<float>::iterator nth = values.begin() + (size_t) ((values.size() - 1) * fraction);
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+  }
+}
+
+bool MotionTrack::build(const std::string &videoName, int threads, const volatile bool *cancel, volatile int *progress)
+{
+  ActivityOptions options;
+  options.threads = threads;
+  options.bandWidth = 0;
+  options.lumaWidth = LumaWidth;
+  options.lumaHeight = LumaHeight;
+  options.cancel = cancel;
+  options.progress = progress;
+  return computeActivity(videoName, _energy, options);
+}
+
+std::string MotionTrack::getCacheName(const std::string &videoName)
+{
+  return videoName + ".motion";
+}
+
+void MotionTrack::clear()
+{
+  std::vector<float>().swap(_energy);
+}
+
+void MotionTrack::swap(MotionTrack &other)
+{
+  _energy.swap(other._energy);
+}
+
+bool MotionTrack::load(const std::string &cacheName, const std::string &videoName)
+{
+  clear();
+  uint32_t recordSize;
+  std::vector<uint8_t> data;
+  if (!loadVideoCache(cacheName, videoName, Magic, Version, recordSize, data) || recordSize != 4)
+    return false;
+  // energies are kept as little endian IEEE floats
+  _energy.resize(data.size() / 4);
+  for (size_t i = 0; i < _energy.size(); i++)
+  {
+    uint32_t bits = getLE32(&data[i * 4]);
+    memcpy(&_energy[i], &bits, 4);
+  }
+  return true;
+}
+
+bool MotionTrack::save(const std::string &cacheName, const std::string &videoName) const
+{
+  std::vector<uint8_t> data(_energy.size() * 4);
+  for (size_t i = 0; i < _energy.size(); i++)
+  {
+    uint32_t bits;
+    memcpy(&bits, &_energy[i], 4);
+    putLE32(&data[i * 4], bits);
+  }
+  return saveVideoCache(cacheName, videoName, Magic, Version, 4, data);
+}
+
+float MotionTrack::getMaxEnergy() const
+{
+  return _energy.empty() ? 0 : *std::max_element(_energy.begin(), _energy.end());
+}
+
+float MotionTrack::getStaticThreshold() const
+{
+  // the quietest frames give the noise level, so footage that moves most of the time still
+  // keeps its motion; the level is capped since fully moving footage has no quiet frames at all
+  double noise = percentile(_energy, 0.1);
+  double spread = std::max(percentile(_energy, 0.25) - noise, 0.25);
+  return (float) std::min(noise + 3 * spread, MaxNoiseEnergy);
+}
+
+int MotionTrack::findMotion(int frame, float threshold) const
+{
+  for (int i = std::max(frame, 0); i < (int) _energy.size(); i++)
+    if (_energy[i] > threshold)
+      return i;
+  return -1;
+}
@@ -0,0 +1,94 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/** Motion energy of every frame of a video: mean absolute difference of the
+  * downscaled luma of the whole frame and of the previous one (see
+  * computeActivity()). Long runs of low energy are static footage which
+  * playback may skip
+  */
+class MotionTrack
+{
+public:
+  enum
+  {
+    LumaWidth = 64,     ///< frames are scaled down to this size before differencing
+    LumaHeight = 48
+  };
+
+  /** @param[in] cancel, progress See VideoPassOptions
+    * @return false Failure or cancel
+    */
+  bool build(const std::string &videoName, int threads = 0, const volatile bool *cancel = 0, volatile int *progress = 0);
+
+  /** @return false No valid cache (see loadVideoCache())
+    */
+  bool load(const std::string &cacheName, const std::string &videoName);
+
+  /** @return false Failure
+    */
+  bool save(const std::string &cacheName, const std::string &videoName) const;
+
+  /** @return name of the cache file kept next to the video
+    */
+  static std::string getCacheName(const std::string &videoName);
+
+  void clear();
+  void swap(MotionTrack &other);
+
+  bool empty() const
+  {
+    return _energy.empty();
+  }
+
+  int getFrames() const
+  {
+    return (int) _energy.size();
+  }
+
+  float getEnergy(int frame) const
+  {
+    return _energy[frame];
+  }
+
+  float getMaxEnergy() const;
+
+  /** @return energy telling static footage from motion, chosen by the noise
+    *         level of the quietest frames (10th and 25th percentiles of the
+    *         energy) and never above an absolute noise ceiling
+    */
+  float getStaticThreshold() const;
+
+  /** @return first frame from the given one on with energy above the threshold
+    * @return -1 The rest of the video is static
+    */
+  int findMotion(int frame, float threshold) const;
+
+private:
+  std::vector<float> _energy;
+};
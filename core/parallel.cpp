@@ -0,0 +1,92 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "parallel.h"
+
+namespace {
+
+  class Worker
+  {
+  public:
+    Worker(ParallelTask &task, int count, int &next, boost::mutex &mutex)
+    : _task(task),
+      _count(count),
+      _next(next),
+      _mutex(mutex)
+    {
+    }
+
+    void operator() ()
+    {
+      while (true)
+      {
+        int index;
+        {
+          boost::lock_guard<boost::mutex> lock(_mutex);
+          if (_next >= _count)
+            return;
+          index = _next++;
+        }
+        _task.run(index);
+      }
+    }
+
+  private:
+    ParallelTask &_task;
+    int _count;
+    int &_next;
+    boost::mutex &_mutex;
+  };
+}
+
+int getHardwareThreads()
+{
+  int threads = (int) boost::thread::hardware_concurrency();
+  return threads > 0 ? threads : 1;
+}
+
+void runParallel(ParallelTask &task, int count, int threads)
+{
+  if (threads <= 0)
+    threads = getHardwareThreads();
+  if (threads > count)
+    threads = count;
+
+  int next = 0;
+  boost::mutex mutex;
+  if (threads <= 1)
+  {
+    Worker(task, count, next, mutex)();
+    return;
+  }
+
+  boost::thread_group group;
+  for (int i = 0; i < threads; i++)
+    group.create_thread(Worker(task, count, next, mutex));
+  group.join_all();
+}
@@ -0,0 +1,51 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+/** A piece of work which can be split into independent numbered items
+  */
+class ParallelTask
+{
+public:
+  virtual ~ParallelTask()
+  {
+  }
+
+  /** Process item #index. Called concurrently from several threads,
+    * every item is processed exactly once
+    */
+  virtual void run(int index) = 0;
+};
+
+/** Runs task.run(i) for all i in [0, count) on a number of threads.
+  * Items are handed out in increasing order as threads become free.
+  * The function returns when all items have been processed.
+  * @param[in] threads Number of threads; zero or negative means one thread per CPU core
+  */
+void runParallel(ParallelTask &task, int count, int threads = 0);
+
+/** @return number of threads the machine can run simultaneously (at least 1)
+  */
+int getHardwareThreads();
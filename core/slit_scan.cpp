@@ -0,0 +1,202 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <videoreader.h>
+
+#include "slit_scan.h"
+#include "video_pass.h"
+#include "fileutil.h"
+#include "logger.h"
+
+namespace {
+  const char Magic[8] = {'V', 'M', 'S', 'L', 'I', 'T', 'S', 'C'};
+
+  enum
+  {
+    Version = 2,
+    BandWidth = 16
+  };
+}
+
+/** Collects the columns chunk by chunk and appends them to the strip in frame order
+  */
+class SlitScanPass: public VideoPass
+{
+public:
+  SlitScanPass(SlitScan &scan, int column)
+  : _scan(scan),
+    _column(column)
+  {
+  }
+
+  class Columns: public Chunk
+  {
+  public:
+    Columns(SlitScanPass &pass, int first, int last)
+    : _column(pass._column),
+      _height(pass._scan.getHeight())
+    {
+      _pixels.reserve((size_t) (last - first + 1) * _height * 3);
+    }
+
+    virtual bool process(int, const MinImg &image)
+    {
+      if (image.width <= _column || image.height != _height || image.channels != 3)
+        return false;
+      for (int y = 0; y < _height; y++)
+      {
+        const uint8_t *pixel = image.pScan0 + (size_t) y * image.stride + _column * 3;
+        _pixels.insert(_pixels.end(), pixel, pixel + 3);
+      }
+      return true;
+    }
+
+    std::vector<uint8_t> _pixels;
+
+  private:
+    int _column;
+    int _height;
+  };
+
+  virtual Chunk *createChunk(int first, int last)
+  {
+    return new Columns(*this, first, last);
+  }
+
+  virtual void merge(Chunk &chunk)
+  {
+    const std::vector<uint8_t> &pixels = static_cast<Columns &>(chunk)._pixels;
+    _scan._pixels.insert(_scan._pixels.end(), pixels.begin(), pixels.end());
+    _scan._frames += (int) (pixels.size() / (_scan._height * 3));
+  }
+
+private:
+  SlitScan &_scan;
+  int _column;              ///< of the center line within the converted band
+};
+
+SlitScan::SlitScan(int height)
+: _requestedHeight(std::max(height, 0)),
+  _frames(0),
+  _height(0)
+{
+}
+
+void SlitScan::clear()
+{
+  _frames = 0;
+  _height = 0;
+  std::vector<uint8_t>().swap(_pixels);
+}
+
+bool SlitScan::build(const std::string &videoName, int threads, const volatile bool *cancel, volatile int *frames)
+{
+  clear();
+  VideoInfo info;
+  if (!probeVideo(videoName.c_str(), info) || info.width <= 0 || info.height <= 0)
+  {
+    LOG_ERROR("Cannot read '" << videoName << "'");
+    return false;
+  }
+
+  // the same column as Frame::DrawCenterLine, scaled to the strip height. The scaler does not
+  // take one pixel wide regions, so the aligned band holding the center is converted. It fits
+  // into frames twice as wide as the band, narrower frames get it at the left edge
+  int center = info.width / 2;
+  VideoPassOptions options;
+  options.threads = threads;
+  options.region.x = std::max(0, std::min(center / BandWidth * BandWidth, info.width - BandWidth));
+  options.region.y = 0;
+  options.region.width = std::min((int) BandWidth, info.width - options.region.x);
+  options.region.height = info.height;
+  options.region.outputHeight = _requestedHeight > 0 ? _requestedHeight : info.height;
+  _height = options.region.outputHeight;
+  if (info.totalFrames > 0)
+    _pixels.reserve((size_t) info.totalFrames * _height * 3);
+
+  options.cancel = cancel;
+  options.progress = frames;
+  SlitScanPass pass(*this, center - options.region.x);
+  if (!runVideoPass(videoName, pass, options))
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+void SlitScan::swap(SlitScan &other)
+{
+  std::swap(_requestedHeight, other._requestedHeight);
+  std::swap(_frames, other._frames);
+  std::swap(_height, other._height);
+  _pixels.swap(other._pixels);
+}
+
+std::string SlitScan::getCacheName(const std::string &videoName)
+{
+  return videoName + ".slit";
+}
+
+bool SlitScan::load(const std::string &cacheName, const std::string &videoName)
+{
+  clear();
+  uint32_t columnSize;
+  std::vector<uint8_t> pixels;
+  if (!loadVideoCache(cacheName, videoName, Magic, Version, columnSize, pixels) || columnSize % 3 != 0
+      || (_requestedHeight > 0 && columnSize != (uint32_t) _requestedHeight * 3))
+    return false;
+  _height = (int) (columnSize / 3);
+  _frames = (int) (pixels.size() / columnSize);
+  _pixels.swap(pixels);
+  return true;
+}
+
+bool SlitScan::save(const std::string &cacheName, const std::string &videoName) const
+{
+  return _height > 0 && saveVideoCache(cacheName, videoName, Magic, Version, (uint32_t) _height * 3, _pixels);
+}
+
+bool SlitScan::saveImage(const std::string &imageName) const
+{
+  if (empty())
+    return false;
+  FILE *fp = fopen(imageName.c_str(), "wb");
+  if (!fp)
+    return false;
+  fprintf(fp, "P6\n%d %d\n255\n", _frames, _height);
+  std::vector<uint8_t> row((size_t) _frames * 3);
+  bool ok = true;
+  for (int y = 0; y < _height && ok; y++)
+  {
+    for (int t = 0; t < _frames; t++)
+      memcpy(&row[(size_t) t * 3], getColumn(t) + y * 3, 3);
+    ok = fwrite(&row[0], 1, row.size(), fp) == row.size();
+  }
+  return (fclose(fp) == 0) && ok;
+}
@@ -0,0 +1,104 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/** Time-slice image of a video: column t of the strip is the center column
+  * of frame t, the crossing line drawn by the marker, so that everything
+  * passing the line leaves its trace along the strip.
+  * Columns are stored one after another, each column is height RGB pixels
+  * from top to bottom
+  */
+class SlitScan
+{
+public:
+  /** @param[in] height Height of the strip made by build() and required
+    *            from the cache by load(); 0 - frame height, any cached one
+    */
+  explicit SlitScan(int height = 0);
+
+  /** Decodes the whole video (see runVideoPass()) and takes the center column
+    * of every frame, scaled to the strip height
+    * @param[in] threads Decoding threads, 0 - one per processor core
+    * @param[in] cancel If given, is polled during the pass, true stops it
+    * @param[out] frames If given, the number of frames done so far is kept there
+    * @return false Failure or cancel
+    */
+  bool build(const std::string &videoName, int threads = 0, const volatile bool *cancel = 0, volatile int *frames = 0);
+
+  /** Takes the cache only if its strip has the requested height
+    * @return false No valid cache (see loadVideoCache())
+    */
+  bool load(const std::string &cacheName, const std::string &videoName);
+
+  /** @return false Failure
+    */
+  bool save(const std::string &cacheName, const std::string &videoName) const;
+
+  /** Writes the strip as a binary PPM image
+    * @return false Failure
+    */
+  bool saveImage(const std::string &imageName) const;
+
+  /** @return name of the cache file kept next to the video
+    */
+  static std::string getCacheName(const std::string &videoName);
+
+  void clear();
+  void swap(SlitScan &other);
+
+  bool empty() const
+  {
+    return _frames == 0;
+  }
+
+  int getFrames() const
+  {
+    return _frames;
+  }
+
+  int getHeight() const
+  {
+    return _height;
+  }
+
+  /** @return height RGB pixels of the frame's column
+    */
+  const uint8_t *getColumn(int frame) const
+  {
+    return &_pixels[(size_t) frame * _height * 3];
+  }
+
+private:
+  int _requestedHeight;
+  int _frames;
+  int _height;
+  std::vector<uint8_t> _pixels;
+
+  friend class SlitScanPass;
+};
@@ -0,0 +1,53 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/** Measures wall clock time
+  */
+class Stopwatch
+{
+public:
+  Stopwatch()
+  {
+    restart();
+  }
+
+  void restart()
+  {
+    _start = boost::posix_time::microsec_clock::universal_time();
+  }
+
+  /** @return seconds elapsed since construction or the last restart()
+    */
+  double elapsed() const
+  {
+    return (boost::posix_time::microsec_clock::universal_time() - _start).total_microseconds() * 1e-6;
+  }
+
+private:
+  boost::posix_time::ptime _start;
+};
@@ -0,0 +1,831 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <sstream>
+#include <algorithm>
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <pugixml.hpp>
+
+#include "video_markup.h"
+
+namespace video_markup {
+
+namespace {
+  /** Names of all labels ever used. Names are kept in chunks which are never
+    * moved, so a name is read by its id without locking.
+    * It is shared by the whole process rather than kept by a markup: intervals
+    * move between markups (proposals, clips, detections) and label sets are
+    * compared, indexed and filtered by ids, which only works if an id means
+    * the same name everywhere
+    */
+  class LabelDictionary
+  {
+  public:
+    /** Ids in the order of their names and the position of every id in that order
+      */
+    struct Order
+    {
+      std::vector<int> ids;
+      std::vector<int> ranks;
+    };
+
+    enum
+    {
+      ChunkSize = 1024,
+      MaxChunks = 4096
+    };
+
+    LabelDictionary()
+    : _count(0)
+    {
+      memset(_chunks, 0, sizeof(_chunks));
+    }
+
+    int intern(const std::string &name)
+    {
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      std::map<std::string, int>::const_iterator it = _ids.find(name);
+      if (it != _ids.end())
+        return it->second;
+      if (_count == ChunkSize * MaxChunks)
+        return -1;
+      std::string *&chunk = _chunks[_count / ChunkSize];
+      if (!chunk)
+        chunk = new std::string[ChunkSize];
+      chunk[_count % ChunkSize] = name;
+      _ids[name] = _count;
+      return _count++;
+    }
+
+    int lookup(const std::string &name)
+    {
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      std::map<std::string, int>::const_iterator it = _ids.find(name);
+      return it != _ids.end() ? it->second : -1;
+    }
+
+    const std::string &getName(int id) const
+    {
+      return _chunks[id / ChunkSize][id % ChunkSize];
+    }
+
+    boost::mutex &getMutex()
+    {
+      return _mutex;
+    }
+
+    /** The order is rebuilt from the name map after new labels are added.
+      * The mutex must be locked while the order is used
+      */
+    const Order &getOrder()
+    {
+      if (_order.ids.size() != (size_t) _count)
+      {
+        _order.ids.clear();
+        _order.ranks.resize(_count);
+        for (std::map<std::string, int>::const_iterator it = _ids.begin(); it != _ids.end(); ++it)
+        {
+          _order.ranks[it->second] = (int) _order.ids.size();
+          _order.ids.push_back(it->second);
+        }
+      }
+      return _order;
+    }
+
+  private:
+    boost::mutex _mutex;
+    std::map<std::string, int> _ids;
+    std::string *_chunks[MaxChunks];
+    int _count;
+    Order _order;
+  };
+
+  // never destroyed on purpose: intervals may be destroyed by static destructors
+  LabelDictionary &labelDictionary()
+  {
+    static LabelDictionary *dictionary = new LabelDictionary;
+    return *dictionary;
+  }
+
+  // created before main(), so threads never race to create it
+  LabelDictionary &g_createdBeforeMain = labelDictionary();
+}
+
+LabelSet::LabelSet(const LabelSet &other)
+: _bits(other._bits),
+  _overflow(other._overflow ? new std::vector<int>(*other._overflow) : 0)
+{
+}
+
+LabelSet &LabelSet::operator= (const LabelSet &other)
+{
+  if (this != &other)
+  {
+    LabelSet copy(other);
+    swap(copy);
+  }
+  return *this;
+}
+
+int LabelSet::intern(const std::string &name)
+{
+  return labelDictionary().intern(name);
+}
+
+int LabelSet::lookup(const std::string &name)
+{
+  return labelDictionary().lookup(name);
+}
+
+const std::string &LabelSet::getName(int id)
+{
+  return labelDictionary().getName(id);
+}
+
+bool LabelSet::hasOverflow(int id) const
+{
+  return _overflow && std::binary_search(_overflow->begin(), _overflow->end(), id);
+}
+
+bool LabelSet::insert(int id)
+{
+  if (id < 0 || has(id))
+    return false;
+  if (id < InlineLabels)
+    _bits |= (uint64_t) 1 << id;
+  else
+  {
+    if (!_overflow)
+      _overflow = new std::vector<int>;
+    _overflow->insert(std::lower_bound(_overflow->begin(), _overflow->end(), id), id);
+  }
+  return true;
+}
+
+size_t LabelSet::erase(int id)
+{
+  if (!has(id))
+    return 0;
+  if (id < InlineLabels)
+    _bits &= ~((uint64_t) 1 << id);
+  else
+  {
+    _overflow->erase(std::lower_bound(_overflow->begin(), _overflow->end(), id));
+    if (_overflow->empty())
+    {
+      delete _overflow;
+      _overflow = 0;
+    }
+  }
+  return 1;
+}
+
+size_t LabelSet::size() const
+{
+  size_t size = _overflow ? _overflow->size() : 0;
+  for (uint64_t bits = _bits; bits; bits &= bits - 1)
+    size++;
+  return size;
+}
+
+void LabelSet::clear()
+{
+  _bits = 0;
+  delete _overflow;
+  _overflow = 0;
+}
+
+bool LabelSet::operator== (const LabelSet &other) const
+{
+  if (_bits != other._bits || !_overflow != !other._overflow)
+    return false;
+  return !_overflow || *_overflow == *other._overflow;
+}
+
+void LabelSet::swap(LabelSet &other)
+{
+  std::swap(_bits, other._bits);
+  std::swap(_overflow, other._overflow);
+}
+
+int LabelSet::nextId(int id) const
+{
+  LabelDictionary &dictionary = labelDictionary();
+  boost::lock_guard<boost::mutex> lock(dictionary.getMutex());
+  const LabelDictionary::Order &order = dictionary.getOrder();
+  int rank = id >= 0 ? order.ranks[id] : -1;
+
+  // walking the whole order costs the dictionary size per iteration over the set,
+  // looking through the set for the next rank costs the set size per step
+  size_t count = size();
+  if (count * count >= order.ids.size())
+  {
+    for (size_t r = rank + 1; r < order.ids.size(); r++)
+      if (has(order.ids[r]))
+        return order.ids[r];
+    return -1;
+  }
+
+  int bestId = -1;
+  int bestRank = (int) order.ids.size();
+  for (int i = 0; i < InlineLabels && (_bits >> i); i++)
+    if (((_bits >> i) & 1) && order.ranks[i] > rank && order.ranks[i] < bestRank)
+    {
+      bestRank = order.ranks[i];
+      bestId = i;
+    }
+  if (_overflow)
+    for (size_t i = 0; i < _overflow->size(); i++)
+    {
+      int other = (*_overflow)[i];
+      if (order.ranks[other] > rank && order.ranks[other] < bestRank)
+      {
+        bestRank = order.ranks[other];
+        bestId = other;
+      }
+    }
+  return bestId;
+}
+
+namespace {
+  void insertPosting(IntervalIndex::Postings &postings, int start)
+  {
+    // intervals are mostly added in order, when a markup is built or loaded
+    if (postings.empty() || postings.back() < start)
+      postings.push_back(start);
+    else
+      postings.insert(std::lower_bound(postings.begin(), postings.end(), start), start);
+  }
+
+  void removePosting(IntervalIndex::Postings &postings, int start)
+  {
+    IntervalIndex::Postings::iterator it = std::lower_bound(postings.begin(), postings.end(), start);
+    if (it != postings.end() && *it == start)
+      postings.erase(it);
+  }
+}
+
+void IntervalIndex::add(const Interval &interval)
+{
+  insertPosting(_types[interval.type], interval.start);
+  for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+  {
+    if (it.getId() >= (int) _labels.size())
+      _labels.resize(it.getId() + 1);
+    insertPosting(_labels[it.getId()], interval.start);
+  }
+}
+
+void IntervalIndex::remove(const Interval &interval)
+{
+  std::map<int, Postings>::iterator type = _types.find(interval.type);
+  if (type != _types.end())
+  {
+    removePosting(type->second, interval.start);
+    if (type->second.empty())
+      _types.erase(type);
+  }
+  for (Interval::Labels::const_iterator it = interval.labels.begin(); it != interval.labels.end(); ++it)
+    if (it.getId() < (int) _labels.size())
+      removePosting(_labels[it.getId()], interval.start);
+}
+
+void IntervalIndex::clear()
+{
+  _labels.clear();
+  _types.clear();
+}
+
+const IntervalIndex::Postings *IntervalIndex::findLabel(int labelId) const
+{
+  if (labelId < 0 || labelId >= (int) _labels.size() || _labels[labelId].empty())
+    return 0;
+  return &_labels[labelId];
+}
+
+const IntervalIndex::Postings *IntervalIndex::findType(int type) const
+{
+  std::map<int, Postings>::const_iterator it = _types.find(type);
+  return it != _types.end() ? &it->second : 0;
+}
+
+void Markup::clear()
+{
+  startFrame = endFrame = -1;
+  std::vector<Interval>::clear();
+  index.clear();
+  revision++;
+}
+
+namespace {
+  /** Writes XML straight to a file through a large buffer, producing the same
+    * text pugixml would save for the equivalent document
+    */
+  class XmlWriter
+  {
+  public:
+    XmlWriter(FILE *fp)
+    : _fp(fp),
+      _failed(false)
+    {
+      _buffer.reserve(BufferSize + 1024);
+    }
+
+    ~XmlWriter()
+    {
+      flush();
+    }
+
+    void write(const char *s)
+    {
+      _buffer += s;
+      check();
+    }
+
+    void write(const char *s, size_t length)
+    {
+      _buffer.append(s, length);
+      check();
+    }
+
+    void writeAttribute(const char *name, int value)
+    {
+      char buf[32];
+      sprintf(buf, "%d", value);
+      _buffer += ' ';
+      _buffer += name;
+      _buffer += "=\"";
+      _buffer += buf;
+      _buffer += '"';
+      check();
+    }
+
+    /** Character data escaped the way pugixml does it
+      */
+    void writeText(const std::string &text)
+    {
+      for (size_t i = 0; i < text.size(); i++)
+      {
+        unsigned char c = (unsigned char) text[i];
+        switch (c)
+        {
+        case '&': _buffer += "&amp;"; break;
+        case '<': _buffer += "&lt;"; break;
+        case '>': _buffer += "&gt;"; break;
+        default:
+          if (c < 32 && c != '\t' && c != '\r' && c != '\n')
+          {
+            char buf[8];
+            sprintf(buf, "&#%d%d;", c / 10, c % 10);
+            _buffer += buf;
+          }
+          else
+            _buffer += (char) c;
+        }
+      }
+      check();
+    }
+
+    bool flush()
+    {
+      if (!_buffer.empty() && fwrite(_buffer.data(), _buffer.size(), 1, _fp) != 1)
+        _failed = true;
+      _buffer.clear();
+      return !_failed;
+    }
+
+  private:
+    enum { BufferSize = 1 << 16 };
+
+    void check()
+    {
+      if (_buffer.size() >= BufferSize)
+        flush();
+    }
+
+    FILE *_fp;
+    std::string _buffer;
+    bool _failed;
+  };
+
+  void writeElement(XmlWriter &writer, const char *name, const std::string &text)
+  {
+    writer.write("\t\t<");
+    writer.write(name);
+    writer.write(">");
+    writer.writeText(text);
+    writer.write("</");
+    writer.write(name);
+    writer.write(">\n");
+  }
+}
+
+bool Markup::save(const char *fileName) const
+{
+  // no document tree is built, the markup is written as it goes
+  FILE *fp = fopen(fileName, "wb");
+  if (!fp)
+    return false;
+  bool ok;
+  {
+    XmlWriter writer(fp);
+    writer.write("<?xml version=\"1.0\"?>\n<video_markup");
+    if (startFrame > 0)
+      writer.writeAttribute("start_frame", startFrame);
+    if (endFrame > 0)
+      writer.writeAttribute("end_frame", endFrame);
+    writer.write(empty() ? " />\n" : ">\n");
+    for (const_iterator it = begin(); it != end(); ++it)
+    {
+      writer.write("\t<interval");
+      writer.writeAttribute("start", it->start);
+      writer.writeAttribute("end", it->end);
+      writer.writeAttribute("type", it->type);
+      writer.writeAttribute("y_border", it->y_border);
+      if (it->comment.empty() && it->labels.empty())
+      {
+        writer.write(" />\n");
+        continue;
+      }
+      writer.write(">\n");
+      if (!it->comment.empty())
+        writeElement(writer, "comment", it->comment);
+      for (Interval::Labels::const_iterator label = it->labels.begin(); label != it->labels.end(); ++label)
+        writeElement(writer, "label", *label);
+      writer.write("\t</interval>\n");
+    }
+    if (!empty())
+      writer.write("</video_markup>\n");
+    ok = writer.flush();
+  }
+  if (fclose(fp) != 0)
+    ok = false;
+  return ok;
+}
+
+bool Markup::load(const char *fileName, std::vector<std::string> *errors)
+{
+  clear();
+  startFrame = endFrame = -1;
+
+  std::vector<char> buffer;
+  FILE *fp = fopen(fileName, "rb");
+  if (!fp)
+    return false;
+  bool readError = fseek(fp, 0, SEEK_END) != 0;
+  long size = readError ? -1 : ftell(fp);
+  if (size > 0 && fseek(fp, 0, SEEK_SET) == 0)
+  {
+    buffer.resize(size);
+    readError = fread(&buffer[0], 1, size, fp) != (size_t) size;
+  }
+  fclose(fp);
+  if (readError || buffer.empty())
+    return false;
+
+  // the document refers to the strings of the buffer instead of copying them,
+  // only what the markup uses is parsed: no comments, processing instructions
+  // or declarations, attribute values (numbers) are left as they are
+  pugi::xml_document doc;
+  if (!doc.load_buffer_inplace(&buffer[0], buffer.size(), pugi::parse_cdata | pugi::parse_escapes | pugi::parse_eol))
+    return false;
+  pugi::xml_node root = doc.document_element();
+  if (strcmp(root.name(), "video_markup"))
+    return false;
+  startFrame = root.attribute("start_frame").as_int(-1);
+  endFrame = root.attribute("end_frame").as_int(-1);
+
+  // intervals are counted beforehand, so growing the vector does not copy them
+  std::vector<Interval> intervals;
+  size_t count = 0;
+  for (pugi::xml_node i = root.child("interval"); i; i = i.next_sibling("interval"))
+    count++;
+  intervals.reserve(count);
+
+  for (pugi::xml_node i = root.child("interval"); i; i = i.next_sibling("interval"))
+  {
+    intervals.push_back(Interval());
+    Interval &interval = intervals.back();
+    int *fields[] = {&interval.start, &interval.end, &interval.type, &interval.y_border};
+    const char *names[] = {"start", "end", "type", "y_border"};
+    int found = 0;
+    for (pugi::xml_attribute a = i.first_attribute(); a; a = a.next_attribute())
+      for (int f = 0; f < 4; f++)
+        if (!(found & (1 << f)) && !strcmp(a.name(), names[f]))
+        {
+          *fields[f] = a.as_int();
+          found |= 1 << f;
+          break;
+        }
+    if (found != 15)
+    {
+      if (errors)
+        errors->push_back(describe(intervals.size() - 1, 0) + "start, end, type or y_border is missing");
+      clear();
+      startFrame = endFrame = -1;
+      return false;
+    }
+
+    // only the first comment counts
+    bool comment = false;
+    for (pugi::xml_node c = i.first_child(); c; c = c.next_sibling())
+      if (!comment && !strcmp(c.name(), "comment"))
+      {
+        interval.comment = c.text().get();
+        comment = true;
+      }
+      else if (!strcmp(c.name(), "label"))
+        interval.labels.insert(c.text().get());
+  }
+  if (build(intervals, errors))
+    return true;
+
+  clear();
+  startFrame = endFrame = -1;
+  return false;
+}
+
+std::string Markup::describe(size_t index, const Interval *interval)
+{
+  std::ostringstream os;
+  os << "interval " << index;
+  if (interval)
+    os << " [" << interval->start << ", " << interval->end << "]";
+  os << ": ";
+  return os.str();
+}
+
+namespace {
+  struct StartLess
+  {
+    const std::vector<Interval> *intervals;
+
+    bool operator() (size_t a, size_t b) const
+    {
+      return (*intervals)[a].start < (*intervals)[b].start;
+    }
+  };
+
+  // moves the contents without copying strings and label sets
+  void moveInterval(Interval &from, Interval &to)
+  {
+    to.start = from.start;
+    to.end = from.end;
+    to.type = from.type;
+    to.y_border = from.y_border;
+    to.comment.swap(from.comment);
+    to.labels.swap(from.labels);
+  }
+}
+
+bool Markup::build(std::vector<Interval> &intervals, std::vector<std::string> *errors)
+{
+  std::vector<Interval>::clear();
+  index.clear();
+  revision++;
+
+  std::vector<size_t> order;
+  order.reserve(intervals.size());
+  bool valid = true;
+  for (size_t i = 0; i < intervals.size(); i++)
+  {
+    const Interval &interval = intervals[i];
+    const char *problem = 0;
+    if (interval.start >= interval.end)
+      problem = "start is not before end";
+    else if (interval.start < startFrame || (endFrame >= 0 && interval.end > endFrame))
+      problem = "outside of the start and end frames";
+    if (problem)
+    {
+      valid = false;
+      if (errors)
+        errors->push_back(describe(i, &interval) + problem);
+    }
+    else
+      order.push_back(i);
+  }
+
+  // one sweep over the sorted intervals finds every interval overlapping an earlier one
+  StartLess less = {&intervals};
+  std::stable_sort(order.begin(), order.end(), less);
+  size_t furthest = 0;    // of the intervals seen so far the one reaching furthest
+  for (size_t k = 0; k < order.size(); k++)
+  {
+    const Interval &interval = intervals[order[k]];
+    if (k > 0 && interval.start <= intervals[furthest].end)
+    {
+      valid = false;
+      if (errors)
+      {
+        std::ostringstream os;
+        os << "overlaps interval " << furthest << " [" << intervals[furthest].start << ", " << intervals[furthest].end << "]";
+        errors->push_back(describe(order[k], &interval) + os.str());
+      }
+    }
+    if (k == 0 || interval.end > intervals[furthest].end)
+      furthest = order[k];
+  }
+  if (!valid)
+    return false;
+
+  resize(order.size());
+  for (size_t k = 0; k < order.size(); k++)
+  {
+    Interval &interval = std::vector<Interval>::operator[](k);
+    moveInterval(intervals[order[k]], interval);
+    index.add(interval);
+  }
+  intervals.clear();
+  return true;
+}
+
+int Markup::upperBound(int frame) const
+{
+  // intervals are sorted and do not overlap, so a binary search over their starts is enough
+  int lo = 0, hi = (int) size();
+  while (lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    if ((*this)[mid].start <= frame)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+int Markup::find(int frame) const
+{
+  int i = upperBound(frame) - 1;
+  if (i >= 0 && (*this)[i].contains(frame))
+    return i;
+  return -1;
+}
+
+int Markup::findNextClosest(int frame) const
+{
+  // the interval after the one containing the frame is the first one starting after it as well
+  int i = upperBound(frame);
+  return i < (int) size() ? i : -1;
+}
+
+int Markup::findPrevClosest(int frame) const
+{
+  int i = upperBound(frame) - 1;
+  if (i >= 0 && (*this)[i].contains(frame))
+    i--;
+  return i;
+}
+
+int Markup::findClosest(int frame) const
+{
+  int iNext = upperBound(frame);
+  int iPrev = iNext - 1;
+  if (iPrev >= 0 && (*this)[iPrev].contains(frame))
+    return iPrev;
+  if (iNext >= (int) size())
+    return iPrev;
+  if (iPrev < 0)
+    return iNext;
+  if ((*this)[iNext].start - frame < frame - (*this)[iPrev].end)
+    return iNext;
+  else
+    return iPrev;
+}
+
+bool Markup::setStartFrame(int _startFrame)
+{
+  // we must check here that no existing interval will become an outsider
+  if (_startFrame < 0)
+  {
+    startFrame = -1;
+    return true;
+  }
+  else
+  {
+    for (Markup::const_iterator it = begin(); it != end(); ++it)
+      if (it->start < _startFrame)
+        return false;
+    startFrame = _startFrame;
+    return true;
+  }
+}
+
+bool Markup::setEndFrame(int _endFrame)
+{
+  // we must check here that no existing interval will become an outsider
+  if (_endFrame < 0)
+  {
+    endFrame = -1;
+    return true;
+  }
+  else
+  {
+    for (Markup::const_iterator it = begin(); it != end(); ++it)
+      if (it->end > _endFrame)
+        return false;
+    endFrame = _endFrame;
+    return true;
+  }
+}
+
+int Markup::push(const Interval &interval)
+{
+  if (interval.start >= interval.end)  // perverted interval
+    return -1;
+
+  // interval not within movie borders
+  if (interval.start < startFrame || (endFrame >= 0 && interval.end > endFrame))
+    return -1;
+
+  Markup::iterator it = begin() + upperBound(interval.start);
+  if (it != end() && interval.end >= it->start)   // overlapping intervals
+    return -1;
+
+  if (it != begin() && interval.start <= (it-1)->end)   // overlapping intervals
+    return -1;
+
+  it = insert(it, interval);
+  index.add(interval);
+  revision++;
+  return it - begin();
+}
+
+bool Markup::update(int id, const Interval &interval)
+{
+  if (id < 0 || id >= (int) size())
+    return false;
+  if (interval.start >= interval.end)
+    return false;
+  if (interval.start < startFrame || (endFrame >= 0 && interval.end > endFrame))
+    return false;
+  // the neighbours stay where they are, so the order is kept
+  if (id > 0 && interval.start <= at(id - 1).end)
+    return false;
+  if (id + 1 < (int) size() && interval.end >= at(id + 1).start)
+    return false;
+  Interval &old = std::vector<Interval>::at(id);
+  index.remove(old);
+  old = interval;
+  index.add(old);
+  revision++;
+  return true;
+}
+
+bool Markup::erase(int id)
+{
+  if (id >= 0 && id < (int) size())
+  {
+    index.remove(at(id));
+    std::vector<Interval>::erase(std::vector<Interval>::begin() + id);
+    revision++;
+    return true;
+  }
+  else
+    return false;
+}
+
+void Markup::push_back(const Interval &interval)
+{
+  std::vector<Interval>::push_back(interval);
+  index.add(interval);
+  revision++;
+}
+
+void Markup::pop_back()
+{
+  index.remove(back());
+  std::vector<Interval>::pop_back();
+  revision++;
+}
+
+} // namespace video_markup
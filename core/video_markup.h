@@ -0,0 +1,402 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cstring>
+#include <stdint.h>
+
+namespace video_markup {
+
+/** Set of interval labels. Label names are interned in a dictionary shared
+  * by all markups (so that sets of different markups are compared by ids)
+  * and a set only keeps label ids: the first 64 labels ever
+  * used are bits of a word, the rest go to a sorted vector allocated only
+  * when needed. Iteration goes in the order of names, as with a set of strings
+  */
+class LabelSet
+{
+public:
+  enum
+  {
+    InlineLabels = 64   ///< labels with smaller ids are kept in the bit word
+  };
+
+  class const_iterator
+  {
+  public:
+    const_iterator()
+    : _set(0),
+      _id(-1)
+    {
+    }
+
+    const std::string &operator* () const
+    {
+      return getName(_id);
+    }
+
+    const std::string *operator-> () const
+    {
+      return &getName(_id);
+    }
+
+    const_iterator &operator++ ()
+    {
+      _id = _set->nextId(_id);
+      return *this;
+    }
+
+    const_iterator operator++ (int)
+    {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator== (const const_iterator &other) const
+    {
+      return _id == other._id;
+    }
+
+    bool operator!= (const const_iterator &other) const
+    {
+      return _id != other._id;
+    }
+
+    int getId() const
+    {
+      return _id;
+    }
+
+  private:
+    const_iterator(const LabelSet *set, int id)
+    : _set(set),
+      _id(id)
+    {
+    }
+
+    const LabelSet *_set;
+    int _id;
+
+    friend class LabelSet;
+  };
+
+  typedef const_iterator iterator;
+
+  LabelSet()
+  : _bits(0),
+    _overflow(0)
+  {
+  }
+
+  LabelSet(const LabelSet &other);
+
+  ~LabelSet()
+  {
+    delete _overflow;
+  }
+
+  LabelSet &operator= (const LabelSet &other);
+
+  /** @return id of the label, the label is added to the dictionary if it is new
+    * @return -1 The dictionary is full
+    */
+  static int intern(const std::string &name);
+
+  /** @return id of the label
+    * @return -1 No label of this name has ever been used
+    */
+  static int lookup(const std::string &name);
+
+  static const std::string &getName(int id);
+
+  /** Label filters should look ids up once and test them with this
+    */
+  bool has(int id) const
+  {
+    if (id < 0)
+      return false;
+    if (id < InlineLabels)
+      return ((_bits >> id) & 1) != 0;
+    return hasOverflow(id);
+  }
+
+  /** @return false The label was already there
+    */
+  bool insert(const std::string &name)
+  {
+    return insert(intern(name));
+  }
+
+  bool insert(int id);
+
+  /** @return number of erased labels (0 or 1)
+    */
+  size_t erase(const std::string &name)
+  {
+    return erase(lookup(name));
+  }
+
+  size_t erase(int id);
+
+  void erase(const_iterator it)
+  {
+    erase(it._id);
+  }
+
+  size_t count(const std::string &name) const
+  {
+    return has(lookup(name)) ? 1 : 0;
+  }
+
+  const_iterator find(const std::string &name) const
+  {
+    int id = lookup(name);
+    return has(id) ? const_iterator(this, id) : end();
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(this, nextId(-1));
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(this, -1);
+  }
+
+  size_t size() const;
+
+  bool empty() const
+  {
+    return _bits == 0 && !_overflow;
+  }
+
+  void clear();
+
+  bool operator== (const LabelSet &other) const;
+
+  bool operator!= (const LabelSet &other) const
+  {
+    return !(*this == other);
+  }
+
+  void swap(LabelSet &other);
+
+private:
+  bool hasOverflow(int id) const;
+
+  /** @return id of the label whose name follows the name of the given one in the set
+    *         (the first one if id is negative)
+    * @return -1 There is no such label
+    */
+  int nextId(int id) const;
+
+  uint64_t _bits;
+  std::vector<int> *_overflow;    ///< sorted ids not less than InlineLabels, null if there are none
+};
+
+struct Interval
+{
+  Interval()
+  : start(-1),
+    end(-1),
+    type(-1),
+    y_border(-1)
+  { }
+
+  int start;
+  int end;
+  int type;
+
+  int y_border;
+  std::string comment;
+
+  typedef LabelSet Labels;
+  Labels labels;
+
+  bool hasLabel(std::string const& label) const { return labels.count(label) != 0; }
+
+  bool contains(int frame) const
+    { return frame >= start && frame <= end; }
+
+};
+
+/** Posting lists of a markup: start frames of the intervals having each label
+  * and each type, sorted. Intervals are referred to by their starts rather
+  * than by ids since starts do not change when other intervals are added
+  * or erased, so the lists are updated in place on every edit
+  */
+class IntervalIndex
+{
+public:
+  typedef std::vector<int> Postings;
+
+  void add(const Interval &interval);
+  void remove(const Interval &interval);
+  void clear();
+
+  /** @return starts of the intervals having the label
+    * @return NULL No interval has the label
+    */
+  const Postings *findLabel(int labelId) const;
+
+  /** @return starts of the intervals of the type
+    * @return NULL No interval is of the type
+    */
+  const Postings *findType(int type) const;
+
+private:
+  std::vector<Postings> _labels;      ///< by label id
+  std::map<int, Postings> _types;
+};
+
+class Markup: private std::vector<Interval>
+{
+private:
+  /* If we need to process only a part of the movie, we may use startFrame and endFrame.
+     They mark the first and the last frames of the part to be processed respectively.
+     If negative, they are ignored (which is equal to startFrame = 0, endFrame = {index of
+     the last frame}
+  */
+  int         startFrame;     ///< first frame of the video chunk to be processed or <0 of not specified
+  int         endFrame;       ///< last  frame of the video chunk to be processed or <0 if not specified
+
+  IntervalIndex index;
+  unsigned    revision;       ///< changes on every change of the intervals
+
+  /** @return index of the first interval starting after the frame (size() if there is none)
+    */
+  int upperBound(int frame) const;
+
+  /** @return "interval N [start, end]: " for error messages
+    */
+  static std::string describe(size_t index, const Interval *interval);
+
+public:
+  using std::vector<Interval>::size;
+  using std::vector<Interval>::size_type;
+  using std::vector<Interval>::empty;
+
+  Markup()
+  : startFrame(-1),
+    endFrame(-1),
+    revision(0)
+  {
+  }
+
+  // intervals are only changed through the markup, so that the index follows them
+  const Interval &operator[] (size_type id) const
+  {
+    return std::vector<Interval>::operator[](id);
+  }
+
+  const Interval &at(size_type id) const
+  {
+    return std::vector<Interval>::at(id);
+  }
+
+  /** Appends the interval without any checks, it must start after the last one
+    */
+  void push_back(const Interval &interval);
+
+  void pop_back();
+
+  void clear();
+
+  bool save(const char *fileName) const;
+
+  /** @param[out] errors If given, gets a description of every invalid or overlapping interval
+    */
+  bool load(const char *fileName, std::vector<std::string> *errors = 0);
+
+  /** Replaces all intervals by the given ones. They are sorted once and
+    * checked for overlaps in a single sweep, unlike a push() per interval.
+    * The contents of the vector are moved into the markup
+    * @param[out] errors If given, gets a description of every invalid or overlapping interval
+    *                    (intervals are referred to by their positions in the vector)
+    * @return false Some intervals are invalid, the markup is left empty
+    */
+  bool build(std::vector<Interval> &intervals, std::vector<std::string> *errors = 0);
+
+  int push(const Interval &interval);
+
+  /** Replaces the interval keeping its id. Borders may change as long as
+    * the interval does not overlap its neighbours
+    * @return false The new interval is invalid, the markup is not changed
+    */
+  bool update(int id, const Interval &interval);
+
+  int find(int frame) const;
+
+  int findNextClosest(int frame) const;
+  int findPrevClosest(int frame) const;
+  int findClosest(int frame) const;
+
+  bool isIntervalFrame(int frame) const
+  {
+    return find(frame) >= 0;
+  }
+
+
+  bool erase(int id);
+
+  const IntervalIndex &getIndex() const
+  {
+    return index;
+  }
+
+  /** Cached results of queries are valid as long as the revision stays the same
+    */
+  unsigned getRevision() const
+  {
+    return revision;
+  }
+
+  int getStartFrame() const
+  {
+    return startFrame;
+  }
+
+  int getEndFrame() const
+  {
+    return endFrame;
+  }
+
+  /** @return true Success
+    * @return false Failure
+    */
+  bool setStartFrame(int _startFrame);
+
+  /** @return true Success
+    * @return false Failure
+    */
+  bool setEndFrame(int _endFrame);
+};
+
+} // namespace video_markup
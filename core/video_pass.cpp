@@ -0,0 +1,281 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <climits>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "video_pass.h"
+#include "parallel.h"
+#include "stopwatch.h"
+#include "logger.h"
+
+namespace {
+  struct ChunkRange
+  {
+    int first;
+    int last;
+    bool toEnd;           ///< the video may end before the last frame
+  };
+
+  class PassTask: public ParallelTask
+  {
+  public:
+    PassTask(const std::string &videoName, VideoPass &pass, const VideoPassOptions &options,
+             const std::vector<ChunkRange> &chunks, VideoReader *reader)
+    : _videoName(videoName),
+      _pass(pass),
+      _options(options),
+      _chunks(chunks),
+      _nextMerge(0),
+      _frames(0),
+      _failed(false)
+    {
+      _freeReaders.push_back(reader);
+    }
+
+    ~PassTask()
+    {
+      for (size_t i = 0; i < _readers.size(); i++)
+        deleteVideoReader(_readers[i]);
+      for (std::map<int, VideoPass::Chunk *>::iterator it = _done.begin(); it != _done.end(); ++it)
+        delete it->second;
+    }
+
+    virtual void run(int index)
+    {
+      if (isFailed())
+        return;
+      VideoReader *reader = acquireReader();
+      if (!reader)
+      {
+        finish(index, 0, 0);
+        return;
+      }
+
+      const ChunkRange &range = _chunks[index];
+      VideoPass::Chunk *chunk = _pass.createChunk(range.first, range.last);
+      bool ok = reader->seek(range.first);
+      if (!ok)
+        LOG_ERROR("Cannot seek to frame " << range.first << " of '" << _videoName << "'");
+      int frame = range.first;
+      for (; ok && frame <= range.last && !isFailed(); frame++)
+      {
+        FrameRef image;
+        if (_options.region.width > 0)
+        {
+          if (reader->skipNextFrame())
+            image = reader->convertCurrentFrame(_options.region);
+        }
+        else
+          image = reader->readNextFrameRef();
+        if (image.isNull())
+        {
+          // frame counts in headers are not always right, the end of the video ends the pass
+          if (!range.toEnd)
+          {
+            LOG_ERROR("Cannot decode frame " << frame << " of '" << _videoName << "'");
+            ok = false;
+          }
+          break;
+        }
+        ok = chunk->process(frame, *image.get());
+        if (_options.progress)
+        {
+          boost::lock_guard<boost::mutex> lock(_mutex);
+          ++*_options.progress;
+        }
+        if (_options.cancel && *_options.cancel)
+          ok = false;
+      }
+      if (isFailed())
+        ok = false;
+
+      releaseReader(reader);
+      finish(index, ok ? chunk : 0, frame - range.first);
+      if (!ok)
+        delete chunk;
+    }
+
+    bool isFailed()
+    {
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      return _failed;
+    }
+
+    int getFrames() const
+    {
+      return _frames;
+    }
+
+    int getReaders() const
+    {
+      return (int) _readers.size() + 1;
+    }
+
+  private:
+    VideoReader *acquireReader()
+    {
+      {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        if (!_freeReaders.empty())
+        {
+          VideoReader *reader = _freeReaders.back();
+          _freeReaders.pop_back();
+          return reader;
+        }
+      }
+      // opening takes a while, others go on meanwhile
+      VideoReader *reader = createVideoReader(VideoReader::FFMpegReader);
+      if (reader && !reader->open(_videoName.c_str()))
+      {
+        LOG_ERROR("Cannot open '" << _videoName << "'");
+        deleteVideoReader(reader);
+        return 0;
+      }
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      _readers.push_back(reader);
+      return reader;
+    }
+
+    void releaseReader(VideoReader *reader)
+    {
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      _freeReaders.push_back(reader);
+    }
+
+    /** Merges the chunks which are next in order. A failed chunk (null)
+      * stops merging for good
+      */
+    void finish(int index, VideoPass::Chunk *chunk, int frames)
+    {
+      boost::lock_guard<boost::mutex> lock(_mutex);
+      _frames += frames;
+      if (!chunk)
+      {
+        _failed = true;
+        return;
+      }
+      _done[index] = chunk;
+      std::map<int, VideoPass::Chunk *>::iterator it;
+      while (!_failed && (it = _done.find(_nextMerge)) != _done.end())
+      {
+        _pass.merge(*it->second);
+        delete it->second;
+        _done.erase(it);
+        _nextMerge++;
+      }
+    }
+
+    const std::string &_videoName;
+    VideoPass &_pass;
+    const VideoPassOptions &_options;
+    const std::vector<ChunkRange> &_chunks;
+
+    boost::mutex _mutex;
+    std::vector<VideoReader *> _readers;        ///< opened by the task, the first reader belongs to the caller
+    std::vector<VideoReader *> _freeReaders;
+    std::map<int, VideoPass::Chunk *> _done;    ///< processed chunks waiting for their turn to be merged
+    int _nextMerge;
+    int _frames;
+    bool _failed;
+  };
+
+  /** Splits [first, last] at key frames into chunks of at least chunkFrames frames
+    */
+  void planChunks(const std::vector<int> &keyFrames, int first, int last, bool toEnd, int chunkFrames,
+                  std::vector<ChunkRange> &chunks)
+  {
+    ChunkRange range;
+    range.first = first;
+    range.toEnd = false;
+    std::vector<int>::const_iterator it = std::upper_bound(keyFrames.begin(), keyFrames.end(), first);
+    for (; it != keyFrames.end() && *it <= last; ++it)
+      if (*it - range.first >= chunkFrames)
+      {
+        range.last = *it - 1;
+        chunks.push_back(range);
+        range.first = *it;
+      }
+    range.last = last;
+    range.toEnd = toEnd;
+    chunks.push_back(range);
+  }
+}
+
+bool runVideoPass(const std::string &videoName, VideoPass &pass, const VideoPassOptions &options,
+                  VideoPassStatistics *stats)
+{
+  Stopwatch stopwatch;
+  int threads = options.threads > 0 ? options.threads : getHardwareThreads();
+
+  // this reader plans the chunks and then decodes them along with the others
+  VideoReader *reader = createVideoReader(VideoReader::FFMpegReader);
+  if (!reader || !reader->open(videoName.c_str()))
+  {
+    LOG_ERROR("Cannot open '" << videoName << "'");
+    deleteVideoReader(reader);
+    return false;
+  }
+  int totalFrames = reader->getTotalFrames();
+  int last = options.lastFrame;
+  if (last < 0 || (totalFrames > 0 && last >= totalFrames))
+    last = totalFrames > 0 ? totalFrames - 1 : INT_MAX;
+  bool toEnd = options.lastFrame < 0 || last == INT_MAX;
+
+  std::vector<ChunkRange> chunks;
+  std::vector<int> keyFrames;
+  if (options.firstFrame > last)
+  {
+    LOG_WARNING("No frames to process in '" << videoName << "'");
+  }
+  else if (last == INT_MAX || !reader->getKeyFrames(keyFrames))
+    planChunks(std::vector<int>(), options.firstFrame, last, toEnd, 0, chunks);
+  else
+  {
+    int chunkFrames = (last - options.firstFrame + 1) / std::max(threads * options.chunksPerThread, 1);
+    planChunks(keyFrames, options.firstFrame, last, toEnd, std::max(chunkFrames, options.minChunkFrames), chunks);
+  }
+
+  bool ok;
+  VideoPassStatistics result;
+  {
+    PassTask task(videoName, pass, options, chunks, reader);
+    if (!chunks.empty())
+      runParallel(task, (int) chunks.size(), std::min(threads, (int) chunks.size()));
+    ok = !task.isFailed();
+    result.frames = task.getFrames();
+    result.threads = task.getReaders();
+  }
+  deleteVideoReader(reader);
+  result.chunks = (int) chunks.size();
+  result.time = stopwatch.elapsed();
+  if (stats)
+    *stats = result;
+  return ok;
+}
@@ -0,0 +1,108 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+
+#include <videoreader.h>
+
+/** A whole-video computation split into chunks of frames which are decoded
+  * and processed independently. Chunks start at key frames, so that each
+  * is decoded by its own reader without touching the frames before it;
+  * results of the chunks are merged in frame order
+  */
+class VideoPass
+{
+public:
+  /** Work on the frames of one chunk
+    */
+  class Chunk
+  {
+  public:
+    virtual ~Chunk()
+    {
+    }
+
+    /** Called for every frame of the chunk in order, from one thread
+      * @return false Stop the whole pass
+      */
+    virtual bool process(int frame, const MinImg &image) = 0;
+  };
+
+  virtual ~VideoPass()
+  {
+  }
+
+  /** Makes the work for frames [first, last]. Called from the decoder threads
+    */
+  virtual Chunk *createChunk(int first, int last) = 0;
+
+  /** Takes the results of a processed chunk. Chunks come in frame order and
+    * one at a time, though not always from the same thread. The chunk is
+    * deleted afterwards
+    */
+  virtual void merge(Chunk &chunk) = 0;
+};
+
+struct VideoPassOptions
+{
+  VideoPassOptions()
+  : threads(0),
+    firstFrame(0),
+    lastFrame(-1),
+    minChunkFrames(250),
+    chunksPerThread(4),
+    cancel(0),
+    progress(0)
+  {
+  }
+
+  int threads;            ///< decoding threads (and readers), 0 - one per processor core
+  int firstFrame;
+  int lastFrame;          ///< -1 - up to the end of the video
+  FrameRegion region;     ///< part of the frame (optionally scaled) given to the chunks, empty - whole frames
+  int minChunkFrames;     ///< a chunk spans as many key frame intervals as needed to get this many frames
+  int chunksPerThread;    ///< more chunks than threads even out the load when chunks take different time
+  const volatile bool *cancel;    ///< if given, is polled after every frame; true stops (and fails) the pass
+  volatile int *progress;         ///< if given, counts the frames processed so far
+};
+
+struct VideoPassStatistics
+{
+  int frames;             ///< frames processed
+  int chunks;
+  int threads;
+  double time;            ///< seconds
+};
+
+/** Runs the pass over the video. Every decoding thread opens the video with
+  * a reader of its own. A video without an index of key frames is processed
+  * as a single chunk
+  * @param[out] stats If given, gets the statistics of the run
+  * @return false Failure (the video cannot be opened or decoded, or a chunk has stopped the pass);
+  *               chunks after the failed one are not merged
+  */
+bool runVideoPass(const std::string &videoName, VideoPass &pass, const VideoPassOptions &options = VideoPassOptions(),
+                  VideoPassStatistics *stats = 0);
@@ -26,16 +26,24 @@ THE SOFTWARE.
 #include <cmath>
 #include <iostream>
 #include <sstream>
+#include <memory>
 #include <wx/numdlg.h>
+#include <wx/choicdlg.h>
 #include <wx/config.h>
 #include <wx/stdpaths.h>
 #include <wx/clipbrd.h>
 #include <wx/filename.h>
 
 #include "video_markup.h"
+#include "dump_plan.h"
+#include "activity.h"
+#include "image_kernels.h"
 #include "frame.h"
 #include "canvas_holder.h"
 #include "interval_panel.h"
+#include "slit_scan_panel.h"
+#include "motion_panel.h"
+#include "wximage_frame_writer.h"
 #include "frame_id.h"
 
 const int IntervalDumpMargin = 20;
@@ -50,6 +58,12 @@ const char *seLittleMoveSize    = "littleMoveSize";
 const char *seFastPlayFps       = "fastPlayFps";
 const char *seSlowPlayFps       = "slowPlayFps";
 const char *seAutoLoadMarkup    = "autoLoadMarkup";
+const char *seShowSlitScan      = "showSlitScan";
+const char *seSkipThreshold     = "skipThreshold";
+const char *seDumpFormat        = "dumpFormat";
+const char *seDumpQuality       = "dumpQuality";
+const char *seDumpCrop          = "dumpCrop";
+const char *seDumpSize          = "dumpSize";
 
 wxTextCtrl *Frame::logPanel = 0;
 
@@ -57,9 +71,10 @@ using video_markup::Interval;
 
 void Frame::OnIntervalLabel(wxCommandEvent &event)
 {
-  Interval *interval = markedVideo.getCurrentInterval();
-  if (!interval)
+  const Interval *current = markedVideo.getCurrentInterval();
+  if (!current)
     return;
+  Interval interval = *current;
   std::string label;
   switch (event.GetId())
   {
@@ -71,12 +86,13 @@ void Frame::OnIntervalLabel(wxCommandEvent &event)
     return;
   }
 
-  std::set<std::string>::iterator it = interval->labels.find(label);
-  if (it != interval->labels.end())
-    interval->labels.erase(it);
+  video_markup::Interval::Labels::iterator it = interval.labels.find(label);
+  if (it != interval.labels.end())
+    interval.labels.erase(it);
   else
-    interval->labels.insert(label);
-  markupChanged = true;
+    interval.labels.insert(label);
+  if (markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+    markupChanged = true;
   Synchronize(true);
 }
 
@@ -169,6 +185,16 @@ void Frame::setPlaybackState(Frame::PlaybackState newState)
     m_playbackState = playbackSlow;
     SetStatusText(wxT("Slow"), StatusPlayback);
   }
+  else if (newState == playbackSkip)
+  {
+    // fast playback through the motion, static runs are jumped over
+    if (m_playbackState != playbackStopped)
+      m_playbackTimer.Stop();
+    m_currentPlaybackStep = m_fastPlaybackStep;
+    m_playbackTimer.Start(m_fastPlaybackPeriod);
+    m_playbackState = playbackSkip;
+    SetStatusText(wxT("Skip"), StatusPlayback);
+  }
   else
   {
     LOG_ERROR("Internal error: wrong playback state");
@@ -213,6 +239,16 @@ void Frame::OnSetSlowPlayFps(wxCommandEvent &)
 void Frame::OnPlaybackTimer(wxTimerEvent &)
 {
   int nextFrame = markedVideo.getCurrentFrameNumber() + m_currentPlaybackStep;
+  const MotionTrack &track = motionPanel->GetTrack();
+  if (m_playbackState == playbackSkip && nextFrame < track.getFrames())
+  {
+    float threshold = motionPanel->GetThreshold();
+    int motion = track.findMotion(nextFrame, threshold);
+    if (motion < 0)
+      nextFrame = track.getFrames() - 1;
+    else if (motion - nextFrame >= MinSkipFrames)
+      nextFrame = motion - SkipLeadIn;
+  }
   if (markedVideo.getTotalFrames() >= 0 && nextFrame >= markedVideo.getTotalFrames()
       || !markedVideo.goToFrame( nextFrame ))
   {
@@ -221,6 +257,12 @@ void Frame::OnPlaybackTimer(wxTimerEvent &)
   Synchronize();
 }
 
+void Frame::OnJournalTimer(wxTimerEvent &)
+{
+  if (markedVideo.pollJournal())
+    LOG_INFO("Markup journal compacted into " << markedVideo.getMarkupName());
+}
+
 void Frame::OnFastPlay(wxCommandEvent &)
 {
   if (m_playbackState == playbackFast)
@@ -229,6 +271,36 @@ void Frame::OnFastPlay(wxCommandEvent &)
     setPlaybackState(playbackFast);
 }
 
+void Frame::OnSkipPlay(wxCommandEvent &)
+{
+  if (m_playbackState == playbackSkip)
+    setPlaybackState(playbackStopped);
+  else if (motionPanel->GetTrack().empty())
+    LOG_WARNING("The motion track of the video is not ready yet");
+  else
+    setPlaybackState(playbackSkip);
+}
+
+void Frame::OnSetSkipThreshold(wxCommandEvent &)
+{
+  double threshold;
+  wxConfigBase::Get()->Read(seSkipThreshold, &threshold, 0.0);
+  wxString str;
+  str.Printf(wxT("%.2lf"), threshold);
+  wxTextEntryDialog dialog(this, wxT("Motion energy up to which frames are skipped (0 - chosen by the noise level)"), wxT("Skip threshold:"), str);
+  if (dialog.ShowModal() == wxID_OK)
+  {
+    str = dialog.GetValue();
+    if (!str.ToDouble(&threshold) || threshold < 0)
+    {
+      wxMessageBox(wxT("Wrong format!"));
+      return;
+    }
+    wxConfigBase::Get()->Write(seSkipThreshold, threshold);
+    motionPanel->SetThreshold(threshold);
+  }
+}
+
 void Frame::OnSlowPlay(wxCommandEvent &)
 {
   if (m_playbackState == playbackSlow)
@@ -242,11 +314,14 @@ void Frame::OnCalcChecksum(wxCommandEvent &)
   const MinImg *frame = markedVideo.getCurrentFrame();
   if (!frame)
     return;
+  // the sum is kept 32 bit as it always was; the fingerprint is the one of the fingerprint command
   unsigned sum = 0;
+  size_t rowSize = (size_t) frame->width * frame->channels * frame->channelDepth;
   for (int i = 0; i < frame->height; i++)
-    for (int j = 0; j < frame->width * frame->channels * frame->channelDepth; j++)
-      sum += frame->pScan0[ i * frame->stride + j ];
-  LOG_INFO("Checksum of frame #" << markedVideo.getCurrentFrameNumber() << " is " << sum);
+    sum += (unsigned) sumBytes(frame->pScan0 + (size_t) i * frame->stride, rowSize);
+  char fingerprint[32];
+  sprintf(fingerprint, "%016llx", (unsigned long long) hashImage(*frame));
+  LOG_INFO("Checksum of frame #" << markedVideo.getCurrentFrameNumber() << " is " << sum << ", fingerprint " << fingerprint);
 }
 
 void Frame::OnDumpIntervalTo(wxCommandEvent &)
@@ -270,17 +345,62 @@ void Frame::OnDumpInterval(wxCommandEvent &)
     OnDumpIntervalTo(dummy);
     return;
   }
-  const Interval *interval = markedVideo.getCurrentInterval();
-  if (!interval)
+  int id = markedVideo.getCurrentIntervalId();
+  if (id < 0)
   {
     LOG_ERROR("No current interval!");
     return;
   }
+  DumpIntervals(std::vector<int>(1, id), dumpDir);
+}
 
-  wxString videoName = wxFileName::FileName(markedVideo.getVideoName()).GetName();
+void Frame::OnDumpAllIntervals(wxCommandEvent &)
+{
+  std::string dumpDir = wxConfigBase::Get()->Read(seDefaultDumpDir).c_str();
+  if (dumpDir == "")
+  {
+    wxCommandEvent dummy;
+    OnDumpAllIntervalsTo(dummy);
+    return;
+  }
+  std::vector<int> ids;
+  for (int i = 0; i < markedVideo.getTotalIntervals(); ++i)
+    ids.push_back(i);
+  DumpIntervals(ids, dumpDir);
+}
+
+bool Frame::DumpIntervals(const std::vector<int> &ids, const std::string &dumpDir)
+{
+  DumpOptions options;
+  options.directory = dumpDir;
+  options.prefix = wxFileName::FileName(markedVideo.getVideoName()).GetName().To8BitData();
+  options.margin = IntervalDumpMargin;
+  wxString crop = wxConfigBase::Get()->Read(seDumpCrop, wxEmptyString);
+  if (!crop.IsEmpty() && !options.parseCrop(crop.c_str()))
+    LOG_ERROR("Invalid dump crop '" << crop.c_str() << "' is ignored");
+  wxString size = wxConfigBase::Get()->Read(seDumpSize, wxEmptyString);
+  if (!size.IsEmpty() && !options.parseOutputSize(size.c_str()))
+    LOG_ERROR("Invalid dump size '" << size.c_str() << "' is ignored");
+
+  DumpPlan plan;
+  plan.build(markedVideo.getMarkup(), ids, options.margin, markedVideo.getTotalFrames());
+  LOG_INFO("Dumping " << plan.getItems().size() << " interval(s): " << plan.getFrameCount()
+           << " frame(s) in " << plan.getRanges().size() << " range(s)");
+
+  std::string format = wxConfigBase::Get()->Read(seDumpFormat, wxT("jpg")).c_str();
+  std::auto_ptr<FrameWriter> writer;
+  if (format != "vmp")
+  {
+    writer.reset(createFrameWriter(format, wxConfigBase::Get()->Read(seDumpQuality, 90)));
+    // formats the core library has no writer for (e.g. png) are saved by wxImage
+    if (!writer.get())
+      writer.reset(new WxImageFrameWriter(format));
+  }
 
-  if (markedVideo.dump(interval->start - IntervalDumpMargin, interval->end + IntervalDumpMargin,
-    (dumpDir + "/" + videoName.To8BitData() + "_%08d.jpg").c_str()))
+  // frames are decoded in one pass without rendering them
+  wxBusyCursor busy;
+  bool ok = writer.get() ? markedVideo.dump(plan, options, *writer) : markedVideo.dumpPack(plan, options);
+  if (ok)
   {
     LOG_INFO("Dumped successfully to " << dumpDir);
   }
@@ -288,28 +408,49 @@ void Frame::OnDumpInterval(wxCommandEvent &)
   {
     LOG_ERROR("Dump failed");
   }
+  Synchronize();
+  return ok;
 }
 
-void Frame::OnDumpAllIntervals(wxCommandEvent &)
+void Frame::OnExportClips(wxCommandEvent &event)
 {
-  std::string dumpDir = wxConfigBase::Get()->Read(seDefaultDumpDir).c_str();
-  if (dumpDir == "")
+  std::vector<int> ids;
+  if (event.GetId() == ID_EXPORT_INTERVAL_CLIP)
   {
-    wxCommandEvent dummy;
-    OnDumpAllIntervalsTo(dummy);
+    int id = markedVideo.getCurrentIntervalId();
+    if (id < 0)
+    {
+      LOG_ERROR("No current interval!");
+      return;
+    }
+    ids.push_back(id);
+  }
+  else
+    for (int i = 0; i < markedVideo.getTotalIntervals(); ++i)
+      ids.push_back(i);
+
+  wxDirDialog dialog(this, wxT("Choose directory for clips"), wxConfigBase::Get()->Read(seDefaultDumpDir));
+  if (dialog.ShowModal() != wxID_OK)
     return;
+  wxConfigBase::Get()->Write(seDefaultDumpDir, dialog.GetPath());
+
+  DumpOptions options;
+  options.directory = dialog.GetPath().c_str();
+  options.prefix = wxFileName::FileName(markedVideo.getVideoName()).GetName().To8BitData();
+  options.margin = IntervalDumpMargin;
+  DumpPlan plan;
+  plan.build(markedVideo.getMarkup(), ids, options.margin, markedVideo.getTotalFrames());
+
+  // packets are copied, nothing is decoded, so this is fast
+  wxBusyCursor busy;
+  if (markedVideo.exportClips(plan, options))
+  {
+    LOG_INFO("Clips exported successfully to " << options.directory);
   }
-  int currentFrame = markedVideo.getCurrentFrameNumber();
-  for (int i = 0; i < markedVideo.getTotalIntervals(); ++i)
+  else
   {
-    markedVideo.gotoInterval(i);
-    Synchronize();
-    LOG_INFO("Dumping interval " << i);
-    wxCommandEvent dummy;
-    OnDumpInterval(dummy);
+    LOG_ERROR("Clip export failed");
   }
-  markedVideo.goToFrame(currentFrame);
-  Synchronize();
 }
 
 void Frame::OnDumpAllIntervalsTo(wxCommandEvent &)
@@ -326,10 +467,11 @@ void Frame::OnDumpAllIntervalsTo(wxCommandEvent &)
 
 void Frame::OnSetComment(wxCommandEvent &)
 {
-  Interval *interval = markedVideo.getCurrentInterval();
-  if (!interval)
+  const Interval *current = markedVideo.getCurrentInterval();
+  if (!current)
     return;
-  wxString str = interval->comment;
+  Interval interval = *current;
+  wxString str = interval.comment;
   wxTextEntryDialog dialog(this, wxT("Interval comment"), wxT("Input comment:"), str);
   if (dialog.ShowModal() == wxID_OK)
   {
@@ -340,8 +482,9 @@ void Frame::OnSetComment(wxCommandEvent &)
         wxMessageBox(wxT("Illegal characters in comment"));
         return;
       }
-    interval->comment = dialog.GetValue();
-    markupChanged = true;
+    interval.comment = value;
+    if (markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+      markupChanged = true;
     intervalPanel->OnUpdateInterval(true);
     Synchronize();
   }
@@ -375,22 +518,35 @@ void Frame::OnToggleAutoLoadMarkup(wxCommandEvent &event)
   Synchronize();
 }
 
+void Frame::OnToggleSlitScan(wxCommandEvent &event)
+{
+  wxConfigBase::Get()->Write(seShowSlitScan, event.IsChecked());
+  slitScanPanel->Show(event.IsChecked());
+  if (!event.IsChecked())
+    slitScanPanel->CloseVideo();
+  else if (markedVideo.getCurrentFrame())
+    slitScanPanel->OpenVideo(markedVideo.getVideoName());
+  Layout();
+}
+
 void Frame::OnSetType(wxCommandEvent &)
 {
-  Interval *interval = markedVideo.getCurrentInterval();
-  if (!interval)
+  const Interval *current = markedVideo.getCurrentInterval();
+  if (!current)
     return;
+  Interval interval = *current;
 
-  wxNumberEntryDialog dialog(this, wxEmptyString, wxT("Type of interval:"), wxT("Type of interval"), (long) interval->type, 0, 500);
+  wxNumberEntryDialog dialog(this, wxEmptyString, wxT("Type of interval:"), wxT("Type of interval"), (long) interval.type, 0, 500);
   if (dialog.ShowModal() == wxID_OK)
   {
-    int type = interval->type = dialog.GetValue();
+    int type = interval.type = dialog.GetValue();
     if (type < 1 || type > 4)
     {
       wxMessageBox(wxT("Invalid interval type. Possible types are 1, 2, 3 and 4"), wxT("Invalid interval type"), wxICON_ERROR);
       return;
     }
-    markupChanged = true;
+    if (markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+      markupChanged = true;
   }
   Synchronize();
 }
@@ -441,6 +597,102 @@ void Frame::OnGotoInterval(wxCommandEvent &)
   Synchronize(true);
 }
 
+void Frame::OnFindIntervals(wxCommandEvent &)
+{
+  wxTextEntryDialog dialog(this,
+    wxT("Labels (-label to exclude), type:N[,M], comment:text, frames:A-B"),
+    wxT("Find intervals"), m_findResult.getQuery().getText().c_str());
+  if (dialog.ShowModal() != wxID_OK)
+    return;
+  video_markup::MarkupQuery query;
+  std::string error;
+  if (!query.parse(dialog.GetValue().c_str(), &error))
+  {
+    wxMessageBox(wxString(("Invalid query: " + error).c_str()), wxT("Find intervals"), wxOK | wxICON_ERROR);
+    return;
+  }
+  m_findResult.setQuery(query);
+  m_findResult.refresh(markedVideo.getMarkup());
+  LOG_INFO(m_findResult.size() << " interval(s) match '" << query.getText() << "'");
+  if (markedVideo.moveToNextMatch(m_findResult))
+    Synchronize(true);
+  else
+    UpdateStatusLine(markedVideo.getCurrentInterval());
+}
+
+void Frame::OnNextMatch(wxCommandEvent &)
+{
+  if (!markedVideo.moveToNextMatch(m_findResult))
+    return;
+  Synchronize(true);
+}
+
+void Frame::OnPrevMatch(wxCommandEvent &)
+{
+  if (!markedVideo.moveToPrevMatch(m_findResult))
+    return;
+  Synchronize(true);
+}
+
+void Frame::OnClearFind(wxCommandEvent &)
+{
+  m_findResult.setQuery(video_markup::MarkupQuery());
+  UpdateStatusLine(markedVideo.getCurrentInterval());
+}
+
+void Frame::OnProposeIntervals(wxCommandEvent &)
+{
+  if (!markedVideo.getCurrentFrame())
+    return;
+  wxBusyCursor busy;
+  std::vector<float> activity;
+  VideoPassStatistics stats;
+  if (!computeActivity(markedVideo.getVideoName(), activity, ActivityOptions(), &stats))
+  {
+    LOG_ERROR("Cannot compute the activity of the video");
+    return;
+  }
+  video_markup::Markup proposals;
+  if (!proposeIntervals(activity, ProposalOptions(), proposals))
+  {
+    LOG_ERROR("Cannot propose intervals");
+    return;
+  }
+  markedVideo.setProposals(proposals);
+  LOG_INFO(proposals.size() << " interval(s) proposed in " << stats.time << " s");
+
+  std::string proposalsName = MarkedVideo::getProposalsName(markedVideo.getVideoName());
+  if (!proposals.save(proposalsName.c_str()))
+    LOG_WARNING("Cannot save proposals to " << proposalsName);
+  Synchronize(true);
+}
+
+void Frame::OnAcceptProposal(wxCommandEvent &)
+{
+  if (!markedVideo.acceptProposal())
+  {
+    if (markedVideo.getProposals().isIntervalFrame(currentFrameNumber()))
+      LOG_WARNING("The proposal overlaps a marked interval");
+    return;
+  }
+  markupChanged = true;
+  Synchronize(true);
+}
+
+void Frame::OnNextProposal(wxCommandEvent &)
+{
+  if (!markedVideo.moveToNextProposal())
+    return;
+  Synchronize(true);
+}
+
+void Frame::OnPrevProposal(wxCommandEvent &)
+{
+  if (!markedVideo.moveToPrevProposal())
+    return;
+  Synchronize(true);
+}
+
 bool Frame::canResetMarkup() const
 {
   return !markupChanged || (wxYES == wxMessageBox(wxT("You have made changes to the markup without saving. Continue?"), wxT("Markup changed"), wxCENTRE | wxYES_NO | wxNO_DEFAULT | wxICON_QUESTION));
@@ -456,12 +708,12 @@ void Frame::OnLoadMarkup(wxCommandEvent &)
   wxSplitPath(markedVideo.getVideoName().c_str(), 0, &videoFileName, &videoFileExt);
   wxString defaultLogName = videoFileName + wxT(".") + videoFileExt + wxT(".xml");
 
-  wxFileDialog dialog(this, wxT("Load markup"), wxConfigBase::Get()->Read(seDefaultMarkupDir), defaultLogName, wxT("*.xml"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+  wxFileDialog dialog(this, wxT("Load markup"), wxConfigBase::Get()->Read(seDefaultMarkupDir), defaultLogName, wxT("Markups (*.xml;*.vmb)|*.xml;*.vmb|All files|*"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
   if (dialog.ShowModal() == wxID_OK)
   {
     if (markedVideo.loadMarkup(dialog.GetPath().c_str()))
     {
-      markupChanged = false;
+      markupChanged = markedVideo.getRecoveredEdits() > 0;
       wxConfigBase::Get()->Write(seDefaultMarkupDir, dialog.GetDirectory());
       Synchronize(true);
     }
@@ -497,7 +749,7 @@ void Frame::OnSaveMarkupAs(wxCommandEvent &)
   wxString videoFileExt;
   wxSplitPath(markedVideo.getVideoName().c_str(), 0, &videoFileName, &videoFileExt);
   wxString defaultLogName = videoFileName + wxT(".") + videoFileExt + wxT(".xml");
-  wxFileDialog dialog(this, wxT("Save markup As..."), wxConfigBase::Get()->Read(seDefaultMarkupDir), defaultLogName, wxT("*.xml"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+  wxFileDialog dialog(this, wxT("Save markup As..."), wxConfigBase::Get()->Read(seDefaultMarkupDir), defaultLogName, wxT("XML markup (*.xml)|*.xml|Binary markup (*.vmb)|*.vmb"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 
   if (dialog.ShowModal() == wxID_OK)
   {
@@ -541,11 +793,14 @@ void Frame::OnMark(wxCommandEvent &)
 
 void Frame::OnMarkNewEnd(wxCommandEvent &)
 {
-  Interval *interval = markedVideo.getCurrentInterval();
+  const Interval *current = markedVideo.getCurrentInterval();
   int frame = markedVideo.getCurrentFrameNumber();
-  if (interval && frame > interval->start)
+  if (current && frame > current->start)
   {
-    interval->end = frame;
+    Interval interval = *current;
+    interval.end = frame;
+    if (!markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+      return;
     markupChanged = true;
     LOG_INFO("New interval end was set to " << frame);
     Synchronize();
@@ -554,8 +809,10 @@ void Frame::OnMarkNewEnd(wxCommandEvent &)
   {
     if (!markedVideo.moveToPrevInterval())
       return;
-    Interval *interval = markedVideo.getCurrentInterval();
-    interval->end = frame;
+    Interval interval = *markedVideo.getCurrentInterval();
+    interval.end = frame;
+    if (markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+      markupChanged = true;
     markedVideo.goToFrame(frame);
     int id = markedVideo.getCurrentIntervalId();
     LOG_INFO("Interval " << id << ": new interval end was set to " << frame);
@@ -565,11 +822,14 @@ void Frame::OnMarkNewEnd(wxCommandEvent &)
 
 void Frame::OnMarkNewStart(wxCommandEvent &)
 {
-  Interval *interval = markedVideo.getCurrentInterval();
+  const Interval *current = markedVideo.getCurrentInterval();
   int frame = markedVideo.getCurrentFrameNumber();
-  if (interval)
+  if (current)
   {
-    interval->start = frame;
+    Interval interval = *current;
+    interval.start = frame;
+    if (!markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+      return;
     markupChanged = true;
     LOG_INFO("New start frame was set to " << frame);
     Synchronize();
@@ -578,8 +838,10 @@ void Frame::OnMarkNewStart(wxCommandEvent &)
   {
     if (!markedVideo.moveToNextInterval())
       return;
-    Interval *interval = markedVideo.getCurrentInterval();
-    interval->start = frame;
+    Interval interval = *markedVideo.getCurrentInterval();
+    interval.start = frame;
+    if (markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+      markupChanged = true;
     markedVideo.goToFrame(frame);
     int id = markedVideo.getCurrentIntervalId();
     LOG_INFO("Interval " << id << ": new start frame was set to " << frame);
@@ -607,6 +869,59 @@ void Frame::OnSetLittleMoveSize(wxCommandEvent &)
   }
 }
 
+void Frame::OnSetDumpFormat(wxCommandEvent &)
+{
+  // vmp is not an image format: all frames go to a single frame pack file
+  const wxString formats[] = {wxT("jpg"), wxT("png"), wxT("ppm"), wxT("pgm"), wxT("qoi"), wxT("vmp")};
+  const int formatCount = sizeof(formats) / sizeof(formats[0]);
+  wxSingleChoiceDialog dialog(this, wxT("Format of dumped frames:"), wxT("Dump format"), formatCount, formats);
+  wxString current = wxConfigBase::Get()->Read(seDumpFormat, wxT("jpg"));
+  for (int i = 0; i < formatCount; i++)
+    if (formats[i] == current)
+      dialog.SetSelection(i);
+  if (dialog.ShowModal() != wxID_OK)
+    return;
+  wxConfigBase::Get()->Write(seDumpFormat, dialog.GetStringSelection());
+  if (dialog.GetStringSelection() == wxT("jpg"))
+  {
+    wxNumberEntryDialog qualityDialog(this, wxEmptyString, wxT("JPEG quality:"), wxT("Dump format"), wxConfigBase::Get()->Read(seDumpQuality, 90), 1, 100);
+    if (qualityDialog.ShowModal() == wxID_OK)
+      wxConfigBase::Get()->Write(seDumpQuality, qualityDialog.GetValue());
+  }
+  LOG_INFO("Dump format is set to " << dialog.GetStringSelection());
+}
+
+void Frame::OnSetDumpRegion(wxCommandEvent &)
+{
+  // empty strings mean the whole frame in its original size
+  wxTextEntryDialog cropDialog(this, wxT("Crop rectangle X,Y,W,H (add \",border\" to make Y relative to the interval border,\nW or H 0 for the rest of the frame, empty for the whole frame):"),
+                               wxT("Dump region"), wxConfigBase::Get()->Read(seDumpCrop, wxEmptyString));
+  if (cropDialog.ShowModal() != wxID_OK)
+    return;
+  wxString crop = cropDialog.GetValue().Strip(wxString::both);
+  DumpOptions options;
+  if (!crop.IsEmpty() && !options.parseCrop(crop.c_str()))
+  {
+    wxMessageBox(wxT("Invalid crop rectangle"), wxT("Dump region"), wxOK | wxICON_ERROR, this);
+    return;
+  }
+
+  wxTextEntryDialog sizeDialog(this, wxT("Output size WxH (empty to keep the crop size):"),
+                               wxT("Dump region"), wxConfigBase::Get()->Read(seDumpSize, wxEmptyString));
+  if (sizeDialog.ShowModal() != wxID_OK)
+    return;
+  wxString size = sizeDialog.GetValue().Strip(wxString::both);
+  if (!size.IsEmpty() && !options.parseOutputSize(size.c_str()))
+  {
+    wxMessageBox(wxT("Invalid output size"), wxT("Dump region"), wxOK | wxICON_ERROR, this);
+    return;
+  }
+
+  wxConfigBase::Get()->Write(seDumpCrop, crop);
+  wxConfigBase::Get()->Write(seDumpSize, size);
+  LOG_INFO("Dump region is set to '" << crop.c_str() << "', size '" << size.c_str() << "'");
+}
+
 int Frame::currentFrameNumber()
 {
   return markedVideo.getCurrentFrameNumber();
@@ -649,17 +964,38 @@ void Frame::UpdateStatusLine(const Interval *interval)
     s.Printf(wxT("%d/%d"), currentFrameNumber(), totalFrames - 1);
   else
     s.Printf(wxT("%d/-"), currentFrameNumber());
+  const FrameDefectIndex &defects = motionPanel->GetDefects();
+  if (currentFrameNumber() >= 0 && currentFrameNumber() < defects.getFrames())
+  {
+    FrameDefectIndex::FrameKind kind = defects.classify(currentFrameNumber());
+    if (kind == FrameDefectIndex::frameRepeat)
+      s += wxT(", repeat");
+    else if (kind == FrameDefectIndex::frameNearRepeat)
+      s += wxT(", near repeat");
+    else if (kind == FrameDefectIndex::frameBlack)
+      s += wxT(", black");
+  }
   SetStatusText(s, StatusFrame);
 
   if (interval)
   {
     // interval number
     s.Printf(wxT("Interval %d/%d"), markedVideo.getCurrentIntervalId()+1, markedVideo.getTotalIntervals());
+    if (!m_findResult.getQuery().empty())
+    {
+      m_findResult.refresh(markedVideo.getMarkup());
+      int position = m_findResult.getPosition(*interval);
+      if (position >= 0)
+        s += wxString::Format(wxT(", match %d/%d"), position + 1, (int) m_findResult.size());
+    }
     SetStatusText(s, StatusInterval);
   }
   else
   {
     s.Printf(wxT("Interval -/%d"), markedVideo.getTotalIntervals());
+    int proposal = markedVideo.getProposals().find(currentFrameNumber());
+    if (proposal >= 0)
+      s += wxString::Format(wxT(", proposal %d/%d"), proposal + 1, (int) markedVideo.getProposals().size());
     SetStatusText(s, StatusInterval);
   }
 }
@@ -691,6 +1027,8 @@ bool Frame::Synchronize(bool force)
 
   canvasHolder->OnBitmapUpdate();
   intervalPanel->OnUpdateInterval(force);
+  slitScanPanel->OnUpdateFrame();
+  motionPanel->Refresh();
 
   frameSlider->SetValue(markedVideo.getCurrentFrameNumber());
 
@@ -699,12 +1037,14 @@ bool Frame::Synchronize(bool force)
 
 void Frame::OnLeftDown(wxMouseEvent &event)
 {
-  Interval *interval = markedVideo.getCurrentInterval();
-  if (!interval)
+  const Interval *current = markedVideo.getCurrentInterval();
+  if (!current)
     return;
-  interval->y_border = event.GetPosition().y;
+  Interval interval = *current;
+  interval.y_border = event.GetPosition().y;
 
-  markupChanged = true;
+  if (markedVideo.updateInterval(markedVideo.getCurrentIntervalId(), interval))
+    markupChanged = true;
   Synchronize();
 }
 
@@ -900,13 +1240,16 @@ bool Frame::OpenVideo(const char *videoFileName, const char *markupName, int sta
   LOG_INFO("Opening video. This may take some time...");
 
   frameSlider->SetMax(0);   // resetting frameSlider
+  slitScanPanel->CloseVideo();
+  motionPanel->CloseVideo();
   if (!markedVideo.loadVideo(videoFileName, markupName))
   {
     LOG_ERROR("Failed to open video " << videoFileName);
     Raise();      // to ensure that the app is an active windows app
     return false;
   }
-  markupChanged = false;
+  // recovered edits are not saved yet
+  markupChanged = markedVideo.getRecoveredEdits() > 0;
   LOG_INFO("Successfully opened video " << markedVideo.getVideoName());
 
   if (startFrame > 0)
@@ -923,6 +1266,9 @@ bool Frame::OpenVideo(const char *videoFileName, const char *markupName, int sta
   SetTitle(videoFileName);
   SetStatusText(wxEmptyString);
   frameSlider->SetMax(markedVideo.getTotalFrames());
+  if (slitScanPanel->IsShown())
+    slitScanPanel->OpenVideo(markedVideo.getVideoName());
+  motionPanel->OpenVideo(markedVideo.getVideoName());
 
   Synchronize(true);
   Raise();      // to ensure that the app is an active windows app
@@ -973,6 +1319,7 @@ Frame::Frame(const CmdLineArguments &cmdLineArguments)
   , topHeightLineColour(wxColour(255, 0, 0))
   , m_playbackTimer(this, PLAYBACK_TIMER_ID)
   , m_playbackState(playbackStopped)
+  , m_journalTimer(this, JOURNAL_TIMER_ID)
   , markupChanged(false)
 {
   // initializing some parameters from the config
@@ -982,6 +1329,8 @@ Frame::Frame(const CmdLineArguments &cmdLineArguments)
   bool autoLoadMarkup_flag;
   wxConfigBase::Get()->Read(seAutoLoadMarkup, &autoLoadMarkup_flag, true);
   markedVideo.setAutoLoadMarkup(autoLoadMarkup_flag);
+  markedVideo.setJournaling(true);
+  m_journalTimer.Start(JournalPeriod);
 
   littlemoveSize = wxConfigBase::Get()->Read(seLittleMoveSize, 5);
   CalculatePlaybackParams( wxConfigBase::Get()->Read(seFastPlayFps, 100), &m_fastPlaybackPeriod, &m_fastPlaybackStep);
@@ -995,7 +1344,7 @@ Frame::Frame(const CmdLineArguments &cmdLineArguments)
   // initializing status bar
   // BE CAREFUL AND MODIFY ALL THESE THREE LINES TOGETHER
   wxStatusBar *statusBar = CreateStatusBar(5);
-  int widths[] = {-1, 100, 100, 80, 70};
+  int widths[] = {-1, 100, 160, 80, 70};
   statusBar->SetStatusWidths(5, widths);
 
   canvasHolder = new CanvasHolder(this);
@@ -1013,6 +1362,18 @@ Frame::Frame(const CmdLineArguments &cmdLineArguments)
   Connect(frameSlider->GetId(), wxEVT_COMMAND_SLIDER_UPDATED, wxScrollEventHandler(Frame::OnSliderUpdate));
   vertSizer->Add(frameSlider, 0, wxEXPAND, 2);
 
+  double skipThreshold;
+  wxConfigBase::Get()->Read(seSkipThreshold, &skipThreshold, 0.0);
+  motionPanel = new MotionPanel(this);
+  motionPanel->SetThreshold(skipThreshold);
+  vertSizer->Add(motionPanel, 0, wxEXPAND | wxTOP, 2);
+
+  bool showSlitScan;
+  wxConfigBase::Get()->Read(seShowSlitScan, &showSlitScan, true);
+  slitScanPanel = new SlitScanPanel(this);
+  slitScanPanel->Show(showSlitScan);
+  vertSizer->Add(slitScanPanel, 0, wxEXPAND | wxTOP, 2);
+
   if (!logPanel)
   {
     logPanel = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY | wxHSCROLL | wxTE_RICH);
@@ -1068,20 +1429,34 @@ void Frame::InitMenu()
   navigateMenu->Append(ID_GOTO_INTERVAL, wxT("Go to interval\tCtrl+F"), wxT("Go to a given interval"));
   navigateMenu->Append(ID_GOTO_INTERVAL_END, wxT("Interval end\tEnd"), wxT("Go to interval end"));
   navigateMenu->Append(ID_GOTO_INTERVAL_START, wxT("Interval start\tHome"), wxT("Go to interval start"));
+  navigateMenu->AppendSeparator();
+  navigateMenu->Append(ID_FIND_INTERVALS, wxT("Find intervals...\tCtrl+Shift+F"), wxT("Select intervals by labels, type, comment or frames"));
+  navigateMenu->Append(ID_NEXT_MATCH, wxT("Next match\tF3"), wxT("Go to the next selected interval"));
+  navigateMenu->Append(ID_PREV_MATCH, wxT("Previous match\tShift+F3"), wxT("Go to the previous selected interval"));
+  navigateMenu->Append(ID_CLEAR_FIND, wxT("Clear selection"), wxT("Forget the interval selection"));
+  navigateMenu->AppendSeparator();
+  navigateMenu->Append(ID_NEXT_PROPOSAL, wxT("Next proposal\tCtrl+Shift+Right"), wxT("Go to the next proposed interval"));
+  navigateMenu->Append(ID_PREV_PROPOSAL, wxT("Previous proposal\tCtrl+Shift+Left"), wxT("Go to the previous proposed interval"));
 
   wxMenu *viewMenu = new wxMenu;
   viewMenu->Append(ID_SET_GAMMA, wxT("&Gamma correction\tCtrl+G"), wxT("Set gamma correction parameter"));
+  viewMenu->AppendCheckItem(ID_TOGGLE_SLIT_SCAN, wxT("&Slit-scan strip"), wxT("Show the center line of every frame as a time-slice strip"));
+  bool showSlitScan;
+  wxConfigBase::Get()->Read(seShowSlitScan, &showSlitScan, true);
+  viewMenu->Check(ID_TOGGLE_SLIT_SCAN, showSlitScan);
 
   wxMenu *miscMenu = new wxMenu;
   miscMenu->Append(ID_MAKE_SCREENSHOT, wxT("Make &screenshot"), wxT("Make a screenshot"));
   miscMenu->Append(ID_SAVE_SCREENSHOT_AS, wxT("Save screenshot &as...\tCtrl+R"), wxT("Make a screenshot and save it to a given file"));
-  miscMenu->Append(ID_CALC_CHECKSUM, wxT("&Checksum"), wxT("Calculate frame checksum"));
+  miscMenu->Append(ID_CALC_CHECKSUM, wxT("&Checksum"), wxT("Calculate frame checksum and fingerprint"));
 
   wxMenu *playMenu = new wxMenu;
   playMenu->Append(ID_FAST_PLAY, wxT("&Fast play\tS"), wxT("Start or stop fast playback"));
   playMenu->Append(ID_SLOW_PLAY, wxT("S&low play\tC"), wxT("Start or stop slow playback"));
+  playMenu->Append(ID_SKIP_PLAY, wxT("S&kip static play\tD"), wxT("Start or stop fast playback which jumps over static footage"));
   playMenu->Append(ID_SET_FAST_PLAY_FPS, wxT("Set f&ast playback speed"), wxT("Set fast playback speed"));
   playMenu->Append(ID_SET_SLOW_PLAY_FPS, wxT("Set slo&w playback speed"), wxT("Set slow playback speed"));
+  playMenu->Append(ID_SET_SKIP_THRESHOLD, wxT("Set s&kip threshold..."), wxT("Set motion energy of static footage"));
 
   wxMenu *intervalMenu = new wxMenu;
   intervalMenu->Append(ID_MARK, wxT("&Mark enter/leave\tSpace"), wxT("Mark enter/leave"));
@@ -1090,9 +1465,11 @@ void Frame::InitMenu()
   intervalMenu->Append(ID_DELETE_INTERVAL, wxT("&Delete\tDelete"), wxT("Delete current interval"));
   intervalMenu->Append(ID_SET_TYPE, wxT("Type\tT"), wxT("Set interval type"));
   intervalMenu->Append(ID_SET_COMMENT, wxT("Comment\tAlt+C"), wxT("Set interval comment"));
+  intervalMenu->Append(ID_ACCEPT_PROPOSAL, wxT("&Accept proposal\tA"), wxT("Add the proposed interval under the cursor to the markup"));
   intervalMenu->AppendSeparator();
   intervalMenu->Append(ID_DUMP_INTERVAL, wxT("D&ump\tCtrl+D"), wxT("Dump current interval's frames"));
   intervalMenu->Append(ID_DUMP_INTERVAL_TO, wxT("Dump t&o..."), wxT("Dump current interval's frames to a given directory"));
+  intervalMenu->Append(ID_EXPORT_INTERVAL_CLIP, wxT("Export c&lip..."), wxT("Save current interval as a video clip without re-encoding"));
      wxMenu *labelMenu = new wxMenu;
      labelMenu->Append(ID_INTERVAL_LABEL_FUNNY, wxT("&Funny"), wxT("Funny element label"));
      labelMenu->Append(ID_INTERVAL_LABEL_INTERESTING, wxT("&Interesting"), wxT("Interesting element label"));
@@ -1106,12 +1483,16 @@ void Frame::InitMenu()
   movieMenu->Append(ID_UNSET_MOVIE_END_FRAME, wxT("Unset e&nd frame"), wxT("Unset end frame"));
   movieMenu->Append(ID_DUMP_ALL_INTERVALS, wxT("Dump all intervals"), wxT("Dump all intervals to the previously selected directory"));
   movieMenu->Append(ID_DUMP_ALL_INTERVALS_TO, wxT("Dump all intervals to..."), wxT("Dump all intervals to a given directory"));
+  movieMenu->Append(ID_PROPOSE_INTERVALS, wxT("&Propose intervals"), wxT("Find intervals where the center line is active and show them as proposals"));
+  movieMenu->Append(ID_EXPORT_ALL_CLIPS, wxT("Export all interval clips to..."), wxT("Save all intervals as video clips without re-encoding"));
   movieMenu->AppendSeparator();
   movieMenu->Append(ID_COPY_SHORT_MOVIE_NAME, wxT("Copy short name\tCtrl+Insert"), wxT("Copy short movie name to clipboard"));
 
   wxMenu *settingsMenu = new wxMenu;
   settingsMenu->Append(ID_SET_MOVESIZE, wxT("&Move size\tCtrl+M"), wxT("Set on how many frames move forward and backward"));
   settingsMenu->Append(ID_SET_LITTLEMOVESIZE, wxT("L&ittle move size\tCtrl+I"), wxT("Set on how many frames move forward and backward"));
+  settingsMenu->Append(ID_SET_DUMP_FORMAT, wxT("&Dump format..."), wxT("Set image format and quality of dumped frames"));
+  settingsMenu->Append(ID_SET_DUMP_REGION, wxT("Dump &region..."), wxT("Set crop rectangle and output size of dumped frames"));
   settingsMenu->AppendSeparator();
   settingsMenu->AppendCheckItem(ID_TOGGLE_AUTO_LOAD_MARKUP, wxT("&Auto load markup"), wxT("Try to load markup automatically"));
   settingsMenu->Check(ID_TOGGLE_AUTO_LOAD_MARKUP, markedVideo.getAutoLoadMarkup());
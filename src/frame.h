@@ -30,8 +30,11 @@ THE SOFTWARE.
 
 #include "logger.h"
 #include "markedvideo.h"
+#include "markup_query.h"
 
 class IntervalPanel;
+class SlitScanPanel;
+class MotionPanel;
 class CanvasHolder;
 
 struct CmdLineArguments
@@ -60,6 +63,7 @@ class Frame: public wxFrame
     void OnLoadMarkup(wxCommandEvent &);
     void OnQuit(wxCommandEvent &);
     void OnSetGamma(wxCommandEvent &);
+    void OnToggleSlitScan(wxCommandEvent &);
     void OnAbout(wxCommandEvent &);
     void OnMakeScreenshot(wxCommandEvent &);
     void OnSaveScreenshotAs(wxCommandEvent &);
@@ -79,11 +83,21 @@ class Frame: public wxFrame
     void OnNextInterval(wxCommandEvent &);
     void OnPrevInterval(wxCommandEvent &);
     void OnGotoInterval(wxCommandEvent &);
+    void OnFindIntervals(wxCommandEvent &);
+    void OnNextMatch(wxCommandEvent &);
+    void OnPrevMatch(wxCommandEvent &);
+    void OnClearFind(wxCommandEvent &);
+    void OnProposeIntervals(wxCommandEvent &);
+    void OnAcceptProposal(wxCommandEvent &);
+    void OnNextProposal(wxCommandEvent &);
+    void OnPrevProposal(wxCommandEvent &);
     void OnGotoIntervalEnd(wxCommandEvent &);
     void OnGotoIntervalStart(wxCommandEvent &);
     void OnDeleteInterval(wxCommandEvent &);
     void OnSetMoveSize(wxCommandEvent &);
     void OnSetLittleMoveSize(wxCommandEvent &);
+    void OnSetDumpFormat(wxCommandEvent &);
+    void OnSetDumpRegion(wxCommandEvent &);
     
     void OnToggleAutoLoadMarkup(wxCommandEvent &);
 
@@ -92,6 +106,8 @@ class Frame: public wxFrame
     void OnDumpAllIntervals(wxCommandEvent &);
     void OnDumpAllIntervalsTo(wxCommandEvent &);
     void OnCopyShortMovieName(wxCommandEvent &);
+    bool DumpIntervals(const std::vector<int> &ids, const std::string &dumpDir);
+    void OnExportClips(wxCommandEvent &);
 
     void OnGoToFrame(wxCommandEvent &);
     void OnGoToMovieStart(wxCommandEvent &);
@@ -108,7 +124,10 @@ class Frame: public wxFrame
     void OnSetSlowPlayFps(wxCommandEvent &);
     void OnSlowPlay(wxCommandEvent &);
     void OnFastPlay(wxCommandEvent &);
+    void OnSkipPlay(wxCommandEvent &);
+    void OnSetSkipThreshold(wxCommandEvent &);
     void OnPlaybackTimer(wxTimerEvent &);
+    void OnJournalTimer(wxTimerEvent &);
 
     void OnClose(wxCloseEvent &);
 
@@ -127,9 +146,11 @@ class Frame: public wxFrame
     int m_slowPlaybackStep;
     int m_slowPlaybackPeriod;
     int m_currentPlaybackStep;
-    enum PlaybackState {playbackFast, playbackSlow, playbackStopped} m_playbackState;
+    enum PlaybackState {playbackFast, playbackSlow, playbackSkip, playbackStopped} m_playbackState;
     void setPlaybackState(enum PlaybackState);
 
+    wxTimer m_journalTimer;         ///< syncs and compacts the markup journal
+
     int currentFrameNumber();
 
     bool Synchronize(bool force = false);
@@ -142,11 +163,15 @@ class Frame: public wxFrame
 
     CanvasHolder *canvasHolder;
     IntervalPanel *intervalPanel;
+    SlitScanPanel *slitScanPanel;
+    MotionPanel *motionPanel;
     wxSlider *frameSlider;
 
     wxBitmap pureBitmap;
 
     bool markupChanged;
+
+    video_markup::QueryResult m_findResult;   ///< intervals stepped through by next/previous match
     bool canResetMarkup() const;
 
     wxColour topHeightLineColour;
@@ -177,3 +202,7 @@ const int StatusInterval = 1;
 const int StatusFrame = 2;
 const int StatusMouse = 3;
 const int StatusPlayback = 4;
+
+const int JournalPeriod = 2000;   // ms between journal syncs
+const int MinSkipFrames = 25;     // shorter static runs are played in skip mode
+const int SkipLeadIn = 5;         // frames of the static run shown before the motion
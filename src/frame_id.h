@@ -48,12 +48,21 @@ enum {
   ID_LITTLEMOVE_FORWARD,
   ID_LITTLEMOVE_BACKWARD,
   ID_SET_GAMMA,
+  ID_TOGGLE_SLIT_SCAN,
   ID_COPY_SHORT_MOVIE_NAME,
   ID_DUMP_INTERVAL,
   ID_DUMP_INTERVAL_TO,
   ID_DUMP_ALL_INTERVALS,
   ID_DUMP_ALL_INTERVALS_TO,
   ID_GOTO_INTERVAL,
+  ID_FIND_INTERVALS,
+  ID_NEXT_MATCH,
+  ID_PREV_MATCH,
+  ID_CLEAR_FIND,
+  ID_PROPOSE_INTERVALS,
+  ID_ACCEPT_PROPOSAL,
+  ID_NEXT_PROPOSAL,
+  ID_PREV_PROPOSAL,
   ID_CALC_CHECKSUM,
   ID_GOTO_INTERVAL_END,
   ID_GOTO_INTERVAL_START,
@@ -64,6 +73,8 @@ enum {
   ID_FAST_PLAY,
   ID_SET_FAST_PLAY_FPS,
   ID_SET_SLOW_PLAY_FPS,
+  ID_SKIP_PLAY,
+  ID_SET_SKIP_THRESHOLD,
   ID_SET_COMMENT,
   ID_TOGGLE_AUTO_LOAD_MARKUP,
   ID_GOTO_FRAME,
@@ -73,6 +84,10 @@ enum {
   ID_SET_MOVIE_END_FRAME,
   ID_UNSET_MOVIE_START_FRAME,
   ID_UNSET_MOVIE_END_FRAME,
+  ID_SET_DUMP_FORMAT,
+  ID_SET_DUMP_REGION,
+  ID_EXPORT_INTERVAL_CLIP,
+  ID_EXPORT_ALL_CLIPS,
   
   ID_INTERVAL_LABEL_FUNNY,
   ID_INTERVAL_LABEL_INTERESTING,
@@ -80,6 +95,7 @@ enum {
   };
 
 #define PLAYBACK_TIMER_ID   10000
+#define JOURNAL_TIMER_ID    10001
 
 BEGIN_EVENT_TABLE(Frame, wxFrame)
   EVT_MENU(   wxID_OPEN,                         Frame::OnOpen                      )
@@ -114,6 +130,14 @@ BEGIN_EVENT_TABLE(Frame, wxFrame)
   EVT_MENU(   ID_DUMP_ALL_INTERVALS,             Frame::OnDumpAllIntervals          )
   EVT_MENU(   ID_DUMP_ALL_INTERVALS_TO,          Frame::OnDumpAllIntervalsTo        )
   EVT_MENU(   ID_GOTO_INTERVAL,                  Frame::OnGotoInterval              )
+  EVT_MENU(   ID_FIND_INTERVALS,                 Frame::OnFindIntervals             )
+  EVT_MENU(   ID_NEXT_MATCH,                     Frame::OnNextMatch                 )
+  EVT_MENU(   ID_PREV_MATCH,                     Frame::OnPrevMatch                 )
+  EVT_MENU(   ID_CLEAR_FIND,                     Frame::OnClearFind                 )
+  EVT_MENU(   ID_PROPOSE_INTERVALS,              Frame::OnProposeIntervals          )
+  EVT_MENU(   ID_ACCEPT_PROPOSAL,                Frame::OnAcceptProposal            )
+  EVT_MENU(   ID_NEXT_PROPOSAL,                  Frame::OnNextProposal              )
+  EVT_MENU(   ID_PREV_PROPOSAL,                  Frame::OnPrevProposal              )
   EVT_MENU(   ID_CALC_CHECKSUM,                  Frame::OnCalcChecksum              )
   EVT_MENU(   ID_GOTO_INTERVAL_END,              Frame::OnGotoIntervalEnd           )
   EVT_MENU(   ID_GOTO_INTERVAL_START,            Frame::OnGotoIntervalStart         )
@@ -123,11 +147,18 @@ BEGIN_EVENT_TABLE(Frame, wxFrame)
   EVT_MENU(   ID_SLOW_PLAY,                      Frame::OnSlowPlay                  )
   EVT_MENU(   ID_SET_SLOW_PLAY_FPS,              Frame::OnSetSlowPlayFps            )
   EVT_MENU(   ID_SET_FAST_PLAY_FPS,              Frame::OnSetFastPlayFps            )
+  EVT_MENU(   ID_SKIP_PLAY,                      Frame::OnSkipPlay                  )
+  EVT_MENU(   ID_SET_SKIP_THRESHOLD,             Frame::OnSetSkipThreshold          )
   EVT_MENU(   ID_TOGGLE_AUTO_LOAD_MARKUP,        Frame::OnToggleAutoLoadMarkup      )
+  EVT_MENU(   ID_TOGGLE_SLIT_SCAN,               Frame::OnToggleSlitScan            )
   EVT_MENU(   ID_SET_MOVIE_START_FRAME,          Frame::OnSetMovieStartFrame        )
   EVT_MENU(   ID_SET_MOVIE_END_FRAME,            Frame::OnSetMovieEndFrame          )
   EVT_MENU(   ID_UNSET_MOVIE_START_FRAME,        Frame::OnUnsetMovieStartFrame      )
   EVT_MENU(   ID_UNSET_MOVIE_END_FRAME,          Frame::OnUnsetMovieEndFrame        )
+  EVT_MENU(   ID_SET_DUMP_FORMAT,                Frame::OnSetDumpFormat             )
+  EVT_MENU(   ID_SET_DUMP_REGION,                Frame::OnSetDumpRegion             )
+  EVT_MENU(   ID_EXPORT_INTERVAL_CLIP,           Frame::OnExportClips               )
+  EVT_MENU(   ID_EXPORT_ALL_CLIPS,               Frame::OnExportClips               )
 
   EVT_MENU(   ID_INTERVAL_LABEL_FUNNY,           Frame::OnIntervalLabel             )
   EVT_MENU(   ID_INTERVAL_LABEL_INTERESTING,     Frame::OnIntervalLabel             )
@@ -136,4 +167,5 @@ BEGIN_EVENT_TABLE(Frame, wxFrame)
   EVT_CLOSE(  Frame::OnClose  )
 
   EVT_TIMER(  PLAYBACK_TIMER_ID,                 Frame::OnPlaybackTimer             )
+  EVT_TIMER(  JOURNAL_TIMER_ID,                  Frame::OnJournalTimer              )
 END_EVENT_TABLE()
@@ -56,7 +56,7 @@ void IntervalPanel::OnUpdateInterval(bool force)
     {
       comment->SetValue(interval->comment);
       int i = 0;
-      for (std::set<std::string>::const_iterator it = interval->labels.begin(); it != interval->labels.end(); ++it, ++i)
+      for (video_markup::Interval::Labels::const_iterator it = interval->labels.begin(); it != interval->labels.end(); ++it, ++i)
         labels->Insert(*it, i);
     }
   }
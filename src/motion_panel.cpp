@@ -0,0 +1,191 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+
+#include "motion_panel.h"
+#include "frame.h"
+
+BEGIN_EVENT_TABLE(MotionPanel, wxWindow)
+  EVT_PAINT(MotionPanel::OnPaint)
+  EVT_LEFT_DOWN(MotionPanel::OnLeftDown)
+  EVT_TIMER(wxID_ANY, MotionPanel::OnTimer)
+END_EVENT_TABLE()
+
+MotionPanel::MotionPanel(Frame *ownerFrame)
+:wxWindow(ownerFrame, wxID_ANY)
+  , owner(ownerFrame)
+  , timer(this)
+  , threshold(0)
+  , autoThreshold(0)
+  , trackPending(false)
+  , defectsPending(false)
+{
+  SetBackgroundColour(wxColour(0, 0, 0));
+  SetBackgroundStyle(wxBG_STYLE_CUSTOM);
+  SetMinSize(wxSize(-1, MotionPanelHeight));
+}
+
+void MotionPanel::OpenVideo(const std::string &videoName)
+{
+  CloseVideo();
+  builder.start(videoName);
+  defectBuilder.start(videoName);
+  trackPending = defectsPending = true;
+  timer.Start(MotionPollPeriod);
+}
+
+void MotionPanel::CloseVideo()
+{
+  timer.Stop();
+  builder.cancel();
+  defectBuilder.cancel();
+  trackPending = defectsPending = false;
+  track.clear();
+  defects.clear();
+  defectRuns.clear();
+  Refresh();
+}
+
+void MotionPanel::SetThreshold(double value)
+{
+  threshold = value;
+  Refresh();
+}
+
+float MotionPanel::GetThreshold() const
+{
+  return threshold > 0 ? (float) threshold : autoThreshold;
+}
+
+void MotionPanel::OnTimer(wxTimerEvent &)
+{
+  if (trackPending && !builder.isRunning())
+  {
+    trackPending = false;
+    if (builder.take(track))
+    {
+      autoThreshold = track.getStaticThreshold();
+      LOG_INFO("Motion track of " << track.getFrames() << " frames is ready, static threshold " << autoThreshold);
+    }
+    else
+      LOG_WARNING("Cannot make the motion track of the video");
+  }
+  if (defectsPending && !defectBuilder.isRunning())
+  {
+    defectsPending = false;
+    if (defectBuilder.take(defects))
+    {
+      defects.findDefects(defectRuns);
+      int frozen = 0, black = 0;
+      for (size_t i = 0; i < defectRuns.size(); i++)
+      {
+        int length = defectRuns[i].end - defectRuns[i].start + 1;
+        if (defectRuns[i].kind == FrameDefect::defectBlack)
+          black += length;
+        else
+          frozen += length;
+      }
+      if (frozen || black)
+        LOG_WARNING("The video has " << frozen << " repeated and " << black << " black frames");
+    }
+    else
+      LOG_WARNING("Cannot index the frames of the video");
+  }
+  if (!trackPending && !defectsPending)
+    timer.Stop();
+  Refresh();    // progress or the results
+}
+
+void MotionPanel::OnLeftDown(wxMouseEvent &event)
+{
+  int width = GetClientSize().GetWidth();
+  if (track.empty() || width <= 0)
+    return;
+  int frame = (int) ((double) event.GetPosition().x * track.getFrames() / width);
+  if (frame >= 0 && frame < track.getFrames() && owner->markedVideo.goToFrame(frame))
+    owner->Synchronize();
+}
+
+void MotionPanel::OnPaint(wxPaintEvent &)
+{
+  wxPaintDC dc(this);
+  dc.SetBackground(wxBrush(GetBackgroundColour()));
+  dc.Clear();
+  wxSize size = GetClientSize();
+  if (track.empty())
+  {
+    if (builder.isRunning())
+    {
+      wxString text;
+      text.Printf(wxT("Measuring motion: %d frames"), builder.getProgress());
+      dc.SetTextForeground(wxColour(200, 200, 200));
+      dc.DrawText(text, 5, 2);
+    }
+    return;
+  }
+
+  // every pixel column shows the strongest motion among its frames
+  int frames = track.getFrames();
+  float limit = track.getMaxEnergy();
+  if (limit <= 0 || size.GetWidth() <= 0)
+    return;
+  float staticLevel = GetThreshold();
+  wxPen staticPen(wxColour(90, 90, 90)), motionPen(wxColour(250, 160, 0));
+  for (int x = 0; x < size.GetWidth(); x++)
+  {
+    int first = (int) ((double) x * frames / size.GetWidth());
+    int last = std::max(first, (int) ((double) (x + 1) * frames / size.GetWidth()) - 1);
+    float energy = 0;
+    for (int i = first; i <= last && i < frames; i++)
+      energy = std::max(energy, track.getEnergy(i));
+    int height = (int) (energy / limit * size.GetHeight() + 0.5);
+    dc.SetPen(energy > staticLevel ? motionPen : staticPen);
+    dc.DrawLine(x, size.GetHeight(), x, size.GetHeight() - height);
+  }
+
+  // defect runs are at least a pixel wide, so that a single repeated frame is seen
+  for (size_t i = 0; i < defectRuns.size(); i++)
+  {
+    const FrameDefect &defect = defectRuns[i];
+    int left = (int) ((double) defect.start * size.GetWidth() / frames);
+    int right = std::max(left + 1, (int) ((double) (defect.end + 1) * size.GetWidth() / frames));
+    wxColour colour = defect.kind == FrameDefect::defectBlack ? wxColour(60, 90, 255) : wxColour(255, 0, 255);
+    dc.SetPen(wxPen(colour));
+    dc.SetBrush(wxBrush(colour));
+    dc.DrawRectangle(left, 0, right - left, MotionDefectBand);
+  }
+
+  int y = size.GetHeight() - (int) (staticLevel / limit * size.GetHeight() + 0.5);
+  dc.SetPen(wxPen(wxColour(0, 200, 255), 1, wxDOT));
+  dc.DrawLine(0, y, size.GetWidth(), y);
+
+  int current = owner->markedVideo.getCurrentFrameNumber();
+  if (current >= 0)
+  {
+    int x = (int) ((double) current * size.GetWidth() / frames);
+    dc.SetPen(wxPen(wxColour(255, 0, 0)));
+    dc.DrawLine(x, 0, x, size.GetHeight());
+  }
+}
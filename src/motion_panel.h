@@ -0,0 +1,95 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <wx/wx.h>
+
+#include "motion_track.h"
+#include "frame_defects.h"
+#include "background_task.h"
+
+class Frame;
+
+/** Motion energy of the whole video drawn under the frame slider: frames
+  * above the static threshold stand out, the static ones are grey. Repeated
+  * (frozen) and black frames are marked along the top.
+  * The track and the defect index are made in the background; a click goes
+  * to the frame
+  */
+class MotionPanel: public wxWindow
+{
+  public:
+    MotionPanel(Frame *ownerFrame);
+
+    /** Starts making (or loading) the track and the defect index of the video
+      */
+    void OpenVideo(const std::string &videoName);
+
+    /** Stops the background work and forgets the track and the defects
+      */
+    void CloseVideo();
+
+    const MotionTrack &GetTrack() const
+    {
+      return track;
+    }
+
+    const FrameDefectIndex &GetDefects() const
+    {
+      return defects;
+    }
+
+    /** @param[in] value Energy up to which frames are static, 0 - chosen by the noise level
+      */
+    void SetThreshold(double value);
+
+    /** @return threshold in effect
+      */
+    float GetThreshold() const;
+
+    void OnPaint(wxPaintEvent &);
+    void OnLeftDown(wxMouseEvent &);
+    void OnTimer(wxTimerEvent &);
+
+  private:
+    Frame *owner;
+    MotionTrack track;
+    CacheBuilder<MotionTrack> builder;
+    FrameDefectIndex defects;
+    CacheBuilder<FrameDefectIndex> defectBuilder;
+    std::vector<FrameDefect> defectRuns;
+    bool trackPending;      ///< the builder has not been taken yet
+    bool defectsPending;
+    wxTimer timer;
+    double threshold;
+    float autoThreshold;
+
+    DECLARE_EVENT_TABLE()
+};
+
+const int MotionPanelHeight = 24;
+const int MotionDefectBand = 4;       // height of the defect markers
+const int MotionPollPeriod = 250;     // ms between checks of the background work
@@ -0,0 +1,184 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "slit_scan_panel.h"
+#include "frame.h"
+
+BEGIN_EVENT_TABLE(SlitScanPanel, wxScrolledWindow)
+  EVT_PAINT(SlitScanPanel::OnPaint)
+  EVT_LEFT_DOWN(SlitScanPanel::OnLeftDown)
+  EVT_TIMER(wxID_ANY, SlitScanPanel::OnTimer)
+END_EVENT_TABLE()
+
+SlitScanPanel::SlitScanPanel(Frame *ownerFrame)
+:wxScrolledWindow(ownerFrame, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxHSCROLL)
+  , owner(ownerFrame)
+  , builder(SlitScan(SlitScanHeight))
+  , timer(this)
+  , shownFrame(-1)
+{
+  SetBackgroundColour(wxColour(0, 0, 0));
+  SetBackgroundStyle(wxBG_STYLE_CUSTOM);
+  SetScrollRate(1, 0);
+  SetMinSize(wxSize(-1, SlitScanHeight + SlitScanIntervalBand + SlitScanProposalBand + wxSystemSettings::GetMetric(wxSYS_HSCROLL_Y)));
+}
+
+void SlitScanPanel::OpenVideo(const std::string &videoName)
+{
+  CloseVideo();
+  builder.start(videoName);
+  timer.Start(SlitScanPollPeriod);
+}
+
+void SlitScanPanel::CloseVideo()
+{
+  timer.Stop();
+  builder.cancel();
+  scan.clear();
+  shownFrame = -1;
+  Scroll(0, 0);
+  SetVirtualSize(0, 0);
+  Refresh();
+}
+
+void SlitScanPanel::OnTimer(wxTimerEvent &)
+{
+  if (builder.isRunning())
+  {
+    Refresh();    // progress
+    return;
+  }
+  timer.Stop();
+  if (builder.take(scan))
+  {
+    LOG_INFO("Slit-scan of " << scan.getFrames() << " frames is ready");
+    SetVirtualSize(scan.getFrames(), SlitScanHeight + SlitScanIntervalBand + SlitScanProposalBand);
+    shownFrame = -1;
+    OnUpdateFrame();
+  }
+  else
+    LOG_WARNING("Cannot make the slit-scan of the video");
+  Refresh();
+}
+
+void SlitScanPanel::OnUpdateFrame()
+{
+  if (scan.empty())
+    return;
+  int frame = owner->markedVideo.getCurrentFrameNumber();
+  if (frame != shownFrame)
+  {
+    shownFrame = frame;
+    int viewX, viewY;
+    GetViewStart(&viewX, &viewY);
+    int width = GetClientSize().GetWidth();
+    if (frame < viewX || frame >= viewX + width)
+      Scroll(std::max(0, frame - width / 2), 0);
+  }
+  Refresh();    // intervals may have changed as well
+}
+
+void SlitScanPanel::OnLeftDown(wxMouseEvent &event)
+{
+  int x, y;
+  CalcUnscrolledPosition(event.GetPosition().x, event.GetPosition().y, &x, &y);
+  if (x < 0 || x >= scan.getFrames())
+    return;
+  if (owner->markedVideo.goToFrame(x))
+    owner->Synchronize();
+}
+
+void SlitScanPanel::OnPaint(wxPaintEvent &)
+{
+  wxPaintDC dc(this);
+  dc.SetBackground(wxBrush(GetBackgroundColour()));
+  dc.Clear();
+  if (scan.empty())
+  {
+    if (builder.isRunning())
+    {
+      wxString text;
+      text.Printf(wxT("Making slit-scan: %d frames"), builder.getProgress());
+      dc.SetTextForeground(wxColour(200, 200, 200));
+      dc.DrawText(text, 5, 5);
+    }
+    return;
+  }
+  DoPrepareDC(dc);
+
+  // only the columns in sight are converted
+  int first, viewY;
+  GetViewStart(&first, &viewY);
+  int last = std::min(scan.getFrames(), first + GetClientSize().GetWidth()) - 1;
+  if (last < first)
+    return;
+  int width = last - first + 1;
+  wxImage image(width, scan.getHeight(), false);
+  unsigned char *data = image.GetData();
+  for (int x = 0; x < width; x++)
+  {
+    const uint8_t *column = scan.getColumn(first + x);
+    for (int y = 0; y < scan.getHeight(); y++)
+      memcpy(data + (y * width + x) * 3, column + y * 3, 3);
+  }
+  dc.DrawBitmap(wxBitmap(image), first, 0);
+
+  // intervals: a frame around the strip part and a band under it
+  const video_markup::Markup &markup = owner->markedVideo.getMarkup();
+  int currentId = owner->markedVideo.getCurrentIntervalId();
+  dc.SetBrush(*wxTRANSPARENT_BRUSH);
+  for (size_t i = 0; i < markup.size(); i++)
+  {
+    const video_markup::Interval &interval = markup[i];
+    if (interval.end < first || interval.start > last)
+      continue;
+    wxColour colour = (int) i == currentId ? wxColour(255, 0, 0) : wxColour(250, 200, 0);
+    int intervalWidth = interval.end - interval.start + 1;
+    dc.SetPen(wxPen(colour));
+    dc.DrawRectangle(interval.start, 0, intervalWidth, scan.getHeight());
+    dc.SetBrush(wxBrush(colour));
+    dc.DrawRectangle(interval.start, scan.getHeight() + 2, intervalWidth, SlitScanIntervalBand - 2);
+    dc.SetBrush(*wxTRANSPARENT_BRUSH);
+  }
+
+  const video_markup::Markup &proposals = owner->markedVideo.getProposals();
+  dc.SetPen(wxPen(wxColour(0, 200, 255)));
+  dc.SetBrush(wxBrush(wxColour(0, 200, 255)));
+  for (size_t i = 0; i < proposals.size(); i++)
+  {
+    const video_markup::Interval &proposal = proposals[i];
+    if (proposal.end >= first && proposal.start <= last)
+      dc.DrawRectangle(proposal.start, scan.getHeight() + SlitScanIntervalBand + 1, proposal.end - proposal.start + 1, SlitScanProposalBand - 1);
+  }
+
+  // current frame
+  if (shownFrame >= first && shownFrame <= last)
+  {
+    dc.SetPen(wxPen(wxColour(0, 255, 0)));
+    dc.DrawLine(shownFrame, 0, shownFrame, scan.getHeight() + SlitScanIntervalBand + SlitScanProposalBand);
+  }
+}
@@ -0,0 +1,74 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <wx/wx.h>
+
+#include "slit_scan.h"
+#include "background_task.h"
+
+class Frame;
+
+/** Scrollable time-slice strip of the video (see SlitScan): one column per
+  * frame with the intervals, the proposed intervals and the current frame
+  * drawn over it.
+  * The strip is made in the background; a click goes to the frame
+  */
+class SlitScanPanel: public wxScrolledWindow
+{
+  public:
+    SlitScanPanel(Frame *ownerFrame);
+
+    /** Starts making (or loading) the strip of the video
+      */
+    void OpenVideo(const std::string &videoName);
+
+    /** Stops the background work and forgets the strip
+      */
+    void CloseVideo();
+
+    /** Keeps the current frame in sight
+      */
+    void OnUpdateFrame();
+
+    void OnPaint(wxPaintEvent &);
+    void OnLeftDown(wxMouseEvent &);
+    void OnTimer(wxTimerEvent &);
+
+  private:
+    Frame *owner;
+    SlitScan scan;
+    CacheBuilder<SlitScan> builder;
+    wxTimer timer;
+    int shownFrame;               ///< current frame as last drawn
+
+    DECLARE_EVENT_TABLE()
+};
+
+const int SlitScanHeight = 96;        // strip height in pixels, frame columns are scaled to it
+const int SlitScanIntervalBand = 8;   // height of the interval marks under the strip
+const int SlitScanProposalBand = 4;   // height of the proposal marks under the interval ones
+const int SlitScanPollPeriod = 250;   // ms between checks of the background work
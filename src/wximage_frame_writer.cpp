@@ -0,0 +1,48 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <cstring>
+#include <wx/image.h>
+#include <wx/mstream.h>
+
+#include "wximage_frame_writer.h"
+
+bool WxImageFrameWriter::encode(const MinImg &frame, std::vector<uint8_t> &data)
+{
+  // wxImage does not support stride, so manual line copy is needed for 100% compatibility
+  wxImage image(frame.width, frame.height, false);
+  uint8_t *imageData = image.GetData();
+  int imageDataStride = frame.width * 3;
+  for (int i = 0; i < frame.height; i++)
+    memcpy(imageData + i * imageDataStride, frame.pScan0 + i * frame.stride, imageDataStride);
+
+  wxImageHandler *handler = wxImage::FindHandler(wxString(_extension.c_str(), wxConvLibc), wxBITMAP_TYPE_ANY);
+  wxMemoryOutputStream stream;
+  if (!handler || !image.SaveFile(stream, handler->GetType()))
+    return false;
+  data.resize(stream.GetLength());
+  if (!data.empty())
+    stream.CopyTo(&data[0], data.size());
+  return true;
+}
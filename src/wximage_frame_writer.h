@@ -0,0 +1,56 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string>
+#include "frame_writer.h"
+
+/** Saves frames with wxImage. The image format is chosen by wxWidgets
+  * from the extension
+  */
+class WxImageFrameWriter: public FrameWriter
+{
+public:
+  explicit WxImageFrameWriter(const std::string &extension = "jpg")
+  : _extension(extension)
+  {
+  }
+
+  virtual bool encode(const MinImg &frame, std::vector<uint8_t> &data);
+  virtual const char *getExtension() const
+  {
+    return _extension.c_str();
+  }
+
+  /** wxImage handlers share global state
+    */
+  virtual bool isThreadSafe() const
+  {
+    return false;
+  }
+
+private:
+  std::string _extension;
+};
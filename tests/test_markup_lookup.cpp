@@ -0,0 +1,173 @@
+/*
+
+Copyright (c) 2014 Timur M. Khanipov <khanipov@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/** Checks the interval lookups of Markup against a plain scan over the
+  * intervals on random markups. Returns non-zero if any lookup differs
+  */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "video_markup.h"
+
+using video_markup::Interval;
+using video_markup::Markup;
+
+namespace {
+
+  int scanFind(const Markup &markup, int frame)
+  {
+    for (size_t i = 0; i < markup.size(); i++)
+      if (markup[i].contains(frame))
+        return (int) i;
+    return -1;
+  }
+
+  int scanNext(const Markup &markup, int frame)
+  {
+    for (size_t i = 0; i < markup.size(); i++)
+      if (markup[i].start > frame)
+        return (int) i;
+    return -1;
+  }
+
+  int scanPrev(const Markup &markup, int frame)
+  {
+    int found = -1;
+    for (size_t i = 0; i < markup.size(); i++)
+      if (markup[i].end < frame)
+        found = (int) i;
+    return found;
+  }
+
+  // the nearest interval by the distance to its border, the earlier one on a tie
+  int scanClosest(const Markup &markup, int frame)
+  {
+    int found = -1;
+    int best = 0;
+    for (size_t i = 0; i < markup.size(); i++)
+    {
+      int distance = std::max(0, std::max(markup[i].start - frame, frame - markup[i].end));
+      if (found < 0 || distance < best)
+      {
+        found = (int) i;
+        best = distance;
+      }
+    }
+    return found;
+  }
+
+  int random(int lo, int hi)
+  {
+    return lo + rand() % (hi - lo + 1);
+  }
+
+  /** Intervals of 2 to 12 frames, every third gap between them is empty
+    * so that the intervals touch
+    */
+  std::vector<Interval> makeIntervals(int count)
+  {
+    std::vector<Interval> intervals;
+    int frame = random(0, 10);
+    for (int i = 0; i < count; i++)
+    {
+      Interval interval;
+      interval.start = frame;
+      interval.end = frame + random(1, 11);
+      interval.type = 0;
+      intervals.push_back(interval);
+      frame = interval.end + 1 + (random(0, 2) == 0 ? 0 : random(1, 8));
+    }
+    return intervals;
+  }
+
+  int check(const Markup &markup, const char *name, int frame, int got, int expected)
+  {
+    if (got == expected)
+      return 0;
+    printf("%s(%d) on %d interval(s): %d instead of %d\n", name, frame, (int) markup.size(), got, expected);
+    return 1;
+  }
+
+  int checkMarkup(const Markup &markup)
+  {
+    int first = markup.empty() ? 0 : markup[0].start;
+    int last = markup.empty() ? 0 : markup[markup.size() - 1].end;
+    int errors = 0;
+    // frames before the first and after the last interval are included
+    for (int frame = first - 5; frame <= last + 5; frame++)
+    {
+      int inside = scanFind(markup, frame);
+      errors += check(markup, "find", frame, markup.find(frame), inside);
+      errors += check(markup, "isIntervalFrame", frame, markup.isIntervalFrame(frame), inside >= 0);
+      errors += check(markup, "findNextClosest", frame, markup.findNextClosest(frame), scanNext(markup, frame));
+      errors += check(markup, "findPrevClosest", frame, markup.findPrevClosest(frame), scanPrev(markup, frame));
+      errors += check(markup, "findClosest", frame, markup.findClosest(frame), scanClosest(markup, frame));
+    }
+    return errors;
+  }
+
+} // namespace
+
+int main()
+{
+  srand(2014);
+  int errors = 0;
+  int markups = 0;
+  for (int round = 0; round < 500 && errors < 20; round++)
+  {
+    // empty and single interval markups come up often enough
+    std::vector<Interval> intervals = makeIntervals(random(0, 3) == 0 ? random(0, 1) : random(2, 40));
+
+    // the markup built at once and the one filled interval by interval in random order
+    std::vector<Interval> copy = intervals;
+    Markup built;
+    if (!built.build(copy))
+    {
+      printf("building a markup of %d interval(s) failed\n", (int) intervals.size());
+      return 1;
+    }
+    std::random_shuffle(intervals.begin(), intervals.end());
+    Markup pushed;
+    for (size_t i = 0; i < intervals.size(); i++)
+    {
+      if (pushed.push(intervals[i]) < 0)
+      {
+        printf("pushing interval [%d, %d] failed\n", intervals[i].start, intervals[i].end);
+        return 1;
+      }
+    }
+    errors += checkMarkup(built) + checkMarkup(pushed);
+    markups += 2;
+  }
+  if (errors)
+  {
+    printf("%d lookup(s) differ from the scan\n", errors);
+    return 1;
+  }
+  printf("lookups of %d markups match the scan\n", markups);
+  return 0;
+}
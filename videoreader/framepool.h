@@ -0,0 +1,111 @@
+/*
+ * Written by Timur Khanipov and released to the public domain,
+ * as explained at http://creativecommons.org/publicdomain/zero/1.0/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <minimg.h>
+
+struct FrameBuffer;
+
+/** Reference-counted handle to a frame allocated by FramePool.
+  * Copies of a handle share the same frame. The frame buffer is given back
+  * to its pool when the last handle is released, so the frame stays valid
+  * for as long as somebody holds a handle to it.
+  * If videoreader is built with VIDEOREADER_THREAD_SAFE handles may be
+  * copied and released from different threads.
+  */
+class FrameRef
+{
+public:
+  FrameRef();
+  FrameRef(const FrameRef &other);
+  ~FrameRef();
+  FrameRef &operator= (const FrameRef &other);
+
+  /** Drops the reference. The handle becomes null
+    */
+  void release();
+
+  bool isNull() const
+  {
+    return _buffer == 0;
+  }
+
+  /** @return pointer to the frame
+    * @return NULL the handle is null
+    */
+  const MinImg *get() const;
+
+  /** Frame for filling by its producer. Must only be used while
+    * the handle is unique, i.e. before it is shared with consumers
+    * @return NULL the handle is null
+    */
+  MinImg *getWritable();
+
+  /** @return true this is the only handle to the frame
+    */
+  bool isUnique() const;
+
+  const MinImg *operator-> () const
+  {
+    return get();
+  }
+
+private:
+  explicit FrameRef(FrameBuffer *buffer);
+
+  FrameBuffer *_buffer;
+
+  friend class FramePool;
+};
+
+/** Allocator of aligned frame buffers.
+  * Released buffers are kept for reuse (up to a given number) instead of
+  * being freed, so steady state decoding does no memory allocation at all.
+  * The pool may be destroyed while some of its frames are still referenced,
+  * such frames are freed when their last handle is released.
+  */
+class FramePool
+{
+public:
+  enum
+  {
+    Alignment = 32    ///< alignment of the buffer start and of every row in bytes
+  };
+
+  struct Statistics
+  {
+    int allocated;    ///< number of buffers allocated so far
+    int reused;       ///< number of acquire() calls served from released buffers
+    int live;         ///< number of buffers referenced at the moment
+    int free;         ///< number of released buffers waiting for reuse
+  };
+
+  /** @param[in] maxFree Maximum number of released buffers kept for reuse
+    */
+  explicit FramePool(int maxFree = 16);
+  ~FramePool();
+
+  /** Get a frame buffer of the given geometry. Frame contents are undefined.
+    * @return unique handle to the frame
+    * @return null handle Failure (out of memory or invalid geometry)
+    */
+  FrameRef acquire(int width, int height, int channels, int channelDepth = 1);
+
+  /** Frees all buffers waiting for reuse
+    */
+  void trim();
+
+  Statistics getStatistics() const;
+
+  struct Shared;
+
+private:
+  FramePool(const FramePool &);
+  FramePool &operator= (const FramePool &);
+
+  Shared *_shared;
+};
@@ -5,10 +5,13 @@
 
 
 #include <cstdio>
+#include <cstring>
 #include <cstdarg>
 #include <cassert>
+#include <algorithm>
 
 #include "ffmpegvideo.h"
+#include "videoreader.h"
 
 #ifdef VIDEOREADER_THREAD_SAFE
 # include <boost/thread.hpp>
@@ -59,6 +62,7 @@ void FFMpegVideoFile::_init()
   _pCodecContext = 0;
   _pFrame = 0;
   _pConverter2RGB = 0;
+  _pRegionConverter = 0;
   _streamId = -1;
   _isOpened = false;
   _currentFrame = -1;
@@ -85,6 +89,7 @@ void FFMpegVideoFile::_free()
     av_free(_pFrameRGB);
 
   sws_freeContext(_pConverter2RGB);
+  sws_freeContext(_pRegionConverter);
 
   _init();
 }
@@ -151,6 +156,60 @@ bool FFMpegVideoFile::open(const char *videoFileName)
   return true;
 }
 
+bool FFMpegVideoFile::probe(const char *videoFileName, VideoInfo &info)
+{
+  assert(videoFileName);
+  memset(&info, 0, sizeof(info));
+  info.totalFrames = info.keyFrames = -1;
+
+  AVFormatContext *formatContext = 0;
+  if (av_open_input_file(&formatContext, videoFileName, 0, 0, 0) != 0)
+  {
+    _log(LOG_ERROR, "Cannot open file");
+    return false;
+  }
+
+  AVStream *stream = 0;
+  for (int i = 0; i < (int) formatContext->nb_streams && !stream; i++)
+    if (formatContext->streams[i]->codec->codec_type == CODEC_TYPE_VIDEO)
+      stream = formatContext->streams[i];
+  // headers of most containers (AVI among them) tell the frame size,
+  // the rest need a few packets to be parsed, which opens codecs
+  if (stream && stream->codec->width <= 0)
+  {
+    CRITICAL_SECTION
+    if (av_find_stream_info(formatContext) < 0)
+      stream = 0;
+  }
+  if (!stream)
+  {
+    _log(LOG_ERROR, "no video streams found");
+    av_close_input_file(formatContext);
+    return false;
+  }
+
+  info.width = stream->codec->width;
+  info.height = stream->codec->height;
+  if (stream->nb_frames > 0)
+    info.totalFrames = (int) stream->nb_frames;
+  if (stream->nb_index_entries > 0)
+  {
+    info.keyFrames = 0;
+    for (int i = 0; i < stream->nb_index_entries; i++)
+      if (stream->index_entries[i].flags & AVINDEX_KEYFRAME)
+        info.keyFrames++;
+  }
+  if (stream->r_frame_rate.den > 0)
+    info.fps = (double) stream->r_frame_rate.num / stream->r_frame_rate.den;
+  else if (stream->time_base.num > 0 && stream->time_base.den <= 1000 * stream->time_base.num)
+    info.fps = (double) stream->time_base.den / stream->time_base.num;   // constant frame rate containers (AVI)
+  if (AVCodec *codec = avcodec_find_decoder(stream->codec->codec_id))
+    strncpy(info.codec, codec->name, sizeof(info.codec) - 1);
+
+  av_close_input_file(formatContext);
+  return true;
+}
+
 bool FFMpegVideoFile::close()
 {
   if (!isOpened())
@@ -298,15 +357,9 @@ int FFMpegVideoFile::_findKeyIndex(int pos) const
   if (!isOpened() || !_keyIndexTable.size())
     return -1;
 
-  // FIXME: use binary search
-  int keyIndex = -1;
-  for (int i = 0; i < (int) _keyIndexTable.size(); i++)
-  {
-    if (_keyIndexTable[i] > pos)
-      break;
-    keyIndex = i;
-  }
-  return keyIndex;
+  // key frames are sorted, the one we need is right before the first one after pos
+  std::vector<int>::const_iterator it = std::upper_bound(_keyIndexTable.begin(), _keyIndexTable.end(), pos);
+  return (int) (it - _keyIndexTable.begin()) - 1;
 }
 
 FFMpegVideoFile::LogLevel FFMpegVideoFile::setLogLevel(FFMpegVideoFile::LogLevel newLevel)
@@ -364,6 +417,15 @@ const AVFrame *FFMpegVideoFile::convertToRGB(const AVFrame *pNativeFrame)
 {
   if (!isOpened() || !pNativeFrame)
     return 0;
+  if (!convertToRGB(pNativeFrame, _pFrameRGB->data[0], _pFrameRGB->linesize[0]))
+    return 0;
+  return _pFrameRGB;
+}
+
+bool FFMpegVideoFile::convertToRGB(const AVFrame *pNativeFrame, uint8_t *dst, int dstStride)
+{
+  if (!isOpened() || !pNativeFrame || !dst)
+    return false;
   if (!_pConverter2RGB)
   {
     _pConverter2RGB = sws_getContext( getWidth(), getHeight(), getCodecContext()->pix_fmt,
@@ -371,12 +433,65 @@ const AVFrame *FFMpegVideoFile::convertToRGB(const AVFrame *pNativeFrame)
     if (!_pConverter2RGB)
     {
       _log(LOG_ERROR, "sws_getContext() failed");
-      return 0;
+      return false;
     }
   }
+  uint8_t *dstData[4] = { dst, 0, 0, 0 };
+  int dstLinesize[4] = { dstStride, 0, 0, 0 };
   sws_scale(_pConverter2RGB, pNativeFrame->data, pNativeFrame->linesize, 0, _pCodecContext->height,
-            _pFrameRGB->data, _pFrameRGB->linesize);
-  return _pFrameRGB;
+            dstData, dstLinesize);
+  return true;
+}
+
+bool FFMpegVideoFile::convertToRGB(const AVFrame *pNativeFrame, int x, int y, int width, int height,
+                                   int dstWidth, int dstHeight, uint8_t *dst, int dstStride)
+{
+  if (!isOpened() || !pNativeFrame || !dst)
+    return false;
+  const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[getCodecContext()->pix_fmt];
+  if (desc->flags & (PIX_FMT_PAL | PIX_FMT_BITSTREAM | PIX_FMT_HWACCEL))
+  {
+    _log(LOG_ERROR, "regions are not supported for pixel format %s", desc->name);
+    return false;
+  }
+  // chroma planes are addressed in whole samples
+  x = x >> desc->log2_chroma_w << desc->log2_chroma_w;
+  y = y >> desc->log2_chroma_h << desc->log2_chroma_h;
+  if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > getWidth() || y + height > getHeight()
+      || dstWidth <= 0 || dstHeight <= 0)
+  {
+    _log(LOG_ERROR, "invalid frame region");
+    return false;
+  }
+
+  _pRegionConverter = sws_getCachedContext(_pRegionConverter, width, height, getCodecContext()->pix_fmt,
+                                           dstWidth, dstHeight, PIX_FMT_RGB24, SWS_BICUBIC, 0, 0, 0);
+  if (!_pRegionConverter)
+  {
+    _log(LOG_ERROR, "sws_getCachedContext() failed");
+    return false;
+  }
+
+  // the scaler gets pointers to the top left corner of the region in every plane
+  const uint8_t *srcData[4] = { 0, 0, 0, 0 };
+  for (int plane = 0; plane < 4 && pNativeFrame->data[plane]; plane++)
+  {
+    int step = 1;
+    bool chroma = false;
+    for (int c = desc->nb_components - 1; c >= 0; c--)
+      if (desc->comp[c].plane == plane)
+      {
+        step = desc->comp[c].step_minus1 + 1;
+        chroma = (c == 1 || c == 2) && plane != desc->comp[0].plane;
+      }
+    int planeX = chroma ? x >> desc->log2_chroma_w : x;
+    int planeY = chroma ? y >> desc->log2_chroma_h : y;
+    srcData[plane] = pNativeFrame->data[plane] + planeY * pNativeFrame->linesize[plane] + planeX * step;
+  }
+  uint8_t *dstData[4] = { dst, 0, 0, 0 };
+  int dstLinesize[4] = { dstStride, 0, 0, 0 };
+  sws_scale(_pRegionConverter, srcData, pNativeFrame->linesize, 0, height, dstData, dstLinesize);
+  return true;
 }
 
 int FFMpegVideoFile::getTotalFrames()
@@ -400,3 +515,111 @@ int FFMpegVideoFile::findKeyFrame(int pos) const
   else
     return _keyIndexTable[ idx ];
 }
+
+int FFMpegVideoFile::copyPackets(int first, int last, const char *outputName)
+{
+  assert(outputName);
+  if (!isOpened() || first < 0 || last < first)
+    return -1;
+  if (findKeyFrame(first) != first)
+  {
+    _log(LOG_ERROR, "frame #%d is not key frame", first);
+    return -1;
+  }
+
+  AVStream *pInputStream = _pFormatContext->streams[_streamId];
+  AVFormatContext *pOutput = 0;
+  bool fileOpened = false;
+  int frame = first;
+  try
+  {
+    AVOutputFormat *pFormat = av_guess_format(0, outputName, 0);
+    if (!pFormat)
+      throw "cannot guess output format";
+    pOutput = avformat_alloc_context();
+    if (!pOutput)
+      throw "out of memory";
+    pOutput->oformat = pFormat;
+    strncpy(pOutput->filename, outputName, sizeof(pOutput->filename) - 1);
+
+    AVStream *pOutputStream = av_new_stream(pOutput, 0);
+    if (!pOutputStream)
+      throw "out of memory";
+    if (avcodec_copy_context(pOutputStream->codec, pInputStream->codec) < 0)
+      throw "avcodec_copy_context() failed";
+    // a codec tag of the source container may mean nothing in the output one
+    const AVCodecTag * const *tags = pFormat->codec_tag;
+    if (tags && av_codec_get_id(tags, pInputStream->codec->codec_tag) != pInputStream->codec->codec_id
+        && av_codec_get_tag(tags, pInputStream->codec->codec_id) > 0)
+      pOutputStream->codec->codec_tag = 0;
+    pOutputStream->codec->time_base = pInputStream->time_base;
+    pOutputStream->time_base = pInputStream->time_base;
+    pOutputStream->r_frame_rate = pInputStream->r_frame_rate;
+    pOutputStream->sample_aspect_ratio = pInputStream->sample_aspect_ratio;
+    if (pFormat->flags & AVFMT_GLOBALHEADER)
+      pOutputStream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+    if (av_set_parameters(pOutput, 0) < 0)
+      throw "invalid output parameters";
+    if (url_fopen(&pOutput->pb, outputName, URL_WRONLY) < 0)
+      throw "cannot create output file";
+    fileOpened = true;
+    if (av_write_header(pOutput) < 0)
+      throw "av_write_header() failed";
+
+    if (av_seek_frame(_pFormatContext, _streamId, first, AVSEEK_FLAG_FRAME | AVSEEK_FLAG_BACKWARD) < 0)
+      throw "av_seek_frame() failed";
+    // the decoder has not seen the packets, so the next seek() must not be skipped
+    _currentFrame = -1;
+
+    // timestamps are shifted so that the clip starts from zero
+    int64_t startDts = (int64_t) AV_NOPTS_VALUE;
+    AVPacket packet;
+    while (frame <= last && av_read_frame(_pFormatContext, &packet) >= 0)
+    {
+      if (packet.stream_index != _streamId)
+      {
+        av_free_packet(&packet);
+        continue;
+      }
+      if (startDts == (int64_t) AV_NOPTS_VALUE)
+        startDts = (packet.dts != (int64_t) AV_NOPTS_VALUE) ? packet.dts : 0;
+      if (packet.pts != (int64_t) AV_NOPTS_VALUE)
+        packet.pts = av_rescale_q(packet.pts - startDts, pInputStream->time_base, pOutputStream->time_base);
+      if (packet.dts != (int64_t) AV_NOPTS_VALUE)
+        packet.dts = av_rescale_q(packet.dts - startDts, pInputStream->time_base, pOutputStream->time_base);
+      packet.duration = (int) av_rescale_q(packet.duration, pInputStream->time_base, pOutputStream->time_base);
+      packet.stream_index = pOutputStream->index;
+      packet.pos = -1;
+      int res = av_interleaved_write_frame(pOutput, &packet);
+      av_free_packet(&packet);
+      if (res < 0)
+        throw "av_interleaved_write_frame() failed";
+      frame++;
+    }
+    if (frame == first)
+      throw "no frames copied";
+    if (av_write_trailer(pOutput) < 0)
+      throw "av_write_trailer() failed";
+  }
+  catch (const char *errorMsg)
+  {
+    assert(errorMsg);
+    _log(LOG_ERROR, errorMsg);
+    frame = -1;
+  }
+
+  if (fileOpened)
+    url_fclose(pOutput->pb);
+  if (pOutput)
+  {
+    for (unsigned i = 0; i < pOutput->nb_streams; i++)
+    {
+      av_freep(&pOutput->streams[i]->codec->extradata);
+      av_freep(&pOutput->streams[i]->codec);
+      av_freep(&pOutput->streams[i]);
+    }
+    av_free(pOutput);
+  }
+  return frame < 0 ? -1 : frame - first;
+}
@@ -21,6 +21,7 @@ extern "C"
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
+#include <libavutil/pixdesc.h>
 }
 
 #ifdef _MSC_VER
@@ -34,6 +35,8 @@ extern "C"
 
 #include <vector>
 
+struct VideoInfo;
+
 class FFMpegVideoFile
 {
 public:
@@ -69,6 +72,26 @@ public:
     */
   const AVFrame *convertToRGB(const AVFrame *pNativeFrame);
 
+  /** Converts a frame obtained by readNextFrame() to RGB and stores
+    * it into the given buffer
+    * @param[in] pNativeFrame Raw video frame obtained by readNextFrame()
+    * @param[out] dst Buffer of at least dstStride * getHeight() bytes
+    * @param[in] dstStride Distance between the destination rows in bytes
+    * @return true Success
+    * @return false Failure
+    */
+  bool convertToRGB(const AVFrame *pNativeFrame, uint8_t *dst, int dstStride);
+
+  /** Converts a rectangle of a frame obtained by readNextFrame() to RGB
+    * scaling it to the given size. Only the rectangle is processed.
+    * x and y are rounded down to the chroma subsampling grid
+    * @param[out] dst Buffer of at least dstStride * dstHeight bytes
+    * @return true Success
+    * @return false Failure (e.g. the rectangle is outside of the frame)
+    */
+  bool convertToRGB(const AVFrame *pNativeFrame, int x, int y, int width, int height,
+                    int dstWidth, int dstHeight, uint8_t *dst, int dstStride);
+
   /** Seek to a given position
     * @param[in] pos Frame number to seek to (frame numbers start from zero)
     * @return true Success
@@ -101,6 +124,23 @@ public:
     */
   int findKeyFrame(int pos) const;
 
+  /** Numbers of the key frames in ascending order, empty if the video is not opened
+    */
+  const std::vector<int> &getKeyFrames() const
+  {
+    return _keyIndexTable;
+  }
+
+  /** Copies compressed packets of frames [first, last] into a new file
+    * without decoding them. The output container is guessed from the file
+    * extension. Reading position is lost, seek() has to be called before
+    * reading frames again
+    * @param[in] first Frame to start from, must be a key frame
+    * @return number of frames copied (less than requested if the video ends earlier)
+    * @return -1 Failure
+    */
+  int copyPackets(int first, int last, const char *outputName);
+
   const AVCodecContext *getCodecContext();
 
   enum LogLevel
@@ -112,11 +152,16 @@ public:
 
   static LogLevel setLogLevel(LogLevel newLogLevel);
 
+  /** @see probeVideo()
+    */
+  static bool probe(const char *videoFileName, VideoInfo &info);
+
 private:
   AVFormatContext *_pFormatContext;
   AVCodecContext  *_pCodecContext;
   AVFrame *_pFrame;
   struct SwsContext *_pConverter2RGB;
+  struct SwsContext *_pRegionConverter;   ///< cached for the last region geometry
   int _streamId;
   bool _isOpened;
   int _currentFrame;
@@ -0,0 +1,245 @@
+/*
+ * Written by Timur Khanipov and released to the public domain,
+ * as explained at http://creativecommons.org/publicdomain/zero/1.0/
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <vector>
+
+#include "framepool.h"
+
+#ifdef VIDEOREADER_THREAD_SAFE
+# include <boost/thread/mutex.hpp>
+# include <boost/thread/locks.hpp>
+# define POOL_LOCK(shared)   boost::lock_guard<boost::mutex> lock((shared)->mutex);
+#else
+# define POOL_LOCK(shared)
+#endif
+
+struct FrameBuffer
+{
+  MinImg image;
+  uint8_t *memory;            ///< what was really allocated, image.pScan0 points inside it
+  size_t capacity;            ///< usable bytes starting from the aligned address
+  int refCount;
+  FramePool::Shared *shared;
+};
+
+struct FramePool::Shared
+{
+#ifdef VIDEOREADER_THREAD_SAFE
+  boost::mutex mutex;
+#endif
+  std::vector<FrameBuffer *> freeBuffers;
+  int maxFree;
+  int refCount;               ///< the pool itself plus every live buffer
+  bool detached;              ///< the pool has been destroyed, nothing is kept for reuse
+  FramePool::Statistics stats;
+};
+
+namespace {
+
+  FrameBuffer *allocateBuffer(size_t size)
+  {
+    FrameBuffer *buffer = new FrameBuffer;
+    buffer->memory = (uint8_t *) malloc(size + FramePool::Alignment);
+    if (!buffer->memory)
+    {
+      delete buffer;
+      return 0;
+    }
+    memset(&buffer->image, 0, sizeof(buffer->image));
+    size_t offset = FramePool::Alignment - (size_t) buffer->memory % FramePool::Alignment;
+    buffer->image.pScan0 = buffer->memory + offset;
+    buffer->capacity = size + FramePool::Alignment - offset;
+    buffer->refCount = 0;
+    buffer->shared = 0;
+    return buffer;
+  }
+
+  void freeBuffer(FrameBuffer *buffer)
+  {
+    free(buffer->memory);
+    delete buffer;
+  }
+
+  // called when the last handle to the buffer goes away
+  void recycleBuffer(FrameBuffer *buffer)
+  {
+    FramePool::Shared *shared = buffer->shared;
+    bool deleteShared = false;
+    {
+      POOL_LOCK(shared)
+      if (!shared->detached && (int) shared->freeBuffers.size() < shared->maxFree)
+        shared->freeBuffers.push_back(buffer);
+      else
+        freeBuffer(buffer);
+      shared->stats.live--;
+      deleteShared = (--shared->refCount == 0);
+    }
+    if (deleteShared)
+      delete shared;
+  }
+
+  void addRef(FrameBuffer *buffer)
+  {
+    POOL_LOCK(buffer->shared)
+    buffer->refCount++;
+  }
+
+  void releaseRef(FrameBuffer *buffer)
+  {
+    bool last;
+    {
+      POOL_LOCK(buffer->shared)
+      last = (--buffer->refCount == 0);
+    }
+    if (last)
+      recycleBuffer(buffer);
+  }
+}
+
+FrameRef::FrameRef()
+: _buffer(0)
+{
+}
+
+FrameRef::FrameRef(FrameBuffer *buffer)
+: _buffer(buffer)
+{
+}
+
+FrameRef::FrameRef(const FrameRef &other)
+: _buffer(other._buffer)
+{
+  if (_buffer)
+    addRef(_buffer);
+}
+
+FrameRef::~FrameRef()
+{
+  release();
+}
+
+FrameRef &FrameRef::operator= (const FrameRef &other)
+{
+  if (other._buffer)
+    addRef(other._buffer);
+  release();
+  _buffer = other._buffer;
+  return *this;
+}
+
+void FrameRef::release()
+{
+  if (_buffer)
+    releaseRef(_buffer);
+  _buffer = 0;
+}
+
+const MinImg *FrameRef::get() const
+{
+  return _buffer ? &_buffer->image : 0;
+}
+
+MinImg *FrameRef::getWritable()
+{
+  assert(!_buffer || isUnique());
+  return _buffer ? &_buffer->image : 0;
+}
+
+bool FrameRef::isUnique() const
+{
+  if (!_buffer)
+    return false;
+  POOL_LOCK(_buffer->shared)
+  return _buffer->refCount == 1;
+}
+
+FramePool::FramePool(int maxFree)
+{
+  _shared = new Shared;
+  _shared->maxFree = maxFree;
+  _shared->refCount = 1;
+  _shared->detached = false;
+  memset(&_shared->stats, 0, sizeof(_shared->stats));
+}
+
+FramePool::~FramePool()
+{
+  bool deleteShared;
+  {
+    POOL_LOCK(_shared)
+    for (size_t i = 0; i < _shared->freeBuffers.size(); i++)
+      freeBuffer(_shared->freeBuffers[i]);
+    _shared->freeBuffers.clear();
+    _shared->detached = true;
+    deleteShared = (--_shared->refCount == 0);
+  }
+  if (deleteShared)
+    delete _shared;
+}
+
+FrameRef FramePool::acquire(int width, int height, int channels, int channelDepth)
+{
+  if (width <= 0 || height <= 0 || channels <= 0 || channelDepth <= 0)
+    return FrameRef();
+
+  int stride = width * channels * channelDepth;
+  stride = (stride + Alignment - 1) / Alignment * Alignment;
+  size_t size = (size_t) stride * height;
+
+  FrameBuffer *buffer = 0;
+  {
+    POOL_LOCK(_shared)
+    for (size_t i = 0; i < _shared->freeBuffers.size(); i++)
+      if (_shared->freeBuffers[i]->capacity >= size)
+      {
+        buffer = _shared->freeBuffers[i];
+        _shared->freeBuffers.erase(_shared->freeBuffers.begin() + i);
+        _shared->stats.reused++;
+        break;
+      }
+  }
+  if (!buffer)
+  {
+    buffer = allocateBuffer(size);
+    if (!buffer)
+      return FrameRef();
+    POOL_LOCK(_shared)
+    _shared->stats.allocated++;
+  }
+
+  buffer->image.width = width;
+  buffer->image.height = height;
+  buffer->image.stride = stride;
+  buffer->image.channels = channels;
+  buffer->image.channelDepth = channelDepth;
+  buffer->image.format = FMT_UINT;
+  buffer->image.addressSpace = 0;
+  buffer->refCount = 1;
+  buffer->shared = _shared;
+
+  POOL_LOCK(_shared)
+  _shared->refCount++;
+  _shared->stats.live++;
+  return FrameRef(buffer);
+}
+
+void FramePool::trim()
+{
+  POOL_LOCK(_shared)
+  for (size_t i = 0; i < _shared->freeBuffers.size(); i++)
+    freeBuffer(_shared->freeBuffers[i]);
+  _shared->freeBuffers.clear();
+}
+
+FramePool::Statistics FramePool::getStatistics() const
+{
+  POOL_LOCK(_shared)
+  Statistics stats = _shared->stats;
+  stats.free = (int) _shared->freeBuffers.size();
+  return stats;
+}
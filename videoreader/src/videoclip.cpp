@@ -0,0 +1,47 @@
+/*
+ * Written by Timur Khanipov and released to the public domain,
+ * as explained at http://creativecommons.org/publicdomain/zero/1.0/
+ */
+
+#include "ffmpegvideo.h"
+#include "videoclip.h"
+
+VideoClipWriter::VideoClipWriter()
+{
+  _video = new FFMpegVideoFile;
+}
+
+VideoClipWriter::~VideoClipWriter()
+{
+  delete _video;
+}
+
+bool VideoClipWriter::open(const char *sourceName)
+{
+  return _video->open(sourceName);
+}
+
+void VideoClipWriter::close()
+{
+  _video->close();
+}
+
+bool VideoClipWriter::isOpened() const
+{
+  return _video->isOpened();
+}
+
+int VideoClipWriter::findKeyFrame(int pos) const
+{
+  return _video->findKeyFrame(pos);
+}
+
+int VideoClipWriter::write(int start, int end, const char *clipName, int *firstFrame)
+{
+  int keyFrame = _video->findKeyFrame(start);
+  if (keyFrame < 0)
+    return -1;
+  if (firstFrame)
+    *firstFrame = keyFrame;
+  return _video->copyPackets(keyFrame, end, clipName);
+}
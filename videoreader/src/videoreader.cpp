@@ -5,6 +5,7 @@
 
 #include "videoreader.h"
 #include "videoreader_ffmpeg.h"
+#include "ffmpegvideo.h"
 
 VideoReader::VideoReader()
 : _type(AbstractReader)
@@ -32,3 +33,8 @@ void deleteVideoReader(VideoReader *videoReader)
   if (videoReader)
     delete videoReader;
 }
+
+bool probeVideo(const char *fileName, VideoInfo &info)
+{
+  return FFMpegVideoFile::probe(fileName, info);
+}
@@ -6,61 +6,91 @@
 #include "ffmpegvideo.h"
 #include "videoreader_ffmpeg.h"
 
-#include <cstring>
-
 VideoReaderFFMpeg::VideoReaderFFMpeg()
 {
   _type = FFMpegReader;
   _pFFMpegVideoFile = new FFMpegVideoFile;
-  memset(&_minimg, 0, sizeof(_minimg));
+  _pRawFrame = 0;
 }
 
 VideoReaderFFMpeg::~VideoReaderFFMpeg()
 {
+  _currentFrame.release();
   delete _pFFMpegVideoFile;
 }
 
 bool VideoReaderFFMpeg::open(const char *sourceName)
 {
-  if (!_pFFMpegVideoFile->open(sourceName))
-    return false;
-  _minimg.width = _pFFMpegVideoFile->getWidth();
-  _minimg.height = _pFFMpegVideoFile->getHeight();
-  _minimg.format = FMT_UINT;
-  _minimg.channels = 3;
-  _minimg.channelDepth = 1;
-  return true;
+  return _pFFMpegVideoFile->open(sourceName);
 }
 
 bool VideoReaderFFMpeg::close()
 {
-  memset(&_minimg, 0, sizeof(_minimg));
+  _currentFrame.release();
+  _pRawFrame = 0;
+  _framePool.trim();
   return _pFFMpegVideoFile->close();
 }
 
 const MinImg *VideoReaderFFMpeg::readNextFrame()
 {
-  const AVFrame *pRawFrame = _pFFMpegVideoFile->readNextFrame();
-  if (!pRawFrame)
-    return 0;
-  const AVFrame *pFrameRGB = _pFFMpegVideoFile->convertToRGB(pRawFrame);
-  if (!pFrameRGB)
-    return 0;
-  _minimg.stride = pFrameRGB->linesize[0];
-  _minimg.pScan0 = pFrameRGB->data[0];
-  return &_minimg;
+  return readNextFrameRef().get();
 }
 
 const MinImg *VideoReaderFFMpeg::getCurrentFrame()
 {
-  if (_minimg.pScan0)
-    return &_minimg;
-  else
-    return 0;
+  return _currentFrame.get();
+}
+
+FrameRef VideoReaderFFMpeg::readNextFrameRef()
+{
+  const AVFrame *pRawFrame = _pRawFrame = _pFFMpegVideoFile->readNextFrame();
+  if (!pRawFrame)
+    return FrameRef();
+  // the frame is converted straight into a pooled buffer, so no copy is made
+  // and the previously returned frames remain intact
+  FrameRef frame = _framePool.acquire(_pFFMpegVideoFile->getWidth(), _pFFMpegVideoFile->getHeight(), 3);
+  if (frame.isNull())
+    return FrameRef();
+  MinImg *image = frame.getWritable();
+  if (!_pFFMpegVideoFile->convertToRGB(pRawFrame, image->pScan0, image->stride))
+    return FrameRef();
+  _currentFrame = frame;
+  return frame;
+}
+
+FrameRef VideoReaderFFMpeg::getCurrentFrameRef()
+{
+  return _currentFrame;
+}
+
+bool VideoReaderFFMpeg::skipNextFrame()
+{
+  _currentFrame.release();
+  _pRawFrame = _pFFMpegVideoFile->readNextFrame();
+  return _pRawFrame != 0;
+}
+
+FrameRef VideoReaderFFMpeg::convertCurrentFrame(const FrameRegion &region)
+{
+  if (!_pRawFrame || !_pFFMpegVideoFile->isOpened())
+    return FrameRef();
+  int width = region.outputWidth > 0 ? region.outputWidth : region.width;
+  int height = region.outputHeight > 0 ? region.outputHeight : region.height;
+  FrameRef frame = _framePool.acquire(width, height, 3);
+  if (frame.isNull())
+    return FrameRef();
+  MinImg *image = frame.getWritable();
+  if (!_pFFMpegVideoFile->convertToRGB(_pRawFrame, region.x, region.y, region.width, region.height,
+                                       width, height, image->pScan0, image->stride))
+    return FrameRef();
+  return frame;
 }
 
 bool VideoReaderFFMpeg::seek(int pos)
 {
+  // seeking decodes frames without handing them out
+  _pRawFrame = 0;
   return _pFFMpegVideoFile->seek(pos);
 }
 
@@ -74,6 +104,12 @@ bool VideoReaderFFMpeg::isOpened()
   return _pFFMpegVideoFile->isOpened();
 }
 
+bool VideoReaderFFMpeg::getKeyFrames(std::vector<int> &keyFrames)
+{
+  keyFrames = _pFFMpegVideoFile->getKeyFrames();
+  return !keyFrames.empty();
+}
+
 int VideoReaderFFMpeg::getTotalFrames()
 {
   return _pFFMpegVideoFile->getTotalFrames();
@@ -8,6 +8,7 @@
 #include "videoreader.h"
 
 class FFMpegVideoFile;
+struct AVFrame;
 
 class VideoReaderFFMpeg: public VideoReader
 {
@@ -18,13 +19,20 @@ public:
   virtual bool close();
   virtual const MinImg *readNextFrame();
   virtual const MinImg *getCurrentFrame();
+  virtual FrameRef readNextFrameRef();
+  virtual FrameRef getCurrentFrameRef();
+  virtual bool skipNextFrame();
+  virtual FrameRef convertCurrentFrame(const FrameRegion &region);
   virtual bool seek(int pos);
   virtual int getPos();
+  virtual bool getKeyFrames(std::vector<int> &keyFrames);
   virtual bool isOpened();
   virtual int getTotalFrames();
   virtual int getWidth();
   virtual int getHeight();
 private:
   FFMpegVideoFile *_pFFMpegVideoFile;
-  MinImg _minimg;
+  FramePool _framePool;
+  FrameRef _currentFrame;
+  const AVFrame *_pRawFrame;    ///< last decoded frame, valid until the next read
 };
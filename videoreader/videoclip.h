@@ -0,0 +1,50 @@
+/*
+ * Written by Timur Khanipov and released to the public domain,
+ * as explained at http://creativecommons.org/publicdomain/zero/1.0/
+ */
+
+#pragma once
+
+class FFMpegVideoFile;
+
+/** Cuts clips out of a video by copying compressed packets, i.e. without
+  * decoding and re-encoding, so the speed is limited by disk I/O only.
+  * A clip must start at a key frame, so it may contain a few frames more
+  * than requested; the caller is told where the requested part begins.
+  */
+class VideoClipWriter
+{
+public:
+  VideoClipWriter();
+  ~VideoClipWriter();
+
+  /** Open the source video
+    * @return true Success
+    * @return false Failure
+    */
+  bool open(const char *sourceName);
+
+  void close();
+
+  bool isOpened() const;
+
+  /** Finds the latest key frame which precedes or is equal to frame #pos
+    * @return -1 Failed to find key frame
+    */
+  int findKeyFrame(int pos) const;
+
+  /** Writes frames [start, end] to a new file. The container format is
+    * guessed from the file extension
+    * @param[out] firstFrame Frame number (in the source video) of the first
+    *                        frame of the clip, i.e. the key frame preceding start
+    * @return number of frames in the clip (fewer than requested if the video ends earlier)
+    * @return -1 Failure
+    */
+  int write(int start, int end, const char *clipName, int *firstFrame);
+
+private:
+  VideoClipWriter(const VideoClipWriter &);
+  VideoClipWriter &operator= (const VideoClipWriter &);
+
+  FFMpegVideoFile *_video;
+};
@@ -5,7 +5,34 @@
 
 #pragma once
 
+#include <vector>
 #include <minimg.h>
+#include "framepool.h"
+
+/** Rectangle of a frame to be converted, optionally scaled to another size.
+  * The corner may be moved up and left to the nearest chroma sample of the
+  * native format (e.g. to even coordinates for YUV 4:2:0)
+  */
+struct FrameRegion
+{
+  FrameRegion()
+  : x(0), y(0), width(0), height(0), outputWidth(0), outputHeight(0)
+  {
+  }
+
+  int x;
+  int y;
+  int width;
+  int height;
+  int outputWidth;      ///< width of the result, 0 - same as width
+  int outputHeight;     ///< height of the result, 0 - same as height
+
+  bool operator== (const FrameRegion &other) const
+  {
+    return x == other.x && y == other.y && width == other.width && height == other.height
+      && outputWidth == other.outputWidth && outputHeight == other.outputHeight;
+  }
+};
 
 // interface abstract class
 class VideoReader
@@ -48,6 +75,37 @@ public:
     */
   virtual const MinImg *getCurrentFrame() = 0;
 
+  /** Move on to the next frame. Unlike readNextFrame() the frame is not
+    * overwritten by subsequent reads, it stays valid until the returned
+    * handle (and all its copies) is released
+    * @return handle to the frame which has been read
+    * @return null handle reached the end or an error happened
+    */
+  virtual FrameRef readNextFrameRef() = 0;
+
+  /** Get a handle to the current frame, i.e. the frame which has been read
+    * by the last readNextFrame() or readNextFrameRef() call
+    * @return null handle No frames have been read so far
+    */
+  virtual FrameRef getCurrentFrameRef() = 0;
+
+  /** Move on to the next frame without converting it to RGB. Use it together
+    * with convertCurrentFrame() when only parts of frames are needed.
+    * There is no current frame afterwards (getCurrentFrame() returns NULL)
+    * @return true Success
+    * @return false reached the end or an error happened
+    */
+  virtual bool skipNextFrame() = 0;
+
+  /** Converts a region of the frame which has been read last (by any of the
+    * read functions) to RGB, scaling it if requested. Only the pixels of the
+    * region are converted. The region must lie inside the frame; x and y may
+    * be rounded down to the chroma subsampling grid of the video
+    * @return handle to the converted region
+    * @return null handle Failure
+    */
+  virtual FrameRef convertCurrentFrame(const FrameRegion &region) = 0;
+
   /** Seek to a given position
     * @param[in] pos Frame number to seek to (frame numbers start from zero)
     * @return true Success
@@ -61,6 +119,13 @@ public:
   */
   virtual int getPos() = 0;
 
+  /** Get numbers of the key frames, in ascending order. Decoding started
+    * at a key frame does not depend on the frames before it, so parts of
+    * the video between key frames may be decoded independently
+    * @return false The video has no index of key frames
+    */
+  virtual bool getKeyFrames(std::vector<int> &keyFrames) = 0;
+
   virtual bool isOpened() = 0;
 
   /** Get number of frames in the video
@@ -97,3 +162,23 @@ VideoReader *createVideoReader(VideoReader::Type type);
   * @param[in] videoReader pointer to the instance (if NULL nothing happens)
   */
 void deleteVideoReader(VideoReader *videoReader);
+
+/** Video parameters told by the container, see probeVideo()
+  */
+struct VideoInfo
+{
+  int width;
+  int height;
+  int totalFrames;      ///< -1 if the container does not tell
+  int keyFrames;        ///< key frames in the container index, -1 if there is no index
+  double fps;           ///< 0 if unknown
+  char codec[32];       ///< name of the decoder, empty if there is none
+};
+
+/** Reads video parameters from the container headers. No codec is opened,
+  * no frame is decoded and the key frame table is not built, so it takes
+  * a fraction of the time of VideoReader::open() and may be called from
+  * several threads at once
+  * @return false Failure (the file cannot be opened or has no video stream)
+  */
+bool probeVideo(const char *fileName, VideoInfo &info);